@@ -0,0 +1,262 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "CertificateIndex.hpp"
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+
+namespace oatpp { namespace libressl {
+
+CertificateIndex::Keypair::Keypair(struct tls_config* config, const std::vector<oatpp::String>& names)
+  : m_config(config)
+  , m_names(names)
+  , m_selectedCount(0)
+{}
+
+CertificateIndex::Keypair::~Keypair() {
+  tls_config_free(m_config);
+}
+
+struct tls_config* CertificateIndex::Keypair::getTLSConfig() {
+  return m_config;
+}
+
+const std::vector<oatpp::String>& CertificateIndex::Keypair::getNames() const {
+  return m_names;
+}
+
+void CertificateIndex::Keypair::setCertificateType(const oatpp::String& certificateType) {
+  m_certificateType = certificateType;
+}
+
+oatpp::String CertificateIndex::Keypair::getCertificateType() const {
+  return m_certificateType;
+}
+
+std::shared_ptr<TLSObject> CertificateIndex::Keypair::getServerContext() {
+
+  m_selectedCount ++;
+
+  std::lock_guard<std::mutex> lock(m_contextMutex);
+
+  if(m_serverContext) {
+    return m_serverContext;
+  }
+
+  TLSObject::TLSHandle handle = tls_server();
+  if(handle == NULL) {
+    throw std::runtime_error("[oatpp::libressl::CertificateIndex::Keypair::getServerContext()]: Error. Failed to create tls_server.");
+  }
+
+  if(tls_configure(handle, m_config) < 0) {
+    OATPP_LOGE("[oatpp::libressl::CertificateIndex::Keypair::getServerContext()]", "Error on call to 'tls_configure'. %s", tls_error(handle));
+    tls_free(handle);
+    throw std::runtime_error("[oatpp::libressl::CertificateIndex::Keypair::getServerContext()]: Error. Failed to configure tls_server.");
+  }
+
+  m_serverContext = std::make_shared<TLSObject>(handle, TLSObject::Type::SERVER, nullptr);
+  m_serverContext->setCertificateType(m_certificateType);
+  return m_serverContext;
+
+}
+
+v_int64 CertificateIndex::Keypair::getSelectedCount() const {
+  return m_selectedCount;
+}
+
+std::string CertificateIndex::normalize(const char* name, v_buff_size size) {
+  std::string result(name, size);
+  for(auto& c : result) {
+    if(c >= 'A' && c <= 'Z') {
+      c = c - 'A' + 'a';
+    }
+  }
+  /* absolute name */
+  if(!result.empty() && result.back() == '.') {
+    result.pop_back();
+  }
+  return result;
+}
+
+std::vector<oatpp::String> CertificateIndex::getCertificateNames(const oatpp::String& certPem) {
+
+  if(!certPem) {
+    throw std::runtime_error("[oatpp::libressl::CertificateIndex::getCertificateNames()]: Error. Empty certificate.");
+  }
+
+  BIO* bio = BIO_new_mem_buf(certPem->data(), (int) certPem->size());
+  if(bio == nullptr) {
+    throw std::runtime_error("[oatpp::libressl::CertificateIndex::getCertificateNames()]: Error. Failed to create BIO.");
+  }
+
+  X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+  BIO_free(bio);
+
+  if(cert == nullptr) {
+    ERR_clear_error();
+    throw std::runtime_error("[oatpp::libressl::CertificateIndex::getCertificateNames()]: Error. Failed to parse certificate.");
+  }
+
+  std::vector<oatpp::String> names;
+
+  auto altNames = (GENERAL_NAMES*) X509_get_ext_d2i(cert, NID_subject_alt_name, nullptr, nullptr);
+  if(altNames != nullptr) {
+    for(int i = 0; i < sk_GENERAL_NAME_num(altNames); i ++) {
+      GENERAL_NAME* name = sk_GENERAL_NAME_value(altNames, i);
+      if(name->type == GEN_DNS) {
+        auto data = (const char*) ASN1_STRING_get0_data(name->d.dNSName);
+        auto size = ASN1_STRING_length(name->d.dNSName);
+        names.push_back(oatpp::String(normalize(data, size)));
+      }
+    }
+    GENERAL_NAMES_free(altNames);
+  }
+
+  if(names.empty()) {
+    char commonName[256];
+    auto size = X509_NAME_get_text_by_NID(X509_get_subject_name(cert), NID_commonName, commonName, sizeof(commonName));
+    if(size > 0) {
+      names.push_back(oatpp::String(normalize(commonName, size)));
+    }
+  }
+
+  X509_free(cert);
+  ERR_clear_error();
+
+  return names;
+
+}
+
+oatpp::String CertificateIndex::getCertificateType(const oatpp::String& certPem) {
+
+  if(!certPem) {
+    return nullptr;
+  }
+
+  BIO* bio = BIO_new_mem_buf(certPem->data(), (int) certPem->size());
+  if(bio == nullptr) {
+    return nullptr;
+  }
+
+  X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+  BIO_free(bio);
+
+  if(cert == nullptr) {
+    ERR_clear_error();
+    return nullptr;
+  }
+
+  EVP_PKEY* key = X509_get_pubkey(cert);
+  X509_free(cert);
+
+  if(key == nullptr) {
+    ERR_clear_error();
+    return nullptr;
+  }
+
+  oatpp::String result;
+  switch(EVP_PKEY_base_id(key)) {
+    case EVP_PKEY_RSA: result = "RSA-" + std::to_string(EVP_PKEY_bits(key)); break;
+    case EVP_PKEY_EC: result = "EC-" + std::to_string(EVP_PKEY_bits(key)); break;
+#ifdef EVP_PKEY_ED25519
+    case EVP_PKEY_ED25519: result = "ED25519"; break;
+#endif
+    default: result = "OTHER-" + std::to_string(EVP_PKEY_bits(key));
+  }
+
+  EVP_PKEY_free(key);
+  return result;
+
+}
+
+void CertificateIndex::add(const std::shared_ptr<Keypair>& keypair) {
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for(auto& name : keypair->getNames()) {
+    auto key = normalize(name->data(), name->size());
+    if(key.size() > 2 && key[0] == '*' && key[1] == '.') {
+      m_wildcard[key.substr(2)] = keypair;
+    } else {
+      m_exact[key] = keypair;
+    }
+  }
+
+  m_keypairs.push_back(keypair);
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> CertificateIndex::find(const char* serverName, v_buff_size size) const {
+
+  auto key = normalize(serverName, size);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_exact.find(key);
+  if(it != m_exact.end()) {
+    return it->second;
+  }
+
+  /* wildcard covers exactly one label */
+  auto dot = key.find('.');
+  if(dot != std::string::npos && dot > 0) {
+    it = m_wildcard.find(key.substr(dot + 1));
+    if(it != m_wildcard.end()) {
+      return it->second;
+    }
+  }
+
+  return nullptr;
+
+}
+
+std::shared_ptr<TLSObject> CertificateIndex::getServerContext(const char* serverName, v_buff_size size) {
+  auto keypair = find(serverName, size);
+  if(keypair) {
+    return keypair->getServerContext();
+  }
+  return nullptr;
+}
+
+void CertificateIndex::forEachKeypair(const std::function<void(const std::shared_ptr<Keypair>&)>& callback) const {
+  std::vector<std::shared_ptr<Keypair>> keypairs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    keypairs = m_keypairs;
+  }
+  for(auto& keypair : keypairs) {
+    callback(keypair);
+  }
+}
+
+v_int64 CertificateIndex::getKeypairsCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return (v_int64) m_keypairs.size();
+}
+
+}}
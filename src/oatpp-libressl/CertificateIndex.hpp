@@ -0,0 +1,189 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_CertificateIndex_hpp
+#define oatpp_libressl_CertificateIndex_hpp
+
+#include "TLSObject.hpp"
+#include "server/CertificateProvider.hpp"
+
+#include "oatpp/core/Types.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Index of server keypairs by host name - for SNI-based certificate selection. <br>
+ * Exact names and wildcard names (`*.example.com`) are kept in separate hash maps,
+ * so lookup costs at most two hash probes regardless of the number of certificates.
+ * See &id:oatpp::libressl::Config::addCertificate;.
+ * Extends &id:oatpp::libressl::server::CertificateProvider;.
+ */
+class CertificateIndex : public server::CertificateProvider {
+public:
+
+  /**
+   * Server keypair with its own `tls_config`. <br>
+   * The `tls_server` context of the keypair is created on the first handshake which selects it.
+   */
+  class Keypair {
+  private:
+    struct tls_config* m_config;
+    std::vector<oatpp::String> m_names;
+    oatpp::String m_certificateType;
+    std::mutex m_contextMutex;
+    std::shared_ptr<TLSObject> m_serverContext;
+    std::atomic<v_int64> m_selectedCount;
+  public:
+
+    /**
+     * Constructor.
+     * @param config - `tls_config` with the keypair set. Keypair takes the ownership.
+     * @param names - host names served with this keypair.
+     */
+    Keypair(struct tls_config* config, const std::vector<oatpp::String>& names);
+
+    /**
+     * Non-virtual destructor.
+     */
+    ~Keypair();
+
+    /**
+     * Get `tls_config` of the keypair.
+     * @return
+     */
+    struct tls_config* getTLSConfig();
+
+    /**
+     * Get host names served with this keypair.
+     * @return
+     */
+    const std::vector<oatpp::String>& getNames() const;
+
+    /**
+     * Set key type of the certificate. See &l:CertificateIndex::getCertificateType ();. Must be set before the context is created.
+     * @param certificateType
+     */
+    void setCertificateType(const oatpp::String& certificateType);
+
+    /**
+     * Get key type of the certificate.
+     * @return - certificate type. `nullptr` if not known.
+     */
+    oatpp::String getCertificateType() const;
+
+    /**
+     * Get `tls_server` context of the keypair. Context is created on the first call.
+     * @return - &id:oatpp::libressl::TLSObject;.
+     * @throws - `std::runtime_error` if the context can't be configured.
+     */
+    std::shared_ptr<TLSObject> getServerContext();
+
+    /**
+     * Get number of handshakes which selected this keypair.
+     * @return
+     */
+    v_int64 getSelectedCount() const;
+
+  };
+
+public:
+
+  /**
+   * Normalize server name - lowercase, without trailing dot.
+   * @param name - server name.
+   * @param size - size of the server name.
+   * @return - normalized name.
+   */
+  static std::string normalize(const char* name, v_buff_size size);
+
+private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<Keypair>> m_exact;
+  std::unordered_map<std::string, std::shared_ptr<Keypair>> m_wildcard;
+  std::vector<std::shared_ptr<Keypair>> m_keypairs;
+public:
+
+  /**
+   * Get DNS names of the certificate - subjectAltName DNS entries, or the subject CN if there are none.
+   * @param certPem - PEM-encoded certificate.
+   * @return - lowercase names.
+   * @throws - `std::runtime_error` if the certificate can't be parsed.
+   */
+  static std::vector<oatpp::String> getCertificateNames(const oatpp::String& certPem);
+
+  /**
+   * Get key type of the certificate - the algorithm and size of its public key. Ex.: `RSA-2048`, `EC-256`, `ED25519`.
+   * @param certPem - PEM-encoded certificate. When it is a chain, the first certificate is used.
+   * @return - certificate type. `nullptr` if the certificate can't be parsed.
+   */
+  static oatpp::String getCertificateType(const oatpp::String& certPem);
+
+  /**
+   * Add keypair to the index. Names already in the index are overridden.
+   * @param keypair - &l:CertificateIndex::Keypair;.
+   */
+  void add(const std::shared_ptr<Keypair>& keypair);
+
+  /**
+   * Find keypair for the server name - exact match first, then wildcard match of the first label.
+   * @param serverName - server name as sent by the client in SNI.
+   * @param size - size of the server name.
+   * @return - &l:CertificateIndex::Keypair;. `nullptr` if no keypair matches.
+   */
+  std::shared_ptr<Keypair> find(const char* serverName, v_buff_size size) const;
+
+  /**
+   * Get `tls_server` context of the keypair found by &l:CertificateIndex::find ();.
+   * @param serverName - server name as sent by the client in SNI.
+   * @param size - size of the server name.
+   * @return - server &id:oatpp::libressl::TLSObject;. `nullptr` if no keypair matches.
+   */
+  std::shared_ptr<TLSObject> getServerContext(const char* serverName, v_buff_size size) override;
+
+  /**
+   * Call function for each keypair in the index.
+   * @param callback
+   */
+  void forEachKeypair(const std::function<void(const std::shared_ptr<Keypair>&)>& callback) const;
+
+  /**
+   * Get number of keypairs in the index.
+   * @return
+   */
+  v_int64 getKeypairsCount() const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_CertificateIndex_hpp
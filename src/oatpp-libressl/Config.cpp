@@ -24,10 +24,76 @@
 
 #include "Config.hpp"
 
+#include <openssl/rand.h>
+
 namespace oatpp { namespace libressl {
 
+namespace {
+
+/* libtls keeps a few most recent ticket keys - keypair configs get the same ones */
+const v_int32 MAX_STORED_TICKET_KEYS = 4;
+
+}
+
+Config::RecordSizePolicy::RecordSizePolicy(v_buff_size pSmallRecordSize, v_int64 pBytesThreshold, v_int64 pIdleTimeout)
+  : smallRecordSize(pSmallRecordSize)
+  , bytesThreshold(pBytesThreshold)
+  , idleTimeout(pIdleTimeout)
+{}
+
+Config::TicketKeysLock::TicketKeysLock()
+  : m_readers(0)
+  , m_writer(false)
+  , m_writersWaiting(0)
+{}
+
+void Config::TicketKeysLock::lockShared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(m_writer || m_writersWaiting > 0) {
+    m_condition.wait(lock);
+  }
+  m_readers ++;
+}
+
+void Config::TicketKeysLock::unlockShared() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_readers --;
+  if(m_readers == 0) {
+    m_condition.notify_all();
+  }
+}
+
+void Config::TicketKeysLock::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_writersWaiting ++;
+  while(m_writer || m_readers > 0) {
+    m_condition.wait(lock);
+  }
+  m_writersWaiting --;
+  m_writer = true;
+}
+
+void Config::TicketKeysLock::unlock() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_writer = false;
+  m_condition.notify_all();
+}
+
 Config::Config()
   : m_config(tls_config_new())
+  , m_readAheadBufferSize(0)
+  , m_readBufferSize(0)
+  , m_writeBufferSize(0)
+  , m_recordSizePolicy(0)
+  , m_ticketKeysLock(std::make_shared<TicketKeysLock>())
+  , m_ticketKeysSet(false)
+  , m_ticketKeyRevision(0)
+  , m_ticketKeyRotationRunning(false)
+  , m_ticketKeyRotationInterval(0)
+  , m_sessionFd(-1)
+  , m_serverContextShards(1)
+  , m_protocols(0)
+  , m_sessionLifetime(-1)
 {}
 
 std::shared_ptr<Config> Config::createShared() {
@@ -41,11 +107,8 @@ std::shared_ptr<Config> Config::createDefaultServerConfigShared(const char* serv
   
   auto config = createShared();
   
-  tls_config_set_protocols(config->getTLSConfig(), protocols);
-  
-  if(tls_config_set_ciphers(config->getTLSConfig(), ciphers) < 0) {
-    throw std::runtime_error("[oatpp::libressl::Config::createDefaultServerConfigShared]: failed call to tls_config_set_ciphers()");
-  }
+  config->setProtocols(protocols);
+  config->setCiphers(ciphers);
   
   if(tls_config_set_key_file(config->getTLSConfig(), privateKeyFile) < 0) {
     throw std::runtime_error("[oatpp::libressl::Config::createDefaultServerConfigShared]: failed call to tls_config_set_key_file()");
@@ -54,6 +117,8 @@ std::shared_ptr<Config> Config::createDefaultServerConfigShared(const char* serv
   if(tls_config_set_cert_file(config->getTLSConfig(), serverCertFile) < 0) {
     throw std::runtime_error("[oatpp::libressl::Config::createDefaultServerConfigShared]: failed call to tls_config_set_cert_file()");
   }
+
+  config->m_certificateType = CertificateIndex::getCertificateType(oatpp::String::loadFromFile(serverCertFile));
   
   return config;
   
@@ -70,12 +135,558 @@ std::shared_ptr<Config> Config::createDefaultClientConfigShared() {
 
 }
 
+std::shared_ptr<Config> Config::cloneWithKeypairFiles(const char* certFile, const char* keyFile) {
+
+  auto config = createDefaultServerConfigShared(certFile, keyFile);
+
+  config->m_readAheadBufferSize = m_readAheadBufferSize;
+  config->m_readBufferSize = m_readBufferSize;
+  config->m_writeBufferSize = m_writeBufferSize;
+  config->m_recordSizePolicy = m_recordSizePolicy;
+  config->m_handshakeWorkerPool = m_handshakeWorkerPool;
+  config->m_handshakeProfiler = m_handshakeProfiler;
+  config->m_serverContextShards = m_serverContextShards;
+
+  if(m_protocols != 0) {
+    config->setProtocols(m_protocols);
+  }
+  if(m_ciphers) {
+    config->setCiphers(m_ciphers);
+  }
+  if(m_alpn) {
+    config->setAlpn(m_alpn);
+  }
+  if(m_sessionId) {
+    config->setSessionId(m_sessionId);
+  }
+  if(m_sessionLifetime >= 0) {
+    config->setSessionLifetime(m_sessionLifetime);
+  }
+  if(m_trustStore) {
+    config->setTrustStore(m_trustStore);
+  }
+  if(m_sessionFd != -1) {
+    config->setSessionFd(m_sessionFd, m_sessionFileMutex);
+  }
+
+  if(m_ocspStapleFile) {
+    config->setOcspStapleFile(m_ocspStapleFile->c_str());
+  } else if(m_ocspStaple) {
+    config->setOcspStaple(m_ocspStaple);
+  }
+
+  {
+    /* same ticket keys - tickets issued before the reload stay valid */
+    std::lock_guard<TicketKeysLock> lock(*m_ticketKeysLock);
+    for(auto& ticketKey : m_ticketKeys) {
+      if(tls_config_add_ticket_key(config->m_config, ticketKey.first, (unsigned char*) ticketKey.second->data(), ticketKey.second->size()) < 0) {
+        throw std::runtime_error("[oatpp::libressl::Config::cloneWithKeypairFiles()]: Error. Failed call to tls_config_add_ticket_key().");
+      }
+    }
+    config->m_ticketKeys = m_ticketKeys;
+    config->m_ticketKeysSet = m_ticketKeysSet.load();
+    /* keypairs are shared - they already have all the settings */
+    std::lock_guard<std::mutex> keypairsLock(m_keypairsMutex);
+    config->m_keypairs = m_keypairs;
+    config->m_certificateIndex = m_certificateIndex;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+    config->m_ticketKeyRevision = m_ticketKeyRevision;
+  }
+
+  return config;
+
+}
+
 Config::~Config(){
+  stopTicketKeyRotation();
   tls_config_free(m_config);
 }
 
 Config::TLSConfig Config::getTLSConfig() {
   return m_config;
 }
+
+void Config::setReadAheadBufferSize(v_buff_size size) {
+  m_readAheadBufferSize = size;
+}
+
+v_buff_size Config::getReadAheadBufferSize() const {
+  return m_readAheadBufferSize;
+}
+
+void Config::setReadBufferSize(v_buff_size size) {
+  m_readBufferSize = size;
+}
+
+v_buff_size Config::getReadBufferSize() const {
+  return m_readBufferSize;
+}
+
+void Config::setWriteBufferSize(v_buff_size size) {
+  m_writeBufferSize = size;
+}
+
+v_buff_size Config::getWriteBufferSize() const {
+  return m_writeBufferSize;
+}
+
+void Config::setRecordSizePolicy(const RecordSizePolicy& policy) {
+  m_recordSizePolicy = policy;
+}
+
+const Config::RecordSizePolicy& Config::getRecordSizePolicy() const {
+  return m_recordSizePolicy;
+}
+
+void Config::setHandshakeWorkerPool(const std::shared_ptr<HandshakeWorkerPool>& pool) {
+  m_handshakeWorkerPool = pool;
+}
+
+std::shared_ptr<HandshakeWorkerPool> Config::getHandshakeWorkerPool() const {
+  return m_handshakeWorkerPool;
+}
+
+void Config::setHandshakeProfiler(const std::shared_ptr<HandshakeProfiler>& profiler) {
+  m_handshakeProfiler = profiler;
+}
+
+std::shared_ptr<HandshakeProfiler> Config::getHandshakeProfiler() const {
+  return m_handshakeProfiler;
+}
+
+oatpp::String Config::getCertificateType() const {
+  return m_certificateType;
+}
   
+void Config::setProtocols(v_uint32 protocols) {
+  m_protocols = protocols;
+  forEachKeypairConfig([protocols](TLSConfig config) {
+    tls_config_set_protocols(config, protocols);
+  });
+}
+
+void Config::setCiphers(const oatpp::String& ciphers) {
+  bool ok = true;
+  forEachKeypairConfig([&ciphers, &ok](TLSConfig config) {
+    ok = ok && tls_config_set_ciphers(config, ciphers->c_str()) == 0;
+  });
+  if(!ok) {
+    throw std::runtime_error("[oatpp::libressl::Config::setCiphers()]: Error. Failed call to tls_config_set_ciphers().");
+  }
+  m_ciphers = ciphers;
+}
+
+void Config::setAlpn(const oatpp::String& protocols) {
+  bool ok = true;
+  forEachKeypairConfig([&protocols, &ok](TLSConfig config) {
+    ok = ok && tls_config_set_alpn(config, protocols->c_str()) == 0;
+  });
+  if(!ok) {
+    throw std::runtime_error("[oatpp::libressl::Config::setAlpn()]: Error. Failed call to tls_config_set_alpn().");
+  }
+  m_alpn = protocols;
+}
+
+oatpp::String Config::getAlpn() const {
+  return m_alpn;
+}
+
+void Config::setSessionId(const oatpp::String& sessionId) {
+  bool ok = true;
+  forEachKeypairConfig([&sessionId, &ok](TLSConfig config) {
+    ok = ok && tls_config_set_session_id(config, (const unsigned char*) sessionId->data(), sessionId->size()) == 0;
+  });
+  if(!ok) {
+    throw std::runtime_error("[oatpp::libressl::Config::setSessionId()]: Error. Failed call to tls_config_set_session_id().");
+  }
+  m_sessionId = sessionId;
+}
+
+void Config::setSessionLifetime(v_int32 seconds) {
+  bool ok = true;
+  forEachKeypairConfig([seconds, &ok](TLSConfig config) {
+    ok = ok && tls_config_set_session_lifetime(config, seconds) == 0;
+  });
+  if(!ok) {
+    throw std::runtime_error("[oatpp::libressl::Config::setSessionLifetime()]: Error. Failed call to tls_config_set_session_lifetime().");
+  }
+  m_sessionLifetime = seconds;
+}
+
+void Config::addTicketKey(v_uint32 keyRevision, const oatpp::String& key) {
+
+  if(!key || key->size() != TLS_TICKET_KEY_SIZE) {
+    throw std::runtime_error("[oatpp::libressl::Config::addTicketKey()]: Error. Invalid key size.");
+  }
+
+  bool ok = true;
+  {
+    std::lock_guard<TicketKeysLock> lock(*m_ticketKeysLock);
+    forEachKeypairConfig([keyRevision, &key, &ok](TLSConfig config) {
+      ok = ok && tls_config_add_ticket_key(config, keyRevision, (unsigned char*) key->data(), key->size()) == 0;
+    });
+    m_ticketKeys.push_back({keyRevision, key});
+    if((v_int32) m_ticketKeys.size() > MAX_STORED_TICKET_KEYS) {
+      m_ticketKeys.pop_front();
+    }
+    m_ticketKeysSet = true;
+  }
+
+  if(!ok) {
+    throw std::runtime_error("[oatpp::libressl::Config::addTicketKey()]: Error. Failed call to tls_config_add_ticket_key().");
+  }
+
+}
+
+void Config::rotateTicketKey() {
+
+  v_char8 key[TLS_TICKET_KEY_SIZE];
+  if(RAND_bytes(key, TLS_TICKET_KEY_SIZE) != 1) {
+    throw std::runtime_error("[oatpp::libressl::Config::rotateTicketKey()]: Error. Failed to generate ticket key.");
+  }
+
+  v_uint32 revision;
+  {
+    std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+    revision = ++ m_ticketKeyRevision;
+  }
+
+  addTicketKey(revision, oatpp::String((const char*) key, TLS_TICKET_KEY_SIZE));
+
+}
+
+void Config::startTicketKeyRotation(const std::chrono::duration<v_int64, std::micro>& interval) {
+
+  stopTicketKeyRotation();
+  rotateTicketKey();
+
+  {
+    std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+    m_ticketKeyRotationRunning = true;
+    m_ticketKeyRotationInterval = interval;
+  }
+
+  m_ticketKeyRotationThread = std::thread([this, interval] {
+
+    std::unique_lock<std::mutex> lock(m_ticketKeyRotationMutex);
+
+    while(m_ticketKeyRotationRunning) {
+
+      auto deadline = std::chrono::steady_clock::now() + interval;
+      while(m_ticketKeyRotationRunning && std::chrono::steady_clock::now() < deadline) {
+        m_ticketKeyRotationCondition.wait_until(lock, deadline);
+      }
+
+      if(m_ticketKeyRotationRunning) {
+        lock.unlock();
+        try {
+          rotateTicketKey();
+        } catch (std::runtime_error& e) {
+          OATPP_LOGE("[oatpp::libressl::Config::startTicketKeyRotation()]", "%s", e.what());
+        }
+        lock.lock();
+      }
+
+    }
+
+  });
+
+}
+
+void Config::stopTicketKeyRotation() {
+
+  {
+    std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+    m_ticketKeyRotationRunning = false;
+  }
+
+  m_ticketKeyRotationCondition.notify_all();
+
+  if(m_ticketKeyRotationThread.joinable()) {
+    m_ticketKeyRotationThread.join();
+  }
+
+}
+
+void Config::takeOverTicketKeyRotation(Config& source) {
+
+  if(&source == this) {
+    return;
+  }
+
+  std::chrono::duration<v_int64, std::micro> interval;
+  {
+    std::lock_guard<std::mutex> lock(source.m_ticketKeyRotationMutex);
+    if(!source.m_ticketKeyRotationRunning) {
+      return;
+    }
+    interval = source.m_ticketKeyRotationInterval;
+  }
+
+  /* source stops first - no key is rotated by both configs */
+  source.stopTicketKeyRotation();
+
+  std::list<std::pair<v_uint32, oatpp::String>> sourceKeys;
+  {
+    std::lock_guard<TicketKeysLock> lock(*source.m_ticketKeysLock);
+    sourceKeys = source.m_ticketKeys;
+  }
+
+  {
+    /* keys rotated by the source after this config got its keys - keypairs shared with the source have them already */
+    std::lock_guard<TicketKeysLock> lock(*m_ticketKeysLock);
+    for(auto& sourceKey : sourceKeys) {
+      bool found = false;
+      for(auto& ticketKey : m_ticketKeys) {
+        if(ticketKey.first == sourceKey.first) {
+          found = true;
+          break;
+        }
+      }
+      if(!found) {
+        if(tls_config_add_ticket_key(m_config, sourceKey.first, (unsigned char*) sourceKey.second->data(), sourceKey.second->size()) < 0) {
+          throw std::runtime_error("[oatpp::libressl::Config::takeOverTicketKeyRotation()]: Error. Failed call to tls_config_add_ticket_key().");
+        }
+        m_ticketKeys.push_back(sourceKey);
+        if((v_int32) m_ticketKeys.size() > MAX_STORED_TICKET_KEYS) {
+          m_ticketKeys.pop_front();
+        }
+        m_ticketKeysSet = true;
+      }
+    }
+  }
+
+  v_uint32 revision;
+  {
+    std::lock_guard<std::mutex> lock(source.m_ticketKeyRotationMutex);
+    revision = source.m_ticketKeyRevision;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+    if(revision > m_ticketKeyRevision) {
+      m_ticketKeyRevision = revision;
+    }
+  }
+
+  startTicketKeyRotation(interval);
+
+}
+
+bool Config::isTicketKeyRotationRunning() const {
+  std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+  return m_ticketKeyRotationRunning;
+}
+
+v_uint32 Config::getTicketKeyRevision() const {
+  std::lock_guard<std::mutex> lock(m_ticketKeyRotationMutex);
+  return m_ticketKeyRevision;
+}
+
+std::shared_ptr<Config::TicketKeysLock> Config::getTicketKeysLock() const {
+  /* without ticket keys there is nothing to rotate - handshakes skip the lock */
+  if(!m_ticketKeysSet) {
+    return nullptr;
+  }
+  return m_ticketKeysLock;
+}
+
+void Config::setSessionFd(int fd, const std::shared_ptr<std::mutex>& fileMutex) {
+
+  if(tls_config_set_session_fd(m_config, fd) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::setSessionFd()]: Error. Failed call to tls_config_set_session_fd().");
+  }
+
+  m_sessionFd = fd;
+
+  if(fileMutex) {
+    m_sessionFileMutex = fileMutex;
+  } else {
+    m_sessionFileMutex = std::make_shared<std::mutex>();
+  }
+
+}
+
+std::shared_ptr<std::mutex> Config::getSessionFileMutex() const {
+  return m_sessionFileMutex;
+}
+
+int Config::getSessionFd() const {
+  return m_sessionFd;
+}
+
+void Config::setTrustStore(const std::shared_ptr<TrustStore>& trustStore) {
+  if(trustStore) {
+    tls_config_insecure_noverifycert(m_config);
+  } else if(m_trustStore) {
+    /* verification was turned off for the trust store - don't leave the config without any */
+    tls_config_verify(m_config);
+  }
+  m_trustStore = trustStore;
+}
+
+std::shared_ptr<TrustStore> Config::getTrustStore() const {
+  return m_trustStore;
+}
+
+void Config::setOcspStaple(const oatpp::String& staple) {
+  if(!staple || tls_config_set_ocsp_staple_mem(m_config, (const uint8_t*) staple->data(), staple->size()) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::setOcspStaple()]: Error. Failed call to tls_config_set_ocsp_staple_mem().");
+  }
+  m_ocspStaple = staple;
+  m_ocspStapleFile = nullptr;
+}
+
+void Config::setOcspStapleFile(const char* filename) {
+  auto staple = oatpp::String::loadFromFile(filename);
+  if(!staple) {
+    throw std::runtime_error("[oatpp::libressl::Config::setOcspStapleFile()]: Error. Can't read OCSP staple file.");
+  }
+  setOcspStaple(staple);
+  m_ocspStapleFile = filename;
+}
+
+oatpp::String Config::getOcspStaple() const {
+  return m_ocspStaple;
+}
+
+void Config::setServerContextShards(v_int32 shards) {
+  m_serverContextShards = shards < 1 ? 1 : shards;
+}
+
+v_int32 Config::getServerContextShards() const {
+  return m_serverContextShards;
+}
+
+void Config::forEachKeypairConfig(const std::function<void(TLSConfig)>& callback) {
+  callback(m_config);
+  std::lock_guard<std::mutex> lock(m_keypairsMutex);
+  auto it = m_keypairs.begin();
+  while(it != m_keypairs.end()) {
+    auto keypair = it->lock();
+    if(keypair) {
+      callback(keypair->getTLSConfig());
+      it ++;
+    } else {
+      it = m_keypairs.erase(it);
+    }
+  }
+}
+
+void Config::applyKeypairSettings(TLSConfig config) {
+
+  if(m_protocols != 0) {
+    tls_config_set_protocols(config, m_protocols);
+  }
+
+  if(m_ciphers && tls_config_set_ciphers(config, m_ciphers->c_str()) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::applyKeypairSettings()]: Error. Failed call to tls_config_set_ciphers().");
+  }
+
+  if(m_alpn && tls_config_set_alpn(config, m_alpn->c_str()) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::applyKeypairSettings()]: Error. Failed call to tls_config_set_alpn().");
+  }
+
+  if(m_sessionId && tls_config_set_session_id(config, (const unsigned char*) m_sessionId->data(), m_sessionId->size()) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::applyKeypairSettings()]: Error. Failed call to tls_config_set_session_id().");
+  }
+
+  if(m_sessionLifetime >= 0 && tls_config_set_session_lifetime(config, m_sessionLifetime) < 0) {
+    throw std::runtime_error("[oatpp::libressl::Config::applyKeypairSettings()]: Error. Failed call to tls_config_set_session_lifetime().");
+  }
+
+  for(auto& ticketKey : m_ticketKeys) {
+    tls_config_add_ticket_key(config, ticketKey.first, (unsigned char*) ticketKey.second->data(), ticketKey.second->size());
+  }
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> Config::createKeypair(const oatpp::String& certPem,
+                                                                 const oatpp::String& keyPem,
+                                                                 const std::vector<oatpp::String>& names)
+{
+
+  if(!certPem || !keyPem) {
+    throw std::runtime_error("[oatpp::libressl::Config::createKeypair()]: Error. Empty certificate or key.");
+  }
+
+  auto keypairNames = names.empty() ? CertificateIndex::getCertificateNames(certPem) : names;
+  if(keypairNames.empty()) {
+    throw std::runtime_error("[oatpp::libressl::Config::createKeypair()]: Error. Certificate has no names.");
+  }
+
+  TLSConfig config = tls_config_new();
+  if(config == nullptr) {
+    throw std::runtime_error("[oatpp::libressl::Config::createKeypair()]: Error. Failed call to tls_config_new().");
+  }
+
+  auto keypair = std::make_shared<CertificateIndex::Keypair>(config, keypairNames);
+  keypair->setCertificateType(CertificateIndex::getCertificateType(certPem));
+
+  if(tls_config_set_keypair_mem(config, (const uint8_t*) certPem->data(), certPem->size(),
+                                        (const uint8_t*) keyPem->data(), keyPem->size()) < 0)
+  {
+    throw std::runtime_error("[oatpp::libressl::Config::createKeypair()]: Error. Failed call to tls_config_set_keypair_mem().");
+  }
+
+  {
+    /* ticket keys must not change between applying the settings and registering the keypair */
+    std::lock_guard<TicketKeysLock> lock(*m_ticketKeysLock);
+    applyKeypairSettings(config);
+    std::lock_guard<std::mutex> keypairsLock(m_keypairsMutex);
+    /* providers create keypairs on every cache miss - drop the ones they released */
+    auto it = m_keypairs.begin();
+    while(it != m_keypairs.end()) {
+      if(it->expired()) {
+        it = m_keypairs.erase(it);
+      } else {
+        it ++;
+      }
+    }
+    m_keypairs.push_back(keypair);
+  }
+
+  return keypair;
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> Config::addCertificate(const oatpp::String& certPem,
+                                                                  const oatpp::String& keyPem,
+                                                                  const std::vector<oatpp::String>& names)
+{
+
+  auto keypair = createKeypair(certPem, keyPem, names);
+
+  if(!m_certificateIndex) {
+    m_certificateIndex = std::make_shared<CertificateIndex>();
+  }
+  m_certificateIndex->add(keypair);
+
+  return keypair;
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> Config::addCertificateFile(const char* certFile,
+                                                                      const char* keyFile,
+                                                                      const std::vector<oatpp::String>& names)
+{
+
+  auto certPem = oatpp::String::loadFromFile(certFile);
+  auto keyPem = oatpp::String::loadFromFile(keyFile);
+
+  if(!certPem || !keyPem) {
+    throw std::runtime_error("[oatpp::libressl::Config::addCertificateFile()]: Error. Can't read certificate or key file.");
+  }
+
+  return addCertificate(certPem, keyPem, names);
+
+}
+
+std::shared_ptr<CertificateIndex> Config::getCertificateIndex() const {
+  return m_certificateIndex;
+}
+
 }}
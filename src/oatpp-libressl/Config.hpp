@@ -25,21 +25,150 @@
 #ifndef oatpp_libressl_Config_hpp
 #define oatpp_libressl_Config_hpp
 
+#include "CertificateIndex.hpp"
+#include "HandshakeWorkerPool.hpp"
+#include "TrustStore.hpp"
+
 #include "oatpp/core/Types.hpp"
 
 #include <tls.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace oatpp { namespace libressl {
 
+class HandshakeProfiler;
+
 /**
  * Wrapper over `tls_config`.
  */
 class Config {
 public:
   typedef struct tls_config* TLSConfig;
+public:
+
+  /**
+   * Dynamic TLS record sizing policy. <br>
+   * New and recently idle connections send small records so that the peer can decrypt first bytes
+   * as soon as the first TCP segment arrives. Once enough bytes are sent, connection switches to max-size (16KB)
+   * records for throughput.
+   */
+  struct RecordSizePolicy {
+
+    /**
+     * Record size used for new and recently idle connections. `0` - dynamic record sizing is disabled.
+     */
+    v_buff_size smallRecordSize;
+
+    /**
+     * Number of bytes sent in small records before switching to max-size records.
+     */
+    v_int64 bytesThreshold;
+
+    /**
+     * Idle time in microseconds after which the connection goes back to small records.
+     */
+    v_int64 idleTimeout;
+
+    /**
+     * Constructor.
+     * @param pSmallRecordSize - record size for new and recently idle connections. `0` - disable dynamic record sizing.
+     * Default `1400` bytes - fits one TCP segment.
+     * @param pBytesThreshold - number of bytes to send in small records before switching to max-size records.
+     * @param pIdleTimeout - idle time in microseconds after which the connection goes back to small records.
+     */
+    RecordSizePolicy(v_buff_size pSmallRecordSize = 1400, v_int64 pBytesThreshold = 1024 * 1024, v_int64 pIdleTimeout = 1000 * 1000);
+
+  };
+
+  /**
+   * Lock over the session ticket keys of the config. <br>
+   * libtls reads ticket keys during the handshake without any synchronization,
+   * so handshakes take this lock shared, while &l:Config::rotateTicketKey (); takes it exclusively.
+   */
+  class TicketKeysLock {
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    v_int32 m_readers;
+    bool m_writer;
+    v_int32 m_writersWaiting;
+  public:
+
+    /**
+     * Constructor.
+     */
+    TicketKeysLock();
+
+    /**
+     * Lock shared - for a handshake step.
+     */
+    void lockShared();
+
+    /**
+     * Unlock shared.
+     */
+    void unlockShared();
+
+    /**
+     * Lock exclusively - for ticket keys modification. Waiting writer blocks new shared locks.
+     */
+    void lock();
+
+    /**
+     * Unlock exclusive.
+     */
+    void unlock();
+
+  };
+
 private:
   TLSConfig m_config;
+private:
+  v_buff_size m_readAheadBufferSize;
+  v_buff_size m_readBufferSize;
+  v_buff_size m_writeBufferSize;
+  RecordSizePolicy m_recordSizePolicy;
+  std::shared_ptr<HandshakeWorkerPool> m_handshakeWorkerPool;
+  std::shared_ptr<HandshakeProfiler> m_handshakeProfiler;
+  oatpp::String m_certificateType;
+private:
+  std::shared_ptr<TicketKeysLock> m_ticketKeysLock;
+  std::atomic<bool> m_ticketKeysSet;
+  v_uint32 m_ticketKeyRevision;
+  std::thread m_ticketKeyRotationThread;
+  mutable std::mutex m_ticketKeyRotationMutex;
+  std::condition_variable m_ticketKeyRotationCondition;
+  bool m_ticketKeyRotationRunning;
+  std::chrono::duration<v_int64, std::micro> m_ticketKeyRotationInterval;
+private:
+  int m_sessionFd;
+  std::shared_ptr<std::mutex> m_sessionFileMutex;
+  std::shared_ptr<TrustStore> m_trustStore;
+  v_int32 m_serverContextShards;
+  oatpp::String m_ocspStaple;
+  oatpp::String m_ocspStapleFile;
+private:
+  /* settings which are also applied to the configs of keypairs added with addCertificate() */
+  v_uint32 m_protocols;
+  oatpp::String m_ciphers;
+  oatpp::String m_alpn;
+  oatpp::String m_sessionId;
+  v_int32 m_sessionLifetime;
+  std::list<std::pair<v_uint32, oatpp::String>> m_ticketKeys;
+  std::mutex m_keypairsMutex;
+  std::list<std::weak_ptr<CertificateIndex::Keypair>> m_keypairs;
+  std::shared_ptr<CertificateIndex> m_certificateIndex;
+private:
+  void applyKeypairSettings(TLSConfig config);
+  void forEachKeypairConfig(const std::function<void(TLSConfig)>& callback);
 public:
   /**
    * Constructor.
@@ -73,6 +202,20 @@ public:
    */
   static std::shared_ptr<Config> createDefaultClientConfigShared();
 
+  /**
+   * Create server config with the settings of this config and another keypair - for certificate reload. <br>
+   * Carries over the settings made with this class: buffer sizes, record size policy, handshake worker pool and profiler,
+   * protocols, ciphers, ALPN, session ID, session lifetime, ticket keys, trust store, server context shards,
+   * keypairs added with &l:Config::addCertificate (); and the OCSP staple - re-read from the file if it was set with
+   * &l:Config::setOcspStapleFile ();. <br>
+   * Settings made with direct `tls_config_*` calls on &l:Config::getTLSConfig (); are not carried over. <br>
+   * Ticket key rotation is not started on the clone - hand it over with &l:Config::takeOverTicketKeyRotation (); once the clone is in use.
+   * @param certFile - path to the certificate file.
+   * @param keyFile - path to the private key file.
+   * @return - new &l:Config;.
+   */
+  std::shared_ptr<Config> cloneWithKeypairFiles(const char* certFile, const char* keyFile);
+
   /**
    * Virtual destructor.
    */
@@ -83,6 +226,321 @@ public:
    * @return - `tls_config*`.
    */
   TLSConfig getTLSConfig();
+
+  /**
+   * Set size of the per-connection ciphertext read-ahead buffer. <br>
+   * When set, each connection reads as much ciphertext as the transport has (up to `size` bytes) in one call
+   * and feeds libtls from memory, instead of doing separate transport reads for the record header and the record body. <br>
+   * `0` - disable read-ahead (default).
+   * @param size - buffer size in bytes.
+   */
+  void setReadAheadBufferSize(v_buff_size size);
+
+  /**
+   * Get size of the per-connection ciphertext read-ahead buffer.
+   * @return - buffer size in bytes. `0` if read-ahead is disabled.
+   */
+  v_buff_size getReadAheadBufferSize() const;
+
+  /**
+   * Set size of the per-connection plaintext read buffer. <br>
+   * When set, small reads decrypt a whole record at once and subsequent reads are served from memory. <br>
+   * `0` - disable buffering (default).
+   * @param size - buffer size in bytes.
+   */
+  void setReadBufferSize(v_buff_size size);
+
+  /**
+   * Get size of the per-connection plaintext read buffer.
+   * @return - buffer size in bytes. `0` if buffering is disabled.
+   */
+  v_buff_size getReadBufferSize() const;
+
+  /**
+   * Set size of the per-connection write buffer. <br>
+   * When set, writes of the corked connection are gathered and sent in full-size TLS records. See &id:oatpp::libressl::Connection::cork;. <br>
+   * `0` - disable buffering (default).
+   * @param size - buffer size in bytes.
+   */
+  void setWriteBufferSize(v_buff_size size);
+
+  /**
+   * Get size of the per-connection write buffer.
+   * @return - buffer size in bytes. `0` if buffering is disabled.
+   */
+  v_buff_size getWriteBufferSize() const;
+
+  /**
+   * Set dynamic TLS record sizing policy for connections. Disabled by default.
+   * @param policy - &l:Config::RecordSizePolicy;.
+   */
+  void setRecordSizePolicy(const RecordSizePolicy& policy);
+
+  /**
+   * Get dynamic TLS record sizing policy.
+   * @return - &l:Config::RecordSizePolicy;.
+   */
+  const RecordSizePolicy& getRecordSizePolicy() const;
+
+  /**
+   * Set pool to run asynchronous handshake steps on. <br>
+   * When set, private-key operations of the handshake don't block executor threads,
+   * so established connections keep being served during bursts of new connections. <br>
+   * `nullptr` - run handshake on the executor thread (default).
+   * @param pool - &id:oatpp::libressl::HandshakeWorkerPool;.
+   */
+  void setHandshakeWorkerPool(const std::shared_ptr<HandshakeWorkerPool>& pool);
+
+  /**
+   * Get pool to run asynchronous handshake steps on.
+   * @return - &id:oatpp::libressl::HandshakeWorkerPool;. `nullptr` if not set.
+   */
+  std::shared_ptr<HandshakeWorkerPool> getHandshakeWorkerPool() const;
+
+  /**
+   * Set profiler to record phases of the handshakes of connections using this config. <br>
+   * `nullptr` - don't profile (default).
+   * @param profiler - &id:oatpp::libressl::HandshakeProfiler;.
+   */
+  void setHandshakeProfiler(const std::shared_ptr<HandshakeProfiler>& profiler);
+
+  /**
+   * Get handshake profiler.
+   * @return - &id:oatpp::libressl::HandshakeProfiler;. `nullptr` if not set.
+   */
+  std::shared_ptr<HandshakeProfiler> getHandshakeProfiler() const;
+
+  /**
+   * Get key type of the server certificate. Known for configs created with &l:Config::createDefaultServerConfigShared ();.
+   * See &id:oatpp::libressl::CertificateIndex::getCertificateType;.
+   * @return - certificate type. `nullptr` if not known.
+   */
+  oatpp::String getCertificateType() const;
+
+  /**
+   * Set protocols - `tls_config_set_protocols`. <br>
+   * Unlike direct call to `tls_config_set_protocols`, also applies to keypairs added with &l:Config::addCertificate ();.
+   * @param protocols - `TLS_PROTOCOL_*` flags.
+   */
+  void setProtocols(v_uint32 protocols);
+
+  /**
+   * Set ciphers - `tls_config_set_ciphers`. <br>
+   * Unlike direct call to `tls_config_set_ciphers`, also applies to keypairs added with &l:Config::addCertificate ();.
+   * @param ciphers - cipher list. Ex.: `"secure"`.
+   */
+  void setCiphers(const oatpp::String& ciphers);
+
+  /**
+   * Set ALPN protocols - `tls_config_set_alpn`. <br>
+   * Client offers the protocols, server selects the first protocol of its list which the client offers.
+   * Negotiated protocol is published in the connection context properties as `"tls_alpn"`. <br>
+   * Also applies to keypairs added with &l:Config::addCertificate ();.
+   * @param protocols - comma-separated list in the order of preference. Ex.: `"h2,http/1.1"`.
+   */
+  void setAlpn(const oatpp::String& protocols);
+
+  /**
+   * Get ALPN protocols.
+   * @return - comma-separated list. `nullptr` if not set.
+   */
+  oatpp::String getAlpn() const;
+
+  /**
+   * Set session ID context - `tls_config_set_session_id`. <br>
+   * Server only. Sessions are resumed only by servers with the same session ID context.
+   * @param sessionId - session ID context. Max `TLS_MAX_SESSION_ID_LENGTH` bytes.
+   */
+  void setSessionId(const oatpp::String& sessionId);
+
+  /**
+   * Set session lifetime - `tls_config_set_session_lifetime`. <br>
+   * Server only. Session resumption (both session IDs and session tickets) is enabled only when the lifetime is set. <br>
+   * If no ticket keys are added, libtls generates and rotates ticket keys automatically.
+   * @param seconds - session lifetime in seconds. `0` - disable session resumption (default).
+   */
+  void setSessionLifetime(v_int32 seconds);
+
+  /**
+   * Add session ticket key - `tls_config_add_ticket_key`. <br>
+   * New key is used to encrypt new tickets. Up to three previous keys are kept to decrypt tickets issued before.
+   * @param keyRevision - key revision. Must be unique among the keys of the config.
+   * @param key - key of `TLS_TICKET_KEY_SIZE` (48) bytes.
+   */
+  void addTicketKey(v_uint32 keyRevision, const oatpp::String& key);
+
+  /**
+   * Generate random session ticket key and add it as the next key revision.
+   */
+  void rotateTicketKey();
+
+  /**
+   * Start background thread which calls &l:Config::rotateTicketKey (); every `interval`. <br>
+   * The first key is added immediately. Since previous keys are kept, tickets stay valid for up to three rotation intervals.
+   * Make sure the interval is consistent with &l:Config::setSessionLifetime ();.
+   * @param interval - rotation interval.
+   */
+  void startTicketKeyRotation(const std::chrono::duration<v_int64, std::micro>& interval);
+
+  /**
+   * Stop ticket key rotation thread and join it. Called automatically in the destructor.
+   */
+  void stopTicketKeyRotation();
+
+  /**
+   * Move ticket key rotation of the `source` config to this config - for certificate reload. <br>
+   * Rotation of the source is stopped first, then this config gets the keys rotated by the source meanwhile,
+   * continues its revision counter and starts rotating with the same interval. So only one of the configs rotates keys at a time. <br>
+   * Nothing is done if the source doesn't rotate keys.
+   * @param source - config which rotates ticket keys now.
+   */
+  void takeOverTicketKeyRotation(Config& source);
+
+  /**
+   * Check if ticket key rotation thread is running.
+   * @return
+   */
+  bool isTicketKeyRotationRunning() const;
+
+  /**
+   * Get revision of the last ticket key added by &l:Config::rotateTicketKey ();.
+   * @return
+   */
+  v_uint32 getTicketKeyRevision() const;
+
+  /**
+   * Get lock over the session ticket keys. Used by connections to synchronize handshakes with key rotation. <br>
+   * Handshakes need it only once ticket keys are set - add the first key (or start the rotation) before accepting connections.
+   * @return - &l:Config::TicketKeysLock;. `nullptr` if no ticket keys were added.
+   */
+  std::shared_ptr<TicketKeysLock> getTicketKeysLock() const;
+
+  /**
+   * Set client session file - `tls_config_set_session_fd`. <br>
+   * libtls reads the session from the file when a client connection starts and writes the new session
+   * to the file when the handshake completes. Connections of this config hold `fileMutex` only for these two steps. <br>
+   * The file is bound to the whole config - all connections of the config resume the same session. <br>
+   * Client only. See also &id:oatpp::libressl::client::SessionCache;.
+   * @param fd - file descriptor of a regular file with `0600` permissions. Empty file means no session.
+   * @param fileMutex - mutex guarding the file. Pass the same mutex to all configs sharing the file.
+   * `nullptr` - create new mutex.
+   */
+  void setSessionFd(int fd, const std::shared_ptr<std::mutex>& fileMutex = nullptr);
+
+  /**
+   * Get mutex guarding the client session file.
+   * @return - `std::shared_ptr` to mutex. `nullptr` if session file is not set.
+   */
+  std::shared_ptr<std::mutex> getSessionFileMutex() const;
+
+  /**
+   * Get client session file descriptor.
+   * @return - file descriptor. `-1` if session file is not set.
+   */
+  int getSessionFd() const;
+
+  /**
+   * Set shared pre-parsed trust store for client connections. <br>
+   * libtls chain verification is turned off for this config (`tls_config_insecure_noverifycert`), and connections verify
+   * the server certificate chain against the trust store once the handshake is complete. Connection fails if the chain is not trusted.
+   * Server name is still verified by libtls - unless `tls_config_insecure_noverifyname` is set. <br>
+   * Client only.
+   * @param trustStore - &id:oatpp::libressl::TrustStore;. `nullptr` - clear the trust store set before
+   * and turn libtls verification back on (`tls_config_verify` - it also turns server name verification on).
+   */
+  void setTrustStore(const std::shared_ptr<TrustStore>& trustStore);
+
+  /**
+   * Get shared trust store.
+   * @return - &id:oatpp::libressl::TrustStore;. `nullptr` if not set.
+   */
+  std::shared_ptr<TrustStore> getTrustStore() const;
+
+  /**
+   * Set OCSP response to staple in the handshake - `tls_config_set_ocsp_staple_mem`. <br>
+   * Clients get the certificate status with the handshake and don't have to query the OCSP responder themselves. <br>
+   * Must be set before the config is used by a provider - to replace the staple of a running server
+   * use &id:oatpp::libressl::server::OcspStapleRefresher;. <br>
+   * Server only.
+   * @param staple - DER-encoded OCSP response.
+   */
+  void setOcspStaple(const oatpp::String& staple);
+
+  /**
+   * Set OCSP response to staple in the handshake from file. See &l:Config::setOcspStaple ();.
+   * @param filename - path to the DER-encoded OCSP response.
+   */
+  void setOcspStapleFile(const char* filename);
+
+  /**
+   * Get OCSP response set with &l:Config::setOcspStaple (); or &l:Config::setOcspStapleFile ();.
+   * @return - DER-encoded OCSP response. `nullptr` if not set.
+   */
+  oatpp::String getOcspStaple() const;
+
+  /**
+   * Set number of `tls_server` contexts created by &id:oatpp::libressl::server::ConnectionProvider; for this config. <br>
+   * Accepted connections are assigned to the contexts round-robin, so concurrent handshakes are spread over
+   * several SSL_CTX instead of sharing the locks of one. Whether it pays off depends on the libressl build and the load -
+   * measure before raising it. <br>
+   * *Note: session ID cache is per context - use session tickets for resumption across shards.* <br>
+   * Server only. Default - `1`.
+   * @param shards - number of contexts.
+   */
+  void setServerContextShards(v_int32 shards);
+
+  /**
+   * Get number of `tls_server` contexts.
+   * @return
+   */
+  v_int32 getServerContextShards() const;
+
+  /**
+   * Create server keypair with its own `tls_config` - for &id:oatpp::libressl::server::CertificateProvider; implementations. <br>
+   * The keypair gets protocols, ciphers, session ID context, session lifetime and ticket keys of this config,
+   * and is kept in sync with them (including ticket key rotation) for as long as it's alive. <br>
+   * Safe to call from handshake threads.
+   * @param certPem - PEM-encoded certificate (chain).
+   * @param keyPem - PEM-encoded private key.
+   * @param names - host names to serve with the keypair. Empty - take names from the certificate.
+   * @return - &id:oatpp::libressl::CertificateIndex::Keypair;.
+   */
+  std::shared_ptr<CertificateIndex::Keypair> createKeypair(const oatpp::String& certPem,
+                                                           const oatpp::String& keyPem,
+                                                           const std::vector<oatpp::String>& names = {});
+
+  /**
+   * Add server keypair selected by SNI. <br>
+   * The keypair is created with &l:Config::createKeypair ();. Handshakes with the server name matching the keypair
+   * are accepted on the `tls_server` context of the keypair, while other handshakes use the default keypair of this config. <br>
+   * Lookup cost doesn't depend on the number of keypairs - see &id:oatpp::libressl::CertificateIndex;. <br>
+   * Server only.
+   * @param certPem - PEM-encoded certificate (chain).
+   * @param keyPem - PEM-encoded private key.
+   * @param names - host names to serve with the keypair. Wildcards are allowed - `*.example.com`.
+   * Empty - take names from the certificate.
+   * @return - &id:oatpp::libressl::CertificateIndex::Keypair;.
+   */
+  std::shared_ptr<CertificateIndex::Keypair> addCertificate(const oatpp::String& certPem,
+                                                            const oatpp::String& keyPem,
+                                                            const std::vector<oatpp::String>& names = {});
+
+  /**
+   * Add server keypair selected by SNI. See &l:Config::addCertificate ();.
+   * @param certFile - path to PEM-encoded certificate (chain).
+   * @param keyFile - path to PEM-encoded private key.
+   * @param names - host names to serve with the keypair. Empty - take names from the certificate.
+   * @return - &id:oatpp::libressl::CertificateIndex::Keypair;.
+   */
+  std::shared_ptr<CertificateIndex::Keypair> addCertificateFile(const char* certFile,
+                                                                const char* keyFile,
+                                                                const std::vector<oatpp::String>& names = {});
+
+  /**
+   * Get index of keypairs added with &l:Config::addCertificate ();.
+   * @return - &id:oatpp::libressl::CertificateIndex;. `nullptr` if no keypairs were added.
+   */
+  std::shared_ptr<CertificateIndex> getCertificateIndex() const;
   
 };
   
@@ -23,10 +23,180 @@
  ***************************************************************************/
 
 #include "Connection.hpp"
+#include "ConnectionStatistics.hpp"
+#include "HandshakeProfiler.hpp"
+
+#include "oatpp/core/async/CoroutineWaitList.hpp"
+#include "oatpp/core/base/Environment.hpp"
+
 #include <openssl/err.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
 namespace oatpp { namespace libressl {
 
+namespace {
+
+/* Max size of TLS record payload */
+const v_buff_size MAX_RECORD_SIZE = 16384;
+
+/* TLS record header - content type (1), version (2), length (2) */
+const v_buff_size RECORD_HEADER_SIZE = 5;
+
+/* Size of the ciphertext staged for the blocking transport - one full record with the cipher expansion */
+const v_buff_size STAGED_BUFFER_SIZE = RECORD_HEADER_SIZE + MAX_RECORD_SIZE + 256;
+
+/* Handshake slot is held by another initializer of the same connection - check again after this time */
+const v_int64 HANDSHAKE_SLOT_WAIT_MICRO = 1000;
+
+/* tls_close() calls made to send close_notify while the transport asks to retry without an event to wait for */
+const v_int32 CLOSE_NOTIFY_ATTEMPTS = 3;
+
+const v_char8 RECORD_TYPE_HANDSHAKE = 22;
+const v_char8 HANDSHAKE_TYPE_CLIENT_HELLO = 1;
+const v_uint16 EXTENSION_SERVER_NAME = 0;
+const v_char8 SERVER_NAME_TYPE_HOST_NAME = 0;
+
+v_uint32 readUInt(const v_char8* data, v_buff_size bytes) {
+  v_uint32 result = 0;
+  for(v_buff_size i = 0; i < bytes; i ++) {
+    result = (result << 8) | data[i];
+  }
+  return result;
+}
+
+/* ClientHello records are read up to this size - far above any real hello */
+const v_buff_size MAX_CLIENT_HELLO_SIZE = 4 * (RECORD_HEADER_SIZE + MAX_RECORD_SIZE);
+
+/*
+ * Reassemble the ClientHello handshake message from the records read so far.
+ * Returns `0` when the message is complete in `message` (with the handshake header),
+ * the size of records needed to go further, or `-1` if records are not a ClientHello.
+ */
+v_buff_size reassembleClientHello(const v_char8* data, v_buff_size size, std::string& message) {
+
+  message.clear();
+  v_buff_size pos = 0;
+
+  while(true) {
+
+    if(pos + RECORD_HEADER_SIZE > size) {
+      return pos + RECORD_HEADER_SIZE;
+    }
+
+    v_buff_size recordSize = readUInt(data + pos + 3, 2);
+    if(data[pos] != RECORD_TYPE_HANDSHAKE || recordSize == 0 || recordSize > MAX_RECORD_SIZE) {
+      return -1;
+    }
+
+    if(pos + RECORD_HEADER_SIZE + recordSize > size) {
+      return pos + RECORD_HEADER_SIZE + recordSize;
+    }
+
+    message.append((const char*) data + pos + RECORD_HEADER_SIZE, recordSize);
+    pos += RECORD_HEADER_SIZE + recordSize;
+
+    /* handshake type (1), length (3) */
+    if(message.size() >= 4) {
+      if((v_char8) message[0] != HANDSHAKE_TYPE_CLIENT_HELLO) {
+        return -1;
+      }
+      v_buff_size messageSize = 4 + readUInt((const v_char8*) message.data() + 1, 3);
+      if((v_buff_size) message.size() >= messageSize) {
+        message.resize(messageSize);
+        return 0;
+      }
+    }
+
+  }
+
+}
+
+/*
+ * Find host name of the server_name extension in the complete ClientHello message (with the handshake header).
+ * Returns false if the message is malformed. `name` is set to nullptr if there is no host name in it.
+ */
+bool parseServerName(const v_char8* data, v_buff_size size, const char** name, v_buff_size* nameSize) {
+
+  *name = nullptr;
+  *nameSize = 0;
+
+  /* handshake type (1), length (3), client version (2), random (32) */
+  v_buff_size pos = 38;
+  if(size < pos || data[0] != HANDSHAKE_TYPE_CLIENT_HELLO) {
+    return false;
+  }
+
+  /* session id */
+  if(pos + 1 > size) return false;
+  pos += 1 + data[pos];
+
+  /* cipher suites */
+  if(pos + 2 > size) return false;
+  pos += 2 + readUInt(data + pos, 2);
+
+  /* compression methods */
+  if(pos + 1 > size) return false;
+  pos += 1 + data[pos];
+
+  /* no extensions at all */
+  if(pos == size) return true;
+
+  /* extensions */
+  if(pos + 2 > size) return false;
+  v_buff_size extensionsEnd = pos + 2 + readUInt(data + pos, 2);
+  pos += 2;
+  if(extensionsEnd > size) {
+    return false;
+  }
+
+  while(pos + 4 <= extensionsEnd) {
+
+    v_uint16 type = (v_uint16) readUInt(data + pos, 2);
+    v_buff_size length = readUInt(data + pos + 2, 2);
+    pos += 4;
+
+    if(pos + length > extensionsEnd) {
+      return false;
+    }
+
+    if(type == EXTENSION_SERVER_NAME) {
+      /* server name list length (2), name type (1), name length (2), name */
+      v_buff_size listPos = pos + 2;
+      v_buff_size listEnd = pos + length;
+      if(listPos > listEnd) {
+        return false;
+      }
+      while(listPos + 3 <= listEnd) {
+        v_char8 nameType = data[listPos];
+        v_buff_size nameLength = readUInt(data + listPos + 1, 2);
+        listPos += 3;
+        if(listPos + nameLength > listEnd) {
+          return false;
+        }
+        if(nameType == SERVER_NAME_TYPE_HOST_NAME && nameLength > 0) {
+          *name = (const char*) data + listPos;
+          *nameSize = nameLength;
+          return true;
+        }
+        listPos += nameLength;
+      }
+      return true;
+    }
+
+    pos += length;
+
+  }
+
+  return pos == extensionsEnd;
+
+}
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ConnectionContext
 
@@ -38,109 +208,223 @@ Connection::ConnectionContext::ConnectionContext(Connection* connection, data::s
 
 void Connection::ConnectionContext::init() {
 
+  /*
+   * Context is initialized only when the handshake is complete - a handshake left IN_PROGRESS
+   * (non-blocking transport, or the handshake slot held by another initializer) is continued by the next init().
+   */
   if(!m_connection->m_initialized) {
 
-    m_connection->m_initialized = true;
+    if(!m_connection->initTLS()) {
+      return;
+    }
+
+    async::Action action;
+    IOSlotGuard guard(m_connection->m_handshakeSlot, &action);
+
+    if(!guard.isAcquired()) {
+      return;
+    }
+
+    v_io_size res;
+    do {
+      res = guard.complete(m_connection->completeHandshake());
+    } while((res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) && action.isNone());
 
-    auto tlsObject = m_connection->m_tlsObject;
+    if(res == 0) {
+      m_connection->publishHandshakeProperties();
+    }
+
+  }
 
-    if (tlsObject->getType() == TLSObject::Type::SERVER) {
+}
 
-      auto res = tls_accept_cbs(tlsObject->getTLSHandle(), &m_connection->m_tlsHandle, readCallback, writeCallback, m_connection);
+async::CoroutineStarter Connection::ConnectionContext::initAsync() {
 
-      if (res != 0) {
-        OATPP_LOGD("[oatpp::libressl::Connection::ConnectionContext::init()]", "Error on call to 'tls_accept_cbs'. res=%d", res);
+  /*
+   * State of the handshake step executed on the HandshakeWorkerPool thread.
+   * Coroutine waiting for the step is woken either by the worker or - if the step was done before
+   * the coroutine got to the wait list - by onNewItem(). Both check `done` under the same mutex.
+   */
+  struct OffloadedStep : public async::CoroutineWaitList::Listener {
+    std::mutex mutex;
+    bool done;
+    bool cancelled;
+    bool slotBusy;
+    v_io_size result;
+    async::Action action;
+    async::CoroutineWaitList waitList;
+    OffloadedStep()
+      : done(false)
+      , cancelled(false)
+      , slotBusy(false)
+      , result(0)
+    {
+      waitList.setListener(this);
+    }
+    void onNewItem(async::CoroutineWaitList& list) override {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(done) {
+        list.notifyAll();
       }
+    }
+  };
 
-    } else if (tlsObject->getType() == TLSObject::Type::CLIENT) {
+  class HandshakeCoroutine : public oatpp::async::Coroutine<HandshakeCoroutine> {
+  private:
+    Connection* m_connection;
+    std::shared_ptr<HandshakeWorkerPool> m_workerPool;
+    std::shared_ptr<OffloadedStep> m_step;
+  private:
 
-      m_connection->m_tlsHandle = tlsObject->getTLSHandle();
-      const char* host = nullptr;
-      if(tlsObject->getServerName()) {
-        host = (const char*) tlsObject->getServerName()->c_str();
+    /*
+     * Worker holds the connection - if the coroutine is gone meanwhile, the connection is released on the worker thread.
+     */
+    static void runStep(const std::shared_ptr<Connection>& connection, const std::shared_ptr<OffloadedStep>& step) {
+
+      {
+        std::lock_guard<std::mutex> lock(step->mutex);
+        if(step->cancelled) {
+          return;
+        }
       }
-      auto res = tls_connect_cbs(m_connection->m_tlsHandle,
-                                 readCallback, writeCallback,
-                                 m_connection, host);
 
-      tlsObject->annul();
+      async::Action action;
+      v_io_size res;
+
+      bool slotBusy = false;
 
-      if (res != 0) {
-        OATPP_LOGD("[oatpp::libressl::Connection::ConnectionContext::init()]", "Error on call to 'tls_connect_cbs'. %s", tls_error(m_connection->m_tlsHandle));
+      {
+        IOSlotGuard guard(connection->m_handshakeSlot, &action);
+        if(guard.isAcquired()) {
+          res = guard.complete(connection->completeHandshake());
+        } else {
+          res = IOError::RETRY_WRITE;
+          slotBusy = true;
+        }
       }
 
-    } else {
-      throw std::runtime_error("[oatpp::libressl::Connection::ConnectionContext::init()]: Error. Unknown TLSObject type.");
+      std::lock_guard<std::mutex> lock(step->mutex);
+      step->slotBusy = slotBusy;
+      step->result = res;
+      step->action = std::move(action);
+      step->done = true;
+      step->waitList.notifyAll();
+
     }
 
-  }
+    Action onStepResult(v_io_size res, Action&& action) {
 
-}
+      if(res == 0) {
+        m_connection->publishHandshakeProperties();
+        return finish();
+      }
 
-async::CoroutineStarter Connection::ConnectionContext::initAsync() {
+      if(!action.isNone()) {
+        return std::move(action);
+      }
+
+      if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+        return repeat();
+      }
+
+      return error<Error>("[oatpp::libressl::Connection::ConnectionContext::initAsync()]: Error. Handshake failed.");
+
+    }
 
-  class HandshakeCoroutine : public oatpp::async::Coroutine<HandshakeCoroutine> {
-  private:
-    Connection* m_connection;
   public:
 
     HandshakeCoroutine(Connection* connection)
       : m_connection(connection)
+      , m_workerPool(connection->m_handshakeWorkerPool)
     {}
 
+    ~HandshakeCoroutine() {
+      if(m_step) {
+        /* step which hasn't started is dropped, running one finishes on the worker - no waiting here */
+        std::lock_guard<std::mutex> lock(m_step->mutex);
+        m_step->cancelled = true;
+      }
+    }
+
     Action act() override {
 
       if(m_connection->m_initialized) {
         return finish();
       }
 
-      auto tlsObject = m_connection->m_tlsObject;
+      if(!m_connection->initTLS()) {
+        return error<Error>("[oatpp::libressl::Connection::ConnectionContext::initAsync()]: Error. Failed to set up TLS connection.");
+      }
 
-      if (tlsObject->getType() == TLSObject::Type::SERVER) {
-        return yieldTo(&HandshakeCoroutine::initServer);
-      } else if (tlsObject->getType() == TLSObject::Type::CLIENT) {
-        return yieldTo(&HandshakeCoroutine::initClient);
+      if(m_workerPool) {
+        return yieldTo(&HandshakeCoroutine::handshakeOffloaded);
       }
 
-      throw std::runtime_error("[oatpp::libressl::Connection::ConnectionContext::init()]: Error. Unknown TLSObject type.");
+      return yieldTo(&HandshakeCoroutine::handshake);
 
     }
 
-    Action initServer() {
+    Action handshake() {
 
-      auto tlsObject = m_connection->m_tlsObject;
-      auto res = tls_accept_cbs(tlsObject->getTLSHandle(), &m_connection->m_tlsHandle, readCallback, writeCallback, m_connection);
+      async::Action action;
+      v_io_size res;
 
-      if (res != 0) {
-        return error<Error>("[oatpp::libressl::Connection::ConnectionContext::initAsync(){initServer()}]: Error. Handshake failed.");
+      {
+        IOSlotGuard guard(m_connection->m_handshakeSlot, &action);
+        if(!guard.isAcquired()) {
+          /* handshake is run by another initializer - don't spin the executor while it's busy */
+          return waitRepeat(std::chrono::microseconds(HANDSHAKE_SLOT_WAIT_MICRO));
+        }
+        res = guard.complete(m_connection->completeHandshake());
       }
 
-      /* Handshake successful */
-      m_connection->m_initialized = true;
-      return finish();
+      return onStepResult(res, std::move(action));
 
     }
 
-    Action initClient() {
+    Action handshakeOffloaded() {
+
+      if(!m_step) {
+
+        std::shared_ptr<Connection> connection = m_connection->m_self.lock();
+        if(!connection) {
+          /* not created by createShared() - nothing keeps the connection alive on the worker */
+          return yieldTo(&HandshakeCoroutine::handshake);
+        }
+
+        m_step = std::make_shared<OffloadedStep>();
+        std::shared_ptr<OffloadedStep> step = m_step;
+
+        if(!m_workerPool->submit([connection, step]() { runStep(connection, step); })) {
+          /* pool is stopped - continue on the executor thread */
+          m_step.reset();
+          return yieldTo(&HandshakeCoroutine::handshake);
+        }
+
+      }
 
-      auto tlsObject = m_connection->m_tlsObject;
-      m_connection->m_tlsHandle = tlsObject->getTLSHandle();
-      const char* host = nullptr;
-      if(tlsObject->getServerName()) {
-        host = (const char*) tlsObject->getServerName()->c_str();
+      v_io_size res;
+      async::Action action;
+      bool slotBusy;
+
+      {
+        std::lock_guard<std::mutex> lock(m_step->mutex);
+        if(!m_step->done) {
+          return Action::createWaitListAction(&m_step->waitList);
+        }
+        res = m_step->result;
+        action = std::move(m_step->action);
+        slotBusy = m_step->slotBusy;
       }
-      auto res = tls_connect_cbs(m_connection->m_tlsHandle,
-                                 readCallback, writeCallback,
-                                 m_connection, host);
 
-      tlsObject->annul();
+      m_step.reset();
 
-      if (res != 0) {
-        return error<Error>("[oatpp::libressl::Connection::ConnectionContext::initAsync(){initClient()}]: Error. Handshake failed.");
+      if(slotBusy) {
+        /* handshake is run by another initializer - submit the step again later */
+        return waitRepeat(std::chrono::microseconds(HANDSHAKE_SLOT_WAIT_MICRO));
       }
 
-      m_connection->m_initialized = true;
-      return finish();
+      return onStepResult(res, std::move(action));
 
     }
 
@@ -162,48 +446,93 @@ data::stream::StreamType Connection::ConnectionContext::getStreamType() const {
   return m_streamType;
 }
 
+void Connection::ConnectionContext::setProperty(const oatpp::String& key, const oatpp::String& value) {
+  getMutableProperties().putOrReplace(key, value);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// IOLockGuard
+// IOSlotGuard
 
-Connection::IOLockGuard::IOLockGuard(Connection* connection, async::Action* checkAction)
-  : m_connection(connection)
-  , m_checkAction(checkAction)
+Connection::IOSlotGuard::IOSlotGuard(IOSlot& slot, async::Action* action)
+  : m_slot(&slot)
+  , m_prevSlot(CURRENT_IO_SLOT)
 {
-  m_connection->packIOAction(m_checkAction);
-  m_locked = true;
+  bool expected = false;
+  m_acquired = m_slot->busy.compare_exchange_strong(expected, true);
+  if(m_acquired) {
+    m_slot->action = action;
+    m_slot->transportRetry = 0;
+    CURRENT_IO_SLOT = m_slot;
+  }
 }
 
-Connection::IOLockGuard::~IOLockGuard() {
-  if(m_locked) {
-    m_connection->m_ioLock.unlock();
+Connection::IOSlotGuard::~IOSlotGuard() {
+  if(m_acquired) {
+    CURRENT_IO_SLOT = m_prevSlot;
+    m_slot->action = nullptr;
+    m_slot->busy = false;
   }
 }
 
-bool Connection::IOLockGuard::unpackAndCheck() {
-  async::Action* check = m_connection->unpackIOAction();
-  m_locked = false;
-  return check == m_checkAction;
+bool Connection::IOSlotGuard::isAcquired() const {
+  return m_acquired;
+}
+
+v_io_size Connection::IOSlotGuard::complete(v_io_size result) {
+
+  if(result != IOError::RETRY_READ && result != IOError::RETRY_WRITE) {
+    return result;
+  }
+
+  if(m_slot->transportRetry != 0) {
+    /* transport reported exactly what it waits for - its action is set for that event */
+    result = m_slot->transportRetry;
+  } else {
+    /* nothing to wait for - caller has no choice but to reschedule blindly */
+    m_slot->spuriousRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if(result == IOError::RETRY_READ) {
+    m_slot->readRetries.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    m_slot->writeRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return result;
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Connection
 
+thread_local Connection::IOSlot* Connection::CURRENT_IO_SLOT = nullptr;
+
 ssize_t Connection::writeCallback(struct tls *_ctx, const void *_buf, size_t _buflen, void *_cb_arg) {
 
   auto connection = static_cast<Connection*>(_cb_arg);
-  async::Action* ioAction = connection->unpackIOAction();
+  IOSlot* slot = CURRENT_IO_SLOT;
 
-  v_io_size res;
-  if(ioAction && ioAction->isNone()) {
-    res = connection->m_stream.object->write(_buf, _buflen, *ioAction);
-    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
-      res = TLS_WANT_POLLOUT;
-    }
-  } else {
-    res = TLS_WANT_POLLOUT;
+  if(slot == nullptr || slot->connection != connection || slot->action == nullptr || !slot->action->isNone()) {
+    return TLS_WANT_POLLOUT;
+  }
+
+  /* Blocking transport is written after the TLS lock is released - see callTLS() */
+  if(connection->isOutputStaged()) {
+    return connection->stageOutput(*slot, _buf, (v_buff_size) _buflen);
   }
 
-  connection->packIOAction(ioAction);
+  v_io_size res = connection->m_stream.object->write(_buf, _buflen, *slot->action);
+  if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+    slot->transportRetry = res;
+    res = TLS_WANT_POLLOUT;
+  } else if(res <= 0) {
+    connection->m_transportFailed = true;
+  } else {
+    if(connection->m_handshakeProfiler) {
+      connection->profileTransportIO(false);
+    }
+    connection->countCiphertext(false, _buf, res);
+  }
 
   return (ssize_t)res;
 
@@ -212,19 +541,34 @@ ssize_t Connection::writeCallback(struct tls *_ctx, const void *_buf, size_t _bu
 ssize_t Connection::readCallback(struct tls *_ctx, void *_buf, size_t _buflen, void *_cb_arg) {
 
   auto connection = static_cast<Connection*>(_cb_arg);
-  async::Action* ioAction = connection->unpackIOAction();
+  IOSlot* slot = CURRENT_IO_SLOT;
 
-  v_io_size res;
-  if(ioAction && ioAction->isNone()) {
-    res = connection->m_stream.object->read(_buf, _buflen, *ioAction);
-    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
-      res = TLS_WANT_POLLOUT;
+  if(slot == nullptr || slot->connection != connection || slot->action == nullptr || !slot->action->isNone()) {
+    return TLS_WANT_POLLIN;
+  }
+
+  /* Blocking transport is read after the TLS lock is released - see callTLS() */
+  bool staged = connection->isInputStaged();
+  if(staged && connection->m_clientHello.capacity == 0 && connection->m_readAhead.position == connection->m_readAhead.size) {
+    if(connection->m_inputClosed) {
+      return connection->m_inputCloseResult;
     }
-  } else {
-    res = TLS_WANT_POLLOUT;
+    slot->inputWanted = (v_buff_size) _buflen;
+    return TLS_WANT_POLLIN;
   }
 
-  connection->packIOAction(ioAction);
+  v_io_size res = connection->readTransport(_buf, _buflen, *slot->action);
+  if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+    slot->transportRetry = res;
+    res = TLS_WANT_POLLIN;
+  } else if(res <= 0) {
+    connection->m_transportFailed = true;
+  } else {
+    if(connection->m_handshakeProfiler && !staged) {
+      connection->profileTransportIO(true);
+    }
+    connection->countCiphertext(true, _buf, res);
+  }
 
   return (ssize_t)res;
 
@@ -236,9 +580,88 @@ Connection::Connection(const std::shared_ptr<TLSObject>& tlsObject,
   , m_tlsObject(tlsObject)
   , m_stream(stream)
   , m_initialized(false)
-  , m_ioAction(nullptr)
+  , m_tlsInitialized(false)
+  , m_handshakeState(HandshakeState::NONE)
+  , m_handshakeStartTick(0)
+  , m_handshakeEndTick(0)
+  , m_serverNamePending(false)
+  , m_readAheadEnabled(false)
+  , m_inputClosed(false)
+  , m_inputCloseResult(0)
+  , m_corked(false)
+  , m_transportFailed(false)
+  , m_recordSizePolicy(0)
+  , m_recordBytesSent(0)
+  , m_lastWriteTick(0)
+  , m_pendingWriteSize(0)
 {
 
+  m_readSlot.connection = this;
+  m_readSlot.busy = false;
+  m_readSlot.action = nullptr;
+  m_readSlot.transportRetry = 0;
+  m_readSlot.readRetries = 0;
+  m_readSlot.writeRetries = 0;
+  m_readSlot.spuriousRetries = 0;
+
+  m_writeSlot.connection = this;
+  m_writeSlot.busy = false;
+  m_writeSlot.action = nullptr;
+  m_writeSlot.transportRetry = 0;
+  m_writeSlot.readRetries = 0;
+  m_writeSlot.writeRetries = 0;
+  m_writeSlot.spuriousRetries = 0;
+
+  m_handshakeSlot.connection = this;
+  m_handshakeSlot.busy = false;
+  m_handshakeSlot.action = nullptr;
+  m_handshakeSlot.transportRetry = 0;
+  m_handshakeSlot.readRetries = 0;
+  m_handshakeSlot.writeRetries = 0;
+  m_handshakeSlot.spuriousRetries = 0;
+
+  IOSlot* slots[] = {&m_readSlot, &m_writeSlot, &m_handshakeSlot};
+  for(IOSlot* slot : slots) {
+    slot->inputWanted = 0;
+    slot->outputStaged = false;
+  }
+
+  m_clientHello.capacity = 0;
+  m_clientHello.position = 0;
+  m_clientHello.size = 0;
+
+  m_readAhead.capacity = 0;
+  m_readAhead.position = 0;
+  m_readAhead.size = 0;
+
+  m_stagedOutput.capacity = 0;
+  m_stagedOutput.position = 0;
+  m_stagedOutput.size = 0;
+
+  m_readBuffer.capacity = 0;
+  m_readBuffer.position = 0;
+  m_readBuffer.size = 0;
+
+  m_writeBuffer.capacity = 0;
+  m_writeBuffer.position = 0;
+  m_writeBuffer.size = 0;
+
+  m_inRecords.headerSize = 0;
+  m_inRecords.bodyRemaining = 0;
+  m_outRecords.headerSize = 0;
+  m_outRecords.bodyRemaining = 0;
+
+  m_metrics.plaintextBytesRead = 0;
+  m_metrics.plaintextBytesWritten = 0;
+  m_metrics.ciphertextBytesRead = 0;
+  m_metrics.ciphertextBytesWritten = 0;
+  m_metrics.recordsRead = 0;
+  m_metrics.recordsWritten = 0;
+  m_metrics.tlsReadCalls = 0;
+  m_metrics.tlsWriteCalls = 0;
+  m_metrics.tlsReadMicro = 0;
+  m_metrics.tlsWriteMicro = 0;
+
   auto& streamInContext = stream.object->getInputStreamContext();
   data::stream::Context::Properties inProperties(streamInContext.getProperties());
   inProperties.put("tls", "libressl");
@@ -261,6 +684,14 @@ Connection::Connection(const std::shared_ptr<TLSObject>& tlsObject,
 
 }
 
+std::shared_ptr<Connection> Connection::createShared(const std::shared_ptr<TLSObject>& tlsObject,
+                                                    const provider::ResourceHandle<data::stream::IOStream>& stream)
+{
+  auto connection = std::make_shared<Connection>(tlsObject, stream);
+  connection->m_self = connection;
+  return connection;
+}
+
 Connection::~Connection(){
   if(m_inContext == m_outContext) {
     delete m_inContext;
@@ -269,99 +700,1233 @@ Connection::~Connection(){
     delete m_outContext;
   }
   closeTLS();
+  /* after closeTLS() - the final flush and close_notify are counted */
+  if(m_statistics) {
+    m_statistics->onConnectionClosed(getMetrics());
+  }
   if(m_tlsHandle != nullptr) {
     tls_free(m_tlsHandle);
   }
 }
 
-void Connection::packIOAction(async::Action* action) {
-  m_ioLock.lock();
-  m_ioAction = action;
-}
-
-async::Action* Connection::unpackIOAction() {
-  auto result = m_ioAction;
-  m_ioAction = nullptr;
-  m_ioLock.unlock();
+v_io_size Connection::mapTLSResult(ssize_t result) {
+  if(result < 0) {
+    switch (result) {
+      case TLS_WANT_POLLIN: return oatpp::IOError::RETRY_READ;
+      case TLS_WANT_POLLOUT: return oatpp::IOError::RETRY_WRITE;
+      default:
+        return oatpp::IOError::BROKEN_PIPE;
+    }
+  }
   return result;
 }
 
-oatpp::v_io_size Connection::write(const void *buff, v_buff_size count, async::Action& action){
-
-  IOLockGuard ioGuard(this, &action);
+void Connection::resizeBuffer(Buffer& buffer, v_buff_size size) {
 
-  auto result = tls_write(m_tlsHandle, buff, count);
+  if(size < 0) {
+    size = 0;
+  }
 
-  if(!ioGuard.unpackAndCheck()) {
-    OATPP_LOGE("[oatpp::libressl::Connection::write(...)]", "Error. Packed action check failed!!!");
-    return oatpp::IOError::BROKEN_PIPE;
+  if(buffer.position != buffer.size) {
+    throw std::runtime_error("[oatpp::libressl::Connection::resizeBuffer()]: Error. Buffer is not empty.");
   }
 
-  if(result < 0) {
-    switch (result) {
-      case TLS_WANT_POLLIN: return oatpp::IOError::RETRY_WRITE;
-      case TLS_WANT_POLLOUT: return oatpp::IOError::RETRY_WRITE;
-      default:
-        return oatpp::IOError::BROKEN_PIPE;
-    }
+  if(size > 0) {
+    buffer.data.reset(new v_char8[size]);
+  } else {
+    buffer.data.reset();
   }
 
-  return result;
+  buffer.capacity = size;
+  buffer.position = 0;
+  buffer.size = 0;
 
 }
 
-oatpp::v_io_size Connection::read(void *buff, v_buff_size count, async::Action& action){
+v_buff_size Connection::drainBuffer(Buffer& buffer, void *buff, v_buff_size count) {
 
-  IOLockGuard ioGuard(this, &action);
+  v_buff_size available = buffer.size - buffer.position;
+  if(count > available) {
+    count = available;
+  }
 
-  auto result = tls_read(m_tlsHandle, buff, count);
+  std::memcpy(buff, buffer.data.get() + buffer.position, count);
+  buffer.position += count;
 
-  if(!ioGuard.unpackAndCheck()) {
-    OATPP_LOGE("[oatpp::libressl::Connection::read(...)]", "Error. Packed action check failed!!!");
-    return oatpp::IOError::BROKEN_PIPE;
+  return count;
+
+}
+
+v_io_size Connection::readTransport(void *buff, v_buff_size count, async::Action& action) {
+
+  /* ClientHello peeked for SNI goes to libtls first */
+  if(m_clientHello.capacity > 0) {
+    auto res = drainBuffer(m_clientHello, buff, count);
+    if(m_clientHello.position == m_clientHello.size) {
+      m_clientHello.data.reset();
+      m_clientHello.capacity = 0;
+    }
+    return res;
   }
 
-  if(result < 0) {
-    switch (result) {
-      case TLS_WANT_POLLIN: return oatpp::IOError::RETRY_WRITE;
-      case TLS_WANT_POLLOUT: return oatpp::IOError::RETRY_WRITE;
-      default:
-        return oatpp::IOError::BROKEN_PIPE;
+  if(m_readAhead.position == m_readAhead.size) {
+
+    /* Big reads don't benefit from buffering - read directly to the destination */
+    if(!m_readAheadEnabled || count >= m_readAhead.capacity) {
+      return m_stream.object->read(buff, count, action);
+    }
+
+    auto res = m_stream.object->read(m_readAhead.data.get(), m_readAhead.capacity, action);
+    if(res <= 0) {
+      return res;
     }
+
+    m_readAhead.position = 0;
+    m_readAhead.size = res;
+
   }
 
-  return result;
+  return drainBuffer(m_readAhead, buff, count);
 
 }
 
-void Connection::setOutputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
-  m_stream.object->setOutputStreamIOMode(ioMode);
+v_io_size Connection::readTLS(void *buff, v_buff_size count) {
+
+  if(m_readBuffer.capacity == 0 || count >= m_readBuffer.capacity) {
+    return callTLSRead(buff, count);
+  }
+
+  auto res = callTLSRead(m_readBuffer.data.get(), m_readBuffer.capacity);
+  if(res <= 0) {
+    return res;
+  }
+
+  m_readBuffer.position = 0;
+  m_readBuffer.size = res;
+
+  return drainBuffer(m_readBuffer, buff, count);
+
 }
 
-oatpp::data::stream::IOMode Connection::getOutputStreamIOMode() {
-  return m_stream.object->getOutputStreamIOMode();
+v_io_size Connection::writeTLS(const void *buff, v_buff_size count) {
+
+  if(m_pendingWriteSize > 0) {
+    /* libssl rejects a retried write of a different length - keep the size chosen for it until it succeeds */
+    if(count > m_pendingWriteSize) {
+      count = m_pendingWriteSize;
+    }
+  } else if(m_recordSizePolicy.smallRecordSize > 0) {
+
+    v_int64 tick = oatpp::base::Environment::getMicroTickCount();
+    if(tick - m_lastWriteTick > m_recordSizePolicy.idleTimeout) {
+      m_recordBytesSent = 0;
+    }
+
+    /* Each tls_write call produces records of at most the requested size */
+    v_buff_size recordSize = MAX_RECORD_SIZE;
+    if(m_recordBytesSent < m_recordSizePolicy.bytesThreshold) {
+      recordSize = m_recordSizePolicy.smallRecordSize;
+    }
+
+    if(count > recordSize) {
+      count = recordSize;
+    }
+
+  }
+
+  auto res = callTLSWrite(buff, count);
+
+  if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+    m_pendingWriteSize = count;
+    return res;
+  }
+
+  m_pendingWriteSize = 0;
+
+  if(res > 0 && m_recordSizePolicy.smallRecordSize > 0) {
+    m_recordBytesSent += res;
+    m_lastWriteTick = oatpp::base::Environment::getMicroTickCount();
+  }
+
+  return res;
+
 }
 
-oatpp::data::stream::Context& Connection::getOutputStreamContext() {
-  return *m_outContext;
+ssize_t Connection::callTLS(TLSCall call, void *buff, v_buff_size count) {
+
+  IOSlot* slot = CURRENT_IO_SLOT;
+
+  while(true) {
+
+    ssize_t result;
+
+    {
+      std::lock_guard<std::mutex> lock(m_tlsMutex);
+      if(slot != nullptr) {
+        slot->inputWanted = 0;
+        slot->outputStaged = false;
+      }
+      switch(call) {
+        case TLSCall::READ: result = tls_read(m_tlsHandle, buff, count); break;
+        case TLSCall::WRITE: result = tls_write(m_tlsHandle, buff, count); break;
+        case TLSCall::CLOSE: result = tls_close(m_tlsHandle); break;
+        default:
+          result = handshakeStep();
+      }
+    }
+
+    if(slot == nullptr) {
+      return result;
+    }
+
+    /*
+     * Staged transport I/O runs with the TLS lock released - a reader waiting for the peer
+     * doesn't keep the writer out of libtls, and the other way round.
+     */
+
+    if(slot->outputStaged) {
+      auto res = sendStagedOutput(*slot);
+      if(res == IOError::BROKEN_PIPE) {
+        return -1;
+      }
+      if(res < 0 && result <= 0) {
+        return TLS_WANT_POLLOUT;
+      }
+      /* on retry the data accepted by tls_write stays staged - it goes out before anything else */
+      if(result == TLS_WANT_POLLOUT && res == 0) {
+        continue; // staged output was full - it's sent now
+      }
+    }
+
+    if(result == TLS_WANT_POLLIN && slot->inputWanted > 0) {
+      auto res = receiveStagedInput(*slot);
+      if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+        return TLS_WANT_POLLIN;
+      }
+      continue; // data or end of stream - libtls gets it on the next call
+    }
+
+    return result;
+
+  }
+
 }
 
-void Connection::setInputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
-  m_stream.object->setInputStreamIOMode(ioMode);
+int Connection::handshakeStep() {
+
+  /*
+   * Shared state is locked for the libtls call only - staged transport I/O of the handshake
+   * runs after it returns, so concurrent handshakes of the same config don't wait for each other's peers.
+   */
+
+  if(m_sessionFileMutex) {
+    /* client saves the session to the file on the last handshake step */
+    std::lock_guard<std::mutex> lock(*m_sessionFileMutex);
+    return tls_handshake(m_tlsHandle);
+  }
+
+  if(m_ticketKeysLock) {
+    /* libtls reads session ticket keys during the handshake - don't let them rotate meanwhile */
+    m_ticketKeysLock->lockShared();
+    int result = tls_handshake(m_tlsHandle);
+    m_ticketKeysLock->unlockShared();
+    return result;
+  }
+
+  return tls_handshake(m_tlsHandle);
+
 }
 
-oatpp::data::stream::IOMode Connection::getInputStreamIOMode() {
-  return m_stream.object->getInputStreamIOMode();
+bool Connection::isInputStaged() {
+  return m_stream.object->getInputStreamIOMode() == oatpp::data::stream::IOMode::BLOCKING;
 }
 
-oatpp::data::stream::Context& Connection::getInputStreamContext() {
-  return *m_inContext;
+bool Connection::isOutputStaged() {
+  /* staged data goes first - keep staging while there is any, so that ciphertext is never reordered */
+  return m_stream.object->getOutputStreamIOMode() == oatpp::data::stream::IOMode::BLOCKING ||
+         m_stagedOutput.position != m_stagedOutput.size;
 }
 
-void Connection::closeTLS(){
-  if(m_tlsHandle != nullptr) {
-    tls_close(m_tlsHandle);
-  }
+ssize_t Connection::stageOutput(IOSlot& slot, const void *buff, v_buff_size count) {
+
+  slot.outputStaged = true;
+
+  if(m_stagedOutput.capacity == 0) {
+    m_stagedOutput.data.reset(new v_char8[STAGED_BUFFER_SIZE]);
+    m_stagedOutput.capacity = STAGED_BUFFER_SIZE;
+  }
+
+  /* data is appended only - the staged part may be being written by the other direction */
+  v_buff_size available = m_stagedOutput.capacity - m_stagedOutput.size;
+  if(available == 0) {
+    return TLS_WANT_POLLOUT;
+  }
+
+  if(count > available) {
+    count = available;
+  }
+
+  std::memcpy(m_stagedOutput.data.get() + m_stagedOutput.size, buff, count);
+  m_stagedOutput.size += count;
+  countCiphertext(false, buff, count);
+
+  return count;
+
+}
+
+v_io_size Connection::receiveStagedInput(IOSlot& slot) {
+
+  std::lock_guard<std::mutex> transportLock(m_transportReadMutex);
+
+  v_char8* data;
+  v_buff_size size;
+
+  {
+    std::lock_guard<std::mutex> lock(m_tlsMutex);
+
+    if(m_readAhead.position != m_readAhead.size || m_inputClosed) {
+      return 1; // received by the other direction meanwhile
+    }
+
+    if(m_readAhead.capacity == 0) {
+      m_readAhead.data.reset(new v_char8[STAGED_BUFFER_SIZE]);
+      m_readAhead.capacity = STAGED_BUFFER_SIZE;
+    }
+
+    m_readAhead.position = 0;
+    m_readAhead.size = 0;
+
+    data = m_readAhead.data.get();
+    size = m_readAhead.capacity;
+    /* without read-ahead read no more than libtls asked for */
+    if(!m_readAheadEnabled && size > slot.inputWanted) {
+      size = slot.inputWanted;
+    }
+  }
+
+  auto res = m_stream.object->read(data, size, *slot.action);
+
+  std::lock_guard<std::mutex> lock(m_tlsMutex);
+
+  if(res > 0) {
+    m_readAhead.size = res;
+    if(m_handshakeProfiler) {
+      profileTransportIO(true);
+    }
+  } else if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+    slot.transportRetry = res;
+  } else {
+    m_transportFailed = true;
+    m_inputClosed = true;
+    m_inputCloseResult = res == 0 ? 0 : -1;
+  }
+
+  return res;
+
+}
+
+v_io_size Connection::sendStagedOutput(IOSlot& slot) {
+
+  std::lock_guard<std::mutex> transportLock(m_transportWriteMutex);
+
+  while(true) {
+
+    const v_char8* data;
+    v_buff_size size;
+
+    {
+      std::lock_guard<std::mutex> lock(m_tlsMutex);
+      if(m_stagedOutput.position == m_stagedOutput.size) {
+        m_stagedOutput.position = 0;
+        m_stagedOutput.size = 0;
+        return 0;
+      }
+      data = m_stagedOutput.data.get() + m_stagedOutput.position;
+      size = m_stagedOutput.size - m_stagedOutput.position;
+    }
+
+    auto res = m_stream.object->write(data, size, *slot.action);
+
+    if(res > 0) {
+      std::lock_guard<std::mutex> lock(m_tlsMutex);
+      m_stagedOutput.position += res;
+      if(m_handshakeProfiler) {
+        profileTransportIO(false);
+      }
+    } else if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      /*
+       * No spinning here - blocking transport which can't take the data now (Ex.: send timeout)
+       * gets it on the next write or flush, staged data goes first.
+       */
+      if(!slot.action->isNone()) {
+        slot.transportRetry = res;
+      }
+      return res;
+    } else {
+      m_transportFailed = true;
+      return IOError::BROKEN_PIPE;
+    }
+
+  }
+
+}
+
+void Connection::countCiphertext(bool read, const void *data, v_io_size size) {
+  if(read) {
+    m_metrics.ciphertextBytesRead.fetch_add(size, std::memory_order_relaxed);
+    m_metrics.recordsRead.fetch_add(countRecords(m_inRecords, data, size), std::memory_order_relaxed);
+  } else {
+    m_metrics.ciphertextBytesWritten.fetch_add(size, std::memory_order_relaxed);
+    m_metrics.recordsWritten.fetch_add(countRecords(m_outRecords, data, size), std::memory_order_relaxed);
+  }
+}
+
+v_io_size Connection::callTLSRead(void *buff, v_buff_size count) {
+
+  v_int64 startTick = oatpp::base::Environment::getMicroTickCount();
+  auto res = mapTLSResult(callTLS(TLSCall::READ, buff, count));
+  v_int64 duration = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  m_metrics.tlsReadCalls.fetch_add(1, std::memory_order_relaxed);
+  m_metrics.tlsReadMicro.fetch_add(duration, std::memory_order_relaxed);
+  if(res > 0) {
+    m_metrics.plaintextBytesRead.fetch_add(res, std::memory_order_relaxed);
+  }
+
+  if(m_statistics) {
+    m_statistics->onTlsRead(duration, res > 0 ? res : 0);
+  }
+
+  return res;
+
+}
+
+v_io_size Connection::callTLSWrite(const void *buff, v_buff_size count) {
+
+  v_int64 startTick = oatpp::base::Environment::getMicroTickCount();
+  auto res = mapTLSResult(callTLS(TLSCall::WRITE, const_cast<void*>(buff), count));
+  v_int64 duration = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  m_metrics.tlsWriteCalls.fetch_add(1, std::memory_order_relaxed);
+  m_metrics.tlsWriteMicro.fetch_add(duration, std::memory_order_relaxed);
+  if(res > 0) {
+    m_metrics.plaintextBytesWritten.fetch_add(res, std::memory_order_relaxed);
+  }
+
+  if(m_statistics) {
+    m_statistics->onTlsWrite(duration, res > 0 ? res : 0);
+  }
+
+  return res;
+
+}
+
+v_int64 Connection::countRecords(RecordParser& parser, const void *data, v_buff_size size) {
+
+  auto bytes = (const v_char8*) data;
+  v_int64 records = 0;
+  v_buff_size position = 0;
+
+  while(position < size) {
+
+    if(parser.bodyRemaining > 0) {
+      v_buff_size chunk = size - position;
+      if(chunk > parser.bodyRemaining) {
+        chunk = (v_buff_size) parser.bodyRemaining;
+      }
+      parser.bodyRemaining -= chunk;
+      position += chunk;
+      continue;
+    }
+
+    parser.header[parser.headerSize ++] = bytes[position ++];
+
+    if(parser.headerSize == RECORD_HEADER_SIZE) {
+      /* header: type(1), version(2), length(2) */
+      parser.bodyRemaining = (((v_int64) parser.header[3]) << 8) | parser.header[4];
+      parser.headerSize = 0;
+      records ++;
+    }
+
+  }
+
+  return records;
+
+}
+
+v_io_size Connection::writeBuffered(const void *buff, v_buff_size count) {
+
+  /* Buffer is full - send it before accepting more data */
+  if(m_writeBuffer.size == m_writeBuffer.capacity) {
+    auto res = flushWriteBuffer();
+    if(res < 0) {
+      return res;
+    }
+  }
+
+  /* Big writes don't benefit from buffering - write directly */
+  if(m_writeBuffer.size == 0 && count >= m_writeBuffer.capacity) {
+    return writeTLS(buff, count);
+  }
+
+  v_buff_size available = m_writeBuffer.capacity - m_writeBuffer.size;
+  if(count > available) {
+    count = available;
+  }
+
+  std::memcpy(m_writeBuffer.data.get() + m_writeBuffer.size, buff, count);
+  m_writeBuffer.size += count;
+
+  return count;
+
+}
+
+v_io_size Connection::flushWriteBuffer() {
+
+  while(m_writeBuffer.position < m_writeBuffer.size) {
+
+    auto res = writeTLS(m_writeBuffer.data.get() + m_writeBuffer.position, m_writeBuffer.size - m_writeBuffer.position);
+
+    if(res < 0) {
+      return res;
+    } else if(res == 0) {
+      return oatpp::IOError::BROKEN_PIPE;
+    }
+
+    m_writeBuffer.position += res;
+
+  }
+
+  m_writeBuffer.position = 0;
+  m_writeBuffer.size = 0;
+
+  return 0;
+
+}
+
+bool Connection::initTLS() {
+
+  /* init() and initAsync() may race on the same connection */
+  std::lock_guard<std::mutex> lock(m_initMutex);
+
+  if(m_tlsInitialized) {
+    return m_tlsHandle != nullptr;
+  }
+
+  m_tlsInitialized = true;
+
+  if (m_tlsObject->getType() == TLSObject::Type::SERVER) {
+
+    if(m_certificateProvider) {
+      /* context is chosen by SNI - accept once the ClientHello is read (see acceptByServerName()) */
+      m_serverNamePending = true;
+      return true;
+    }
+
+    acceptTLS(m_tlsObject->getTLSHandle());
+
+  } else if (m_tlsObject->getType() == TLSObject::Type::CLIENT) {
+
+    m_tlsHandle = m_tlsObject->getTLSHandle();
+    const char* host = nullptr;
+    if(m_tlsObject->getServerName()) {
+      host = (const char*) m_tlsObject->getServerName()->c_str();
+    }
+    int res;
+    if(m_sessionFileMutex) {
+      /* tls_connect_cbs reads the session file - don't let it be rewritten meanwhile */
+      std::lock_guard<std::mutex> lock(*m_sessionFileMutex);
+      res = tls_connect_cbs(m_tlsHandle, readCallback, writeCallback, this, host);
+    } else {
+      res = tls_connect_cbs(m_tlsHandle, readCallback, writeCallback, this, host);
+    }
+
+    m_tlsObject->annul();
+
+    if (res != 0) {
+      OATPP_LOGE("[oatpp::libressl::Connection::initTLS()]", "Error on call to 'tls_connect_cbs'. %s", tls_error(m_tlsHandle));
+      tls_free(m_tlsHandle);
+      m_tlsHandle = nullptr;
+    }
+
+  } else {
+    throw std::runtime_error("[oatpp::libressl::Connection::initTLS()]: Error. Unknown TLSObject type.");
+  }
+
+  if(m_tlsHandle == nullptr) {
+    m_handshakeState = HandshakeState::FAILED;
+    return false;
+  }
+
+  return true;
+
+}
+
+bool Connection::acceptTLS(TLSHandle serverHandle) {
+
+  auto res = tls_accept_cbs(serverHandle, &m_tlsHandle, readCallback, writeCallback, this);
+
+  if (res != 0) {
+    OATPP_LOGE("[oatpp::libressl::Connection::acceptTLS()]", "Error on call to 'tls_accept_cbs'. %s", tls_error(serverHandle));
+    if(m_tlsHandle != nullptr) {
+      tls_free(m_tlsHandle);
+      m_tlsHandle = nullptr;
+    }
+    return false;
+  }
+
+  return true;
+
+}
+
+v_io_size Connection::acceptByServerName() {
+
+  IOSlot* slot = CURRENT_IO_SLOT;
+  if(slot == nullptr || slot->connection != this || slot->action == nullptr) {
+    return oatpp::IOError::RETRY_READ;
+  }
+
+  if(!slot->action->isNone()) {
+    /* transport already waits for an event - report the one it waits for */
+    return slot->transportRetry != 0 ? slot->transportRetry : oatpp::IOError::RETRY_READ;
+  }
+
+  if(m_clientHello.capacity == 0) {
+    m_clientHello.data.reset(new v_char8[RECORD_HEADER_SIZE + MAX_RECORD_SIZE]);
+    m_clientHello.capacity = RECORD_HEADER_SIZE + MAX_RECORD_SIZE;
+    m_clientHello.position = 0;
+    m_clientHello.size = 0;
+  }
+
+  /*
+   * Read the ClientHello records exactly - nothing beyond them, so that libtls gets the rest from the transport.
+   * ClientHello may be split across several records.
+   */
+  std::string message;
+  v_buff_size need;
+  while((need = reassembleClientHello(m_clientHello.data.get(), m_clientHello.size, message)) > 0) {
+
+    if(need > MAX_CLIENT_HELLO_SIZE) {
+      need = -1;
+      break;
+    }
+
+    if(need > m_clientHello.capacity) {
+      v_buff_size capacity = std::min(std::max(m_clientHello.capacity * 2, need), MAX_CLIENT_HELLO_SIZE);
+      std::unique_ptr<v_char8[]> data(new v_char8[capacity]);
+      std::memcpy(data.get(), m_clientHello.data.get(), m_clientHello.size);
+      m_clientHello.data = std::move(data);
+      m_clientHello.capacity = capacity;
+    }
+
+    auto res = m_stream.object->read(m_clientHello.data.get() + m_clientHello.size, need - m_clientHello.size, *slot->action);
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      slot->transportRetry = res;
+      return oatpp::IOError::RETRY_READ;
+    }
+    if(res <= 0) {
+      m_serverNamePending = false;
+      m_transportFailed = true;
+      onHandshakeFailed(HandshakeFailure::TRANSPORT);
+      return oatpp::IOError::BROKEN_PIPE;
+    }
+    m_clientHello.size += res;
+
+  }
+
+  m_serverNamePending = false;
+
+  TLSHandle serverHandle = m_tlsObject->getTLSHandle();
+
+  if(need < 0) {
+
+    if(m_clientHello.data[0] != RECORD_TYPE_HANDSHAKE) {
+      /* not a TLS handshake at all - let libtls report the error */
+    } else {
+      OATPP_LOGE("[oatpp::libressl::Connection::acceptByServerName()]", "Error. ClientHello can't be reassembled - server name is not available.");
+      onHandshakeFailed(HandshakeFailure::SERVER_NAME);
+      return oatpp::IOError::BROKEN_PIPE;
+    }
+
+  } else {
+
+    const char* serverName;
+    v_buff_size serverNameSize;
+    if(!parseServerName((const v_char8*) message.data(), message.size(), &serverName, &serverNameSize)) {
+      OATPP_LOGE("[oatpp::libressl::Connection::acceptByServerName()]", "Error. ClientHello is malformed - server name is not available.");
+      onHandshakeFailed(HandshakeFailure::SERVER_NAME);
+      return oatpp::IOError::BROKEN_PIPE;
+    }
+
+    /* no server name - default context */
+    if(serverName != nullptr) {
+      try {
+        m_serverContext = m_certificateProvider->getServerContext(serverName, serverNameSize);
+        if(m_serverContext) {
+          serverHandle = m_serverContext->getTLSHandle();
+        }
+      } catch (std::runtime_error& e) {
+        OATPP_LOGE("[oatpp::libressl::Connection::acceptByServerName()]", "Error. Can't get server context by name. %s", e.what());
+        onHandshakeFailed(HandshakeFailure::SERVER_NAME);
+        return oatpp::IOError::BROKEN_PIPE;
+      }
+    }
+
+  }
+
+  if(!acceptTLS(serverHandle)) {
+    onHandshakeFailed(HandshakeFailure::SETUP);
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  return 0;
+
+}
+
+v_io_size Connection::completeHandshake() {
+
+  /*
+   * Handshake takes several steps driven by whichever direction comes first.
+   * Reader and writer serialize here until handshake is done.
+   */
+  std::lock_guard<std::mutex> lock(m_handshakeMutex);
+
+  switch(m_handshakeState) {
+    case HandshakeState::COMPLETE: return 0;
+    case HandshakeState::FAILED: return oatpp::IOError::BROKEN_PIPE;
+    case HandshakeState::NONE:
+      m_handshakeState = HandshakeState::IN_PROGRESS;
+      m_handshakeStartTick = oatpp::base::Environment::getMicroTickCount();
+      if(m_handshakeProfiler) {
+        m_handshakeTimeline.start(m_handshakeStartTick);
+      }
+      break;
+    default:
+      break;
+  }
+
+  if(m_serverNamePending) {
+    auto res = acceptByServerName();
+    if(res != 0) {
+      return res; // failure reason is recorded by acceptByServerName()
+    }
+  }
+
+  if(m_tlsHandle == nullptr) {
+    onHandshakeFailed(m_transportFailed ? HandshakeFailure::TRANSPORT : HandshakeFailure::SETUP);
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  int result = (int) callTLS(TLSCall::HANDSHAKE, nullptr, 0);
+
+  if(result == 0) {
+    if(!verifyPeerChain()) {
+      onHandshakeFailed(HandshakeFailure::PEER_VERIFICATION);
+      return oatpp::IOError::BROKEN_PIPE;
+    }
+    onHandshakeComplete();
+    return 0;
+  }
+
+  if(result == TLS_WANT_POLLIN || result == TLS_WANT_POLLOUT) {
+    return mapTLSResult(result);
+  }
+
+  onHandshakeFailed(m_transportFailed ? HandshakeFailure::TRANSPORT : HandshakeFailure::PROTOCOL);
+  return oatpp::IOError::BROKEN_PIPE;
+
+}
+
+bool Connection::verifyPeerChain() {
+
+  if(!m_trustStore || m_tlsObject->getType() != TLSObject::Type::CLIENT) {
+    return true;
+  }
+
+  size_t size = 0;
+  const uint8_t* chain = tls_peer_cert_chain_pem(m_tlsHandle, &size);
+
+  oatpp::String error;
+  if(!m_trustStore->verifyServerChain(chain, (v_buff_size) size, &error)) {
+    OATPP_LOGE("[oatpp::libressl::Connection::verifyPeerChain()]", "Error. Peer certificate chain is not trusted. %s",
+               error ? error->c_str() : "");
+    return false;
+  }
+
+  return true;
+
+}
+
+void Connection::onHandshakeComplete() {
+  m_handshakeEndTick = oatpp::base::Environment::getMicroTickCount();
+  if(m_statistics) {
+    m_statistics->onHandshake(tls_conn_session_resumed(m_tlsHandle) == 1, m_handshakeEndTick - m_handshakeStartTick);
+  }
+  if(m_handshakeProfiler) {
+    m_handshakeTimeline.finish(m_handshakeEndTick);
+    m_handshakeProfiler->onHandshake(tls_conn_cipher(m_tlsHandle), getServerCertificateType(), m_handshakeTimeline);
+  }
+  m_handshakeState = HandshakeState::COMPLETE;
+}
+
+void Connection::setHandshakeProperty(const oatpp::String& key, const char* value) {
+  if(value == nullptr) {
+    return;
+  }
+  oatpp::String str(value);
+  m_inContext->setProperty(key, str);
+  if(m_outContext != m_inContext) {
+    m_outContext->setProperty(key, str);
+  }
+}
+
+void Connection::publishHandshakeProperties() {
+
+  /*
+   * Negotiated parameters are read from libtls once and cached in the context properties.
+   * Called from init()/initAsync() only - never from a handshake completed lazily inside read()/write(),
+   * where another thread may already read the properties. Properties are read once the context is initialized -
+   * so the context is marked initialized here, after the properties are set and under the same lock.
+   */
+
+  std::lock_guard<std::mutex> lock(m_initMutex);
+
+  if(m_initialized) {
+    return;
+  }
+
+  setHandshakeProperty("tls_version", tls_conn_version(m_tlsHandle));
+  setHandshakeProperty("tls_cipher", tls_conn_cipher(m_tlsHandle));
+
+  int strength = tls_conn_cipher_strength(m_tlsHandle);
+  if(strength > 0) {
+    setHandshakeProperty("tls_cipher_strength", std::to_string(strength).c_str());
+  }
+
+  setHandshakeProperty("tls_servername", tls_conn_servername(m_tlsHandle));
+  setHandshakeProperty("tls_alpn", tls_conn_alpn_selected(m_tlsHandle));
+  setHandshakeProperty("tls_session_resumed", tls_conn_session_resumed(m_tlsHandle) == 1 ? "true" : "false");
+
+  if(tls_peer_cert_provided(m_tlsHandle) == 1) {
+    setHandshakeProperty("tls_peer_cert_hash", tls_peer_cert_hash(m_tlsHandle));
+    setHandshakeProperty("tls_peer_cert_subject", tls_peer_cert_subject(m_tlsHandle));
+  }
+
+  m_initialized = true;
+
+}
+
+void Connection::profileTransportIO(bool read) {
+
+  /* transport I/O of the handshake only - handshake steps are serialized by m_handshakeMutex */
+  if(m_handshakeState != HandshakeState::IN_PROGRESS) {
+    return;
+  }
+
+  v_int64 tick = oatpp::base::Environment::getMicroTickCount();
+  if(read) {
+    m_handshakeTimeline.onRead(tick);
+  } else {
+    m_handshakeTimeline.onWrite(tick);
+  }
+
+}
+
+oatpp::String Connection::getServerCertificateType() {
+
+  if(m_tlsObject->getType() == TLSObject::Type::SERVER) {
+    return m_serverContext ? m_serverContext->getCertificateType() : m_tlsObject->getCertificateType();
+  }
+
+  size_t size = 0;
+  const uint8_t* chain = tls_peer_cert_chain_pem(m_tlsHandle, &size);
+  if(chain == nullptr || size == 0) {
+    return nullptr;
+  }
+
+  return CertificateIndex::getCertificateType(oatpp::String((const char*) chain, (v_buff_size) size));
+
+}
+
+void Connection::onHandshakeFailed(HandshakeFailure reason) {
+  m_handshakeEndTick = oatpp::base::Environment::getMicroTickCount();
+  if(m_statistics) {
+    m_statistics->onHandshakeFailed(reason);
+  }
+  m_handshakeState = HandshakeState::FAILED;
+  OATPP_LOGE("[oatpp::libressl::Connection::onHandshakeFailed()]", "Error. Handshake failed. %s",
+             m_tlsHandle != nullptr ? tls_error(m_tlsHandle) : "TLS is not set up");
+}
+
+Connection::HandshakeState Connection::getHandshakeState() const {
+  return m_handshakeState;
+}
+
+Connection::RetryStatistics Connection::getRetryStatistics() const {
+
+  const IOSlot* slots[] = {&m_readSlot, &m_writeSlot, &m_handshakeSlot};
+
+  RetryStatistics result;
+  result.readRetries = 0;
+  result.writeRetries = 0;
+  result.spuriousRetries = 0;
+
+  for(const IOSlot* slot : slots) {
+    result.readRetries += slot->readRetries.load(std::memory_order_relaxed);
+    result.writeRetries += slot->writeRetries.load(std::memory_order_relaxed);
+    result.spuriousRetries += slot->spuriousRetries.load(std::memory_order_relaxed);
+  }
+
+  return result;
+
+}
+
+v_int64 Connection::getHandshakeDuration() const {
+  if(m_handshakeState == HandshakeState::COMPLETE || m_handshakeState == HandshakeState::FAILED) {
+    return m_handshakeEndTick - m_handshakeStartTick;
+  }
+  return -1;
+}
+
+Connection::Metrics Connection::getMetrics() const {
+
+  auto retries = getRetryStatistics();
+
+  Metrics result;
+  result.handshakeStartTick = m_handshakeStartTick;
+  result.handshakeEndTick = m_handshakeEndTick;
+  result.plaintextBytesRead = m_metrics.plaintextBytesRead.load(std::memory_order_relaxed);
+  result.plaintextBytesWritten = m_metrics.plaintextBytesWritten.load(std::memory_order_relaxed);
+  result.ciphertextBytesRead = m_metrics.ciphertextBytesRead.load(std::memory_order_relaxed);
+  result.ciphertextBytesWritten = m_metrics.ciphertextBytesWritten.load(std::memory_order_relaxed);
+  result.recordsRead = m_metrics.recordsRead.load(std::memory_order_relaxed);
+  result.recordsWritten = m_metrics.recordsWritten.load(std::memory_order_relaxed);
+  result.readRetries = retries.readRetries;
+  result.writeRetries = retries.writeRetries;
+  result.tlsReadCalls = m_metrics.tlsReadCalls.load(std::memory_order_relaxed);
+  result.tlsWriteCalls = m_metrics.tlsWriteCalls.load(std::memory_order_relaxed);
+  result.tlsReadMicro = m_metrics.tlsReadMicro.load(std::memory_order_relaxed);
+  result.tlsWriteMicro = m_metrics.tlsWriteMicro.load(std::memory_order_relaxed);
+
+  return result;
+
+}
+
+void Connection::applyConfig(const std::shared_ptr<Config>& config) {
+  setReadAheadBufferSize(config->getReadAheadBufferSize());
+  setReadBufferSize(config->getReadBufferSize());
+  setWriteBufferSize(config->getWriteBufferSize());
+  setRecordSizePolicy(config->getRecordSizePolicy());
+  setHandshakeWorkerPool(config->getHandshakeWorkerPool());
+  m_ticketKeysLock = config->getTicketKeysLock();
+  m_sessionFileMutex = config->getSessionFileMutex();
+  m_trustStore = config->getTrustStore();
+  m_certificateProvider = config->getCertificateIndex();
+  m_handshakeProfiler = config->getHandshakeProfiler();
+}
+
+void Connection::setCertificateProvider(const std::shared_ptr<server::CertificateProvider>& provider) {
+  m_certificateProvider = provider;
+}
+
+void Connection::setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics) {
+  m_statistics = statistics;
+  if(m_statistics) {
+    m_statistics->onConnectionOpened();
+  }
+}
+
+void Connection::setHandshakeWorkerPool(const std::shared_ptr<HandshakeWorkerPool>& pool) {
+  m_handshakeWorkerPool = pool;
+}
+
+void Connection::setReadAheadBufferSize(v_buff_size size) {
+  resizeBuffer(m_readAhead, size);
+  m_readAheadEnabled = m_readAhead.capacity > 0;
+}
+
+void Connection::setReadBufferSize(v_buff_size size) {
+  resizeBuffer(m_readBuffer, size);
+}
+
+v_buff_size Connection::getPendingBytes() const {
+  return m_readBuffer.size - m_readBuffer.position;
+}
+
+void Connection::setWriteBufferSize(v_buff_size size) {
+  resizeBuffer(m_writeBuffer, size);
+}
+
+void Connection::cork() {
+  m_corked = m_writeBuffer.capacity > 0;
+}
+
+v_buff_size Connection::getUnflushedBytes() const {
+  return m_writeBuffer.size - m_writeBuffer.position;
+}
+
+bool Connection::isAlive() {
+
+  if(m_handshakeState != HandshakeState::COMPLETE || getPendingBytes() > 0) {
+    return false;
+  }
+
+  auto ioMode = getInputStreamIOMode();
+  setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+  v_char8 probe;
+  async::Action action;
+  auto res = read(&probe, 1, action);
+
+  setInputStreamIOMode(ioMode);
+
+  return res == IOError::RETRY_READ || res == IOError::RETRY_WRITE;
+
+}
+
+void Connection::setRecordSizePolicy(const Config::RecordSizePolicy& policy) {
+  m_recordSizePolicy = policy;
+  m_recordBytesSent = 0;
+  m_lastWriteTick = 0;
+}
+
+oatpp::v_io_size Connection::write(const void *buff, v_buff_size count, async::Action& action){
+
+  IOSlotGuard guard(m_writeSlot, &action);
+
+  if(!guard.isAcquired()) {
+    OATPP_LOGE("[oatpp::libressl::Connection::write(...)]", "Error. Concurrent write operations on the same connection.");
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  if(m_handshakeState != HandshakeState::COMPLETE) {
+    auto res = completeHandshake();
+    if(res != 0) {
+      return guard.complete(res);
+    }
+  }
+
+  if(m_corked) {
+    return guard.complete(writeBuffered(buff, count));
+  }
+
+  return guard.complete(writeTLS(buff, count));
+
+}
+
+oatpp::v_io_size Connection::writeVectored(const WriteVector* vectors, v_int32 count, async::Action& action) {
+
+  IOSlotGuard guard(m_writeSlot, &action);
+
+  if(!guard.isAcquired()) {
+    OATPP_LOGE("[oatpp::libressl::Connection::writeVectored(...)]", "Error. Concurrent write operations on the same connection.");
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  if(m_handshakeState != HandshakeState::COMPLETE) {
+    auto res = completeHandshake();
+    if(res != 0) {
+      return guard.complete(res);
+    }
+  }
+
+  v_io_size total = 0;
+
+  for(v_int32 i = 0; i < count; i ++) {
+
+    auto data = (const v_char8*) vectors[i].data;
+    v_buff_size size = vectors[i].size;
+
+    while(size > 0) {
+
+      /*
+       * Once some data is accepted, stop before any I/O that may be needed to accept more,
+       * so that the result is never mixed with a pending async action.
+       */
+      if(total > 0 && (!m_corked || m_writeBuffer.size == m_writeBuffer.capacity)) {
+        return total;
+      }
+
+      v_io_size res;
+      if(m_corked) {
+        res = writeBuffered(data, size);
+      } else {
+        res = writeTLS(data, size);
+      }
+
+      if(res <= 0) {
+        return total > 0 ? total : guard.complete(res);
+      }
+
+      data += res;
+      size -= res;
+      total += res;
+
+    }
+
+  }
+
+  return total;
+
+}
+
+oatpp::v_io_size Connection::flush(async::Action& action) {
+
+  IOSlotGuard guard(m_writeSlot, &action);
+
+  if(!guard.isAcquired()) {
+    OATPP_LOGE("[oatpp::libressl::Connection::flush(...)]", "Error. Concurrent write operations on the same connection.");
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  auto res = flushWriteBuffer();
+  if(res == 0) {
+    m_corked = false;
+    /* ciphertext left staged by a blocking transport which couldn't take it */
+    if(m_stagedOutput.position != m_stagedOutput.size) {
+      res = sendStagedOutput(m_writeSlot);
+    }
+  }
+
+  return guard.complete(res);
+
+}
+
+oatpp::v_io_size Connection::flush() {
+  async::Action action;
+  return flush(action);
+}
+
+async::CoroutineStarter Connection::flushAsync() {
+
+  class FlushCoroutine : public oatpp::async::Coroutine<FlushCoroutine> {
+  private:
+    Connection* m_connection;
+  public:
+
+    FlushCoroutine(Connection* connection)
+      : m_connection(connection)
+    {}
+
+    Action act() override {
+
+      async::Action action;
+      auto res = m_connection->flush(action);
+
+      if(!action.isNone()) {
+        return action;
+      }
+
+      if(res == 0) {
+        return finish();
+      } else if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+        return repeat();
+      }
+
+      return error<Error>("[oatpp::libressl::Connection::flushAsync()]: Error. Failed to flush write buffer.");
+
+    }
+
+  };
+
+  if(m_writeBuffer.position == m_writeBuffer.size) {
+    m_corked = false;
+    return nullptr;
+  }
+
+  return FlushCoroutine::start(this);
+
+}
+
+oatpp::v_io_size Connection::read(void *buff, v_buff_size count, async::Action& action){
+
+  IOSlotGuard guard(m_readSlot, &action);
+
+  if(!guard.isAcquired()) {
+    OATPP_LOGE("[oatpp::libressl::Connection::read(...)]", "Error. Concurrent read operations on the same connection.");
+    return oatpp::IOError::BROKEN_PIPE;
+  }
+
+  /* Already decrypted data - no I/O needed */
+  if(m_readBuffer.position < m_readBuffer.size) {
+    return drainBuffer(m_readBuffer, buff, count);
+  }
+
+  if(m_handshakeState != HandshakeState::COMPLETE) {
+    auto res = completeHandshake();
+    if(res != 0) {
+      return guard.complete(res);
+    }
+  }
+
+  return guard.complete(readTLS(buff, count));
+
+}
+
+void Connection::setOutputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
+  m_stream.object->setOutputStreamIOMode(ioMode);
+}
+
+oatpp::data::stream::IOMode Connection::getOutputStreamIOMode() {
+  return m_stream.object->getOutputStreamIOMode();
+}
+
+oatpp::data::stream::Context& Connection::getOutputStreamContext() {
+  return *m_outContext;
+}
+
+void Connection::setInputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
+  m_stream.object->setInputStreamIOMode(ioMode);
+}
+
+oatpp::data::stream::IOMode Connection::getInputStreamIOMode() {
+  return m_stream.object->getInputStreamIOMode();
+}
+
+oatpp::data::stream::Context& Connection::getInputStreamContext() {
+  return *m_inContext;
+}
+
+void Connection::closeTLS(){
+
+  if(m_tlsHandle == nullptr) {
+    return;
+  }
+
+  /*
+   * Best effort - a peer which doesn't read must not hold the thread closing the connection (Ex.: destructor).
+   * Once the transport asks to wait for an event, nothing more is sent.
+   */
+  m_stream.object->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+  async::Action action;
+  IOSlotGuard guard(m_writeSlot, &action);
+
+  if(!guard.isAcquired() || m_handshakeState != HandshakeState::COMPLETE) {
+    /* writer is still running or there is no session - nothing is sent */
+    std::lock_guard<std::mutex> lock(m_tlsMutex);
+    tls_close(m_tlsHandle);
+    return;
+  }
+
+  if(m_writeBuffer.position != m_writeBuffer.size) {
+    flushWriteBuffer();
+    if(m_writeBuffer.position != m_writeBuffer.size) {
+      OATPP_LOGE("[oatpp::libressl::Connection::closeTLS()]",
+                 "Error. Connection closed with %lld unflushed bytes - data is lost. "
+                 "Call flush() or flushAsync() at the end of the corked message.",
+                 (long long) (m_writeBuffer.size - m_writeBuffer.position));
+    }
+  }
+
+  /* close_notify goes through the write slot - so it's written by writeCallback() and counted */
+  for(v_int32 i = 0; i < CLOSE_NOTIFY_ATTEMPTS && action.isNone(); i ++) {
+    auto res = callTLS(TLSCall::CLOSE, nullptr, 0);
+    if(res != TLS_WANT_POLLIN && res != TLS_WANT_POLLOUT) {
+      break;
+    }
+  }
+
 }
 
 provider::ResourceHandle<data::stream::IOStream> Connection::getTransportStream() {
@@ -25,31 +25,112 @@
 #ifndef oatpp_libressl_Connection_hpp
 #define oatpp_libressl_Connection_hpp
 
+#include "Config.hpp"
+#include "HandshakeTimeline.hpp"
+#include "HandshakeWorkerPool.hpp"
 #include "TLSObject.hpp"
 
 #include "oatpp/core/provider/Provider.hpp"
 #include "oatpp/core/data/stream/Stream.hpp"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace oatpp { namespace libressl {
 
+class ConnectionStatistics;
+
 /**
- * TLS Connection implementation. Extends &id:oatpp::base::Countable; and &id:oatpp::data::stream::IOStream;.
+ * TLS Connection implementation. Extends &id:oatpp::base::Countable; and &id:oatpp::data::stream::IOStream;. <br>
+ * Once the stream context is initialized the negotiated parameters are published in the context properties:
+ * `tls_version`, `tls_cipher`, `tls_cipher_strength`, `tls_servername`, `tls_alpn`, `tls_session_resumed`,
+ * `tls_peer_cert_hash` and `tls_peer_cert_subject`. Properties which were not negotiated are not set.
+ * A handshake completed lazily by `read()`/`write()` is published by the first `initContexts()`/`initContextsAsync()` after it.
  */
 class Connection : public oatpp::base::Countable, public oatpp::data::stream::IOStream {
 private:
 
-  class IOLockGuard {
+  /*
+   * I/O slot of one direction of the stream.
+   * Reader and writer each own a separate slot so both directions can be driven concurrently.
+   */
+  struct IOSlot {
+    Connection* connection;
+    std::atomic<bool> busy;
+    async::Action* action;
+    /* retry reported by the transport during the current operation - what the operation actually waits for */
+    v_io_size transportRetry;
+    /* number of ciphertext bytes libtls asked for while the staged input was empty */
+    v_buff_size inputWanted;
+    /* ciphertext was staged for the blocking transport during the last tls_* call */
+    bool outputStaged;
+    std::atomic<v_int64> readRetries;
+    std::atomic<v_int64> writeRetries;
+    std::atomic<v_int64> spuriousRetries;
+  };
+
+  /*
+   * Acquires the I/O slot for the duration of a tls_* call and makes it current for the calling thread.
+   * Transport I/O requested by libtls from within the call is then done with the action of this slot.
+   */
+  class IOSlotGuard {
   private:
-    Connection* m_connection;
-    async::Action* m_checkAction;
-    bool m_locked;
+    IOSlot* m_slot;
+    IOSlot* m_prevSlot;
+    bool m_acquired;
   public:
 
-    IOLockGuard(Connection* connection, async::Action* checkAction);
-    ~IOLockGuard();
+    IOSlotGuard(IOSlot& slot, async::Action* action);
+    ~IOSlotGuard();
+
+    bool isAcquired() const;
 
-    bool unpackAndCheck();
+    /*
+     * Resolve the direction of a retry result according to what the transport waits for, and count it.
+     */
+    v_io_size complete(v_io_size result);
+
+  };
 
+private:
+
+  /*
+   * Data buffer. Filled at `size` and drained from `position`.
+   * Used for ciphertext read-ahead and staging, for the plaintext read buffer, and to gather corked writes.
+   */
+  struct Buffer {
+    std::unique_ptr<v_char8[]> data;
+    v_buff_size capacity;
+    v_buff_size position;
+    v_buff_size size;
+  };
+
+  /*
+   * Follows TLS record boundaries in the ciphertext stream of one direction.
+   * Record header may be split between transport reads/writes.
+   */
+  struct RecordParser {
+    v_char8 header[5];
+    v_int32 headerSize;
+    v_int64 bodyRemaining;
+  };
+
+  /*
+   * Per-connection counters. Relaxed atomics - updated by reader and writer, read by anyone.
+   */
+  struct MetricCounters {
+    std::atomic<v_int64> plaintextBytesRead;
+    std::atomic<v_int64> plaintextBytesWritten;
+    std::atomic<v_int64> ciphertextBytesRead;
+    std::atomic<v_int64> ciphertextBytesWritten;
+    std::atomic<v_int64> recordsRead;
+    std::atomic<v_int64> recordsWritten;
+    std::atomic<v_int64> tlsReadCalls;
+    std::atomic<v_int64> tlsWriteCalls;
+    std::atomic<v_int64> tlsReadMicro;
+    std::atomic<v_int64> tlsWriteMicro;
   };
 
 private:
@@ -70,22 +151,298 @@ private:
 
     data::stream::StreamType getStreamType() const override;
 
+    void setProperty(const oatpp::String& key, const oatpp::String& value);
+
   };
 
 public:
   typedef struct tls* TLSHandle;
+
+  /**
+   * Collection of TLS objects.
+   */
+  typedef std::vector<std::shared_ptr<TLSObject>> TLSObjects;
+private:
+
+  /*
+   * libtls call made under the TLS lock.
+   */
+  enum TLSCall : v_int32 {
+    HANDSHAKE = 0,
+    READ = 1,
+    WRITE = 2,
+    CLOSE = 3
+  };
+
+public:
+
+  /**
+   * State of the TLS handshake.
+   */
+  enum HandshakeState : v_int32 {
+
+    /**
+     * Handshake is not started.
+     */
+    NONE = 0,
+
+    /**
+     * Handshake is in progress.
+     */
+    IN_PROGRESS = 1,
+
+    /**
+     * Handshake completed successfully.
+     */
+    COMPLETE = 2,
+
+    /**
+     * Handshake failed. Connection is unusable.
+     */
+    FAILED = 3
+
+  };
+
+  /**
+   * Reason of the handshake failure.
+   */
+  enum HandshakeFailure : v_int32 {
+
+    /**
+     * TLS protocol error reported by libtls. Ex.: no shared cipher, bad certificate, alert from the peer.
+     */
+    PROTOCOL = 0,
+
+    /**
+     * Peer certificate chain is not trusted by &id:oatpp::libressl::TrustStore;.
+     */
+    PEER_VERIFICATION = 1,
+
+    /**
+     * TLS could not be set up for the connection. Ex.: `tls_accept_cbs` failed.
+     */
+    SETUP = 2,
+
+    /**
+     * Transport stream was closed or broken during the handshake.
+     */
+    TRANSPORT = 3,
+
+    /**
+     * Server name could not be taken from the ClientHello. Ex.: malformed or oversized ClientHello,
+     * or the certificate provider failed to get the server context by name.
+     */
+    SERVER_NAME = 4
+
+  };
+
+public:
+
+  /**
+   * Counters of the I/O retries returned by the connection.
+   */
+  struct RetryStatistics {
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_READ; results.
+     */
+    v_int64 readRetries;
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_WRITE; results.
+     */
+    v_int64 writeRetries;
+
+    /**
+     * Number of retries returned without the transport waiting for any I/O event.
+     * Caller has to reschedule such operations blindly, so this number is expected to stay close to zero.
+     */
+    v_int64 spuriousRetries;
+
+  };
+
+  /**
+   * Metrics of the connection. See &l:Connection::getMetrics ();.
+   */
+  struct Metrics {
+
+    /**
+     * Tick of the first handshake step in microseconds. `0` if handshake is not started.
+     */
+    v_int64 handshakeStartTick;
+
+    /**
+     * Tick of the handshake completion or failure in microseconds. `0` if handshake is not finished.
+     */
+    v_int64 handshakeEndTick;
+
+    /**
+     * Plaintext bytes returned by `tls_read`.
+     */
+    v_int64 plaintextBytesRead;
+
+    /**
+     * Plaintext bytes accepted by `tls_write`.
+     */
+    v_int64 plaintextBytesWritten;
+
+    /**
+     * Ciphertext bytes read from the transport, including handshake.
+     */
+    v_int64 ciphertextBytesRead;
+
+    /**
+     * Ciphertext bytes written to the transport, including handshake.
+     */
+    v_int64 ciphertextBytesWritten;
+
+    /**
+     * TLS records read from the transport.
+     */
+    v_int64 recordsRead;
+
+    /**
+     * TLS records written to the transport.
+     */
+    v_int64 recordsWritten;
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_READ; results.
+     */
+    v_int64 readRetries;
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_WRITE; results.
+     */
+    v_int64 writeRetries;
+
+    /**
+     * Number of `tls_read` calls.
+     */
+    v_int64 tlsReadCalls;
+
+    /**
+     * Number of `tls_write` calls.
+     */
+    v_int64 tlsWriteCalls;
+
+    /**
+     * Time spent inside `tls_read` in microseconds.
+     */
+    v_int64 tlsReadMicro;
+
+    /**
+     * Time spent inside `tls_write` in microseconds.
+     */
+    v_int64 tlsWriteMicro;
+
+  };
+
+  /**
+   * Data buffer descriptor for &l:Connection::writeVectored ();.
+   */
+  struct WriteVector {
+
+    /**
+     * Pointer to data.
+     */
+    const void* data;
+
+    /**
+     * Size of the data in bytes.
+     */
+    v_buff_size size;
+
+  };
+
+private:
+  static thread_local IOSlot* CURRENT_IO_SLOT;
 private:
   TLSHandle m_tlsHandle;
   std::shared_ptr<TLSObject> m_tlsObject;
   provider::ResourceHandle<oatpp::data::stream::IOStream> m_stream;
+  /* set once the handshake is complete and its properties are published - under m_initMutex */
   std::atomic<bool> m_initialized;
+  std::mutex m_initMutex;
 private:
-  async::Action* m_ioAction;
-  concurrency::SpinLock m_ioLock;
-
-  void packIOAction(async::Action* action);
-  async::Action* unpackIOAction();
-
+  IOSlot m_readSlot;
+  IOSlot m_writeSlot;
+  IOSlot m_handshakeSlot;
+  /* libssl is not thread-safe per connection - every tls_* call on the handle is made under this lock */
+  std::mutex m_tlsMutex;
+  /* transport reads and writes of the staged ciphertext are made with the TLS lock released */
+  std::mutex m_transportReadMutex;
+  std::mutex m_transportWriteMutex;
+private:
+  bool m_tlsInitialized;
+  std::atomic<HandshakeState> m_handshakeState;
+  std::mutex m_handshakeMutex;
+  v_int64 m_handshakeStartTick;
+  v_int64 m_handshakeEndTick;
+  std::shared_ptr<HandshakeWorkerPool> m_handshakeWorkerPool;
+  /* set by createShared() - offloaded handshake steps hold the connection through it */
+  std::weak_ptr<Connection> m_self;
+  std::shared_ptr<Config::TicketKeysLock> m_ticketKeysLock;
+  std::shared_ptr<std::mutex> m_sessionFileMutex;
+  std::shared_ptr<TrustStore> m_trustStore;
+  std::shared_ptr<server::CertificateProvider> m_certificateProvider;
+  std::shared_ptr<TLSObject> m_serverContext;
+  bool m_serverNamePending;
+private:
+  Buffer m_clientHello;
+  Buffer m_readAhead;
+  bool m_readAheadEnabled;
+  bool m_inputClosed;
+  ssize_t m_inputCloseResult;
+  Buffer m_stagedOutput;
+  Buffer m_readBuffer;
+  Buffer m_writeBuffer;
+  bool m_corked;
+private:
+  std::shared_ptr<ConnectionStatistics> m_statistics;
+  MetricCounters m_metrics;
+  RecordParser m_inRecords;
+  RecordParser m_outRecords;
+  std::atomic<bool> m_transportFailed;
+  std::shared_ptr<HandshakeProfiler> m_handshakeProfiler;
+  HandshakeTimeline m_handshakeTimeline;
+private:
+  Config::RecordSizePolicy m_recordSizePolicy;
+  v_int64 m_recordBytesSent;
+  v_int64 m_lastWriteTick;
+  /* length of the tls_write which returned retry - libssl requires the same length on retry */
+  v_buff_size m_pendingWriteSize;
+private:
+  bool initTLS();
+  bool acceptTLS(TLSHandle serverHandle);
+  v_io_size acceptByServerName();
+  v_io_size completeHandshake();
+  bool verifyPeerChain();
+  void onHandshakeComplete();
+  void setHandshakeProperty(const oatpp::String& key, const char* value);
+  void publishHandshakeProperties();
+  void profileTransportIO(bool read);
+  oatpp::String getServerCertificateType();
+  void onHandshakeFailed(HandshakeFailure reason);
+  static v_io_size mapTLSResult(ssize_t result);
+  ssize_t callTLS(TLSCall call, void *buff, v_buff_size count);
+  int handshakeStep();
+  bool isInputStaged();
+  bool isOutputStaged();
+  ssize_t stageOutput(IOSlot& slot, const void *buff, v_buff_size count);
+  v_io_size receiveStagedInput(IOSlot& slot);
+  v_io_size sendStagedOutput(IOSlot& slot);
+  void countCiphertext(bool read, const void *data, v_io_size size);
+  v_io_size readTransport(void *buff, v_buff_size count, async::Action& action);
+  v_io_size readTLS(void *buff, v_buff_size count);
+  static void resizeBuffer(Buffer& buffer, v_buff_size size);
+  static v_buff_size drainBuffer(Buffer& buffer, void *buff, v_buff_size count);
+  v_io_size writeTLS(const void *buff, v_buff_size count);
+  v_io_size callTLSRead(void *buff, v_buff_size count);
+  v_io_size callTLSWrite(const void *buff, v_buff_size count);
+  static v_int64 countRecords(RecordParser& parser, const void *data, v_buff_size size);
+  v_io_size writeBuffered(const void *buff, v_buff_size count);
+  v_io_size flushWriteBuffer();
 private:
   ConnectionContext* m_inContext;
   ConnectionContext* m_outContext;
@@ -102,11 +459,112 @@ public:
   Connection(const std::shared_ptr<TLSObject>& tlsObject,
              const provider::ResourceHandle<data::stream::IOStream>& stream);
 
+  /**
+   * Create shared Connection. <br>
+   * Handshake steps are offloaded to the &id:oatpp::libressl::HandshakeWorkerPool; only for the connections created here -
+   * other connections run the whole handshake on the executor thread.
+   * @param tlsObject - &id:oatpp::libressl::TLSObject;.
+   * @param stream - underlying transport stream. &id:oatpp::data::stream::IOStream;.
+   * @return - `std::shared_ptr` to Connection.
+   */
+  static std::shared_ptr<Connection> createShared(const std::shared_ptr<TLSObject>& tlsObject,
+                                                  const provider::ResourceHandle<data::stream::IOStream>& stream);
+
   /**
    * Virtual destructor.
    */
   ~Connection();
 
+  /**
+   * Apply connection options of the &id:oatpp::libressl::Config;, such as buffer sizes. <br>
+   * Must be called before the connection is initialized.
+   * @param config - &id:oatpp::libressl::Config;.
+   */
+  void applyConfig(const std::shared_ptr<Config>& config);
+
+  /**
+   * Set provider of `tls_server` contexts by SNI server name. <br>
+   * Server only. Must be called before the connection is initialized.
+   * @param provider - &id:oatpp::libressl::server::CertificateProvider;. `nullptr` - always use the TLS object passed to the constructor.
+   */
+  void setCertificateProvider(const std::shared_ptr<server::CertificateProvider>& provider);
+
+  /**
+   * Set pool to run asynchronous handshake steps on. `nullptr` - run handshake on the executor thread (default). <br>
+   * Takes effect for connections created with &l:Connection::createShared ();. Must be called before the connection is initialized.
+   * @param pool - &id:oatpp::libressl::HandshakeWorkerPool;.
+   */
+  void setHandshakeWorkerPool(const std::shared_ptr<HandshakeWorkerPool>& pool);
+
+  /**
+   * Set statistics to report the connection metrics to. Handshakes and per-call `tls_read`/`tls_write` latencies and bytes
+   * are reported as they happen, other connection counters are added when the connection is destroyed. <br>
+   * Must be called before the connection is initialized.
+   * @param statistics - &id:oatpp::libressl::ConnectionStatistics;. `nullptr` - don't report.
+   */
+  void setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics);
+
+  /**
+   * Set size of the ciphertext read-ahead buffer. `0` - disable read-ahead. <br>
+   * Must be called before the connection is initialized.
+   * @param size - buffer size in bytes.
+   */
+  void setReadAheadBufferSize(v_buff_size size);
+
+  /**
+   * Set size of the plaintext read buffer. `0` - disable buffering. <br>
+   * When set, reads smaller than the buffer decrypt as much as available into the buffer,
+   * and subsequent reads are served from memory without calling `tls_read`. <br>
+   * Must be called before the connection is initialized.
+   * @param size - buffer size in bytes.
+   */
+  void setReadBufferSize(v_buff_size size);
+
+  /**
+   * Get number of decrypted bytes that are buffered and can be read without any I/O.
+   * @return - number of bytes.
+   */
+  v_buff_size getPendingBytes() const;
+
+  /**
+   * Set size of the write buffer. `0` - disable buffering. <br>
+   * While the connection is corked (see &l:Connection::cork ();) writes are gathered in the buffer and sent in full-size TLS records.
+   * Buffer is sent when it's full and on &l:Connection::flush ();. Writes of the uncorked connection are not buffered. <br>
+   * Must be called before the connection is initialized.
+   * @param size - buffer size in bytes. Use TLS max record size (16KB) for best results.
+   */
+  void setWriteBufferSize(v_buff_size size);
+
+  /**
+   * Start gathering writes in the write buffer. Writer calls it at the beginning of a message (Ex.: HTTP response)
+   * and signals the end of the message with &l:Connection::flush (); or &l:Connection::flushAsync ();, which send the
+   * gathered data and uncork the connection. <br>
+   * No effect if the write buffer is not set. Data left in the buffer when the connection is closed is reported as an error.
+   */
+  void cork();
+
+  /**
+   * Get number of bytes gathered in the write buffer and not yet sent.
+   * @return - number of bytes.
+   */
+  v_buff_size getUnflushedBytes() const;
+
+  /**
+   * Non-blocking check if an idle connection can be reused. <br>
+   * Connection is not reusable if the handshake is not complete, if there is unread data,
+   * or if a probe read reports anything but "no data yet" - peer sent close_notify, transport is closed,
+   * or the peer sent unsolicited data.
+   * *Must not be called while the connection is used by other threads.*
+   * @return - `true` if connection is alive and idle.
+   */
+  bool isAlive();
+
+  /**
+   * Set dynamic TLS record sizing policy. See &id:oatpp::libressl::Config::RecordSizePolicy;.
+   * @param policy - &id:oatpp::libressl::Config::RecordSizePolicy;.
+   */
+  void setRecordSizePolicy(const Config::RecordSizePolicy& policy);
+
   /**
    * Write operation callback.
    * @param data - pointer to data.
@@ -117,6 +575,37 @@ public:
    */
   v_io_size write(const void *data, v_buff_size count, async::Action& action) override;
 
+  /**
+   * Write multiple buffers with one call. <br>
+   * When the connection is corked all buffers are gathered into the same TLS records.
+   * @param vectors - array of &l:Connection::WriteVector;.
+   * @param count - number of elements in the array.
+   * @param action - async specific action. If action is NOT &id:oatpp::async::Action::TYPE_NONE;, then
+   * caller MUST return this action on coroutine iteration.
+   * @return - actual number of bytes written (buffers are consumed in order).
+   */
+  v_io_size writeVectored(const WriteVector* vectors, v_int32 count, async::Action& action);
+
+  /**
+   * Send all data gathered in the write buffer and uncork the connection.
+   * @param action - async specific action. If action is NOT &id:oatpp::async::Action::TYPE_NONE;, then
+   * caller MUST return this action on coroutine iteration.
+   * @return - `0` when the buffer is fully flushed, or &id:oatpp::IOError;.
+   */
+  v_io_size flush(async::Action& action);
+
+  /**
+   * Send all data gathered in the write buffer and uncork the connection. For connections in blocking mode.
+   * @return - `0` when the buffer is fully flushed, or &id:oatpp::IOError;.
+   */
+  v_io_size flush();
+
+  /**
+   * Send all data gathered in the write buffer and uncork the connection in asynchronous manner.
+   * @return - &id:oatpp::async::CoroutineStarter;.
+   */
+  async::CoroutineStarter flushAsync();
+
   /**
    * Read operation callback.
    * @param buffer - pointer to buffer.
@@ -164,7 +653,33 @@ public:
   oatpp::data::stream::Context& getInputStreamContext() override;
 
   /**
-   * Close TLS handles.
+   * Get state of the TLS handshake.
+   * @return - &l:Connection::HandshakeState;.
+   */
+  HandshakeState getHandshakeState() const;
+
+  /**
+   * Get counters of the I/O retries returned by the connection.
+   * @return - &l:Connection::RetryStatistics;.
+   */
+  RetryStatistics getRetryStatistics() const;
+
+  /**
+   * Get time spent on the TLS handshake, from the first handshake step until completion or failure.
+   * @return - duration in microseconds. `-1` if handshake is not finished.
+   */
+  v_int64 getHandshakeDuration() const;
+
+  /**
+   * Get metrics of the connection.
+   * @return - &l:Connection::Metrics;.
+   */
+  Metrics getMetrics() const;
+
+  /**
+   * Close TLS handles. <br>
+   * Corked data left unflushed and the `close_notify` alert are sent as far as the transport takes them without blocking.
+   * The transport is switched to the non-blocking output mode for that - the connection is not usable after the call.
    */
   void closeTLS();
 
@@ -181,6 +696,15 @@ public:
   TLSHandle getTlsHandle() {
     return m_tlsHandle;
   }
+
+  /**
+   * Get TLS object the connection was created with. For a server connection - the `tls_server` context it's accepted on
+   * (unless the context is chosen by SNI).
+   * @return - &id:oatpp::libressl::TLSObject;.
+   */
+  std::shared_ptr<TLSObject> getTLSObject() {
+    return m_tlsObject;
+  }
   
 };
   
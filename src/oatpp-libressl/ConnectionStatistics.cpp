@@ -0,0 +1,254 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ConnectionStatistics.hpp"
+
+#include <cstring>
+#include <thread>
+
+namespace oatpp { namespace libressl {
+
+constexpr v_int32 ConnectionStatistics::HISTOGRAM_BUCKETS;
+constexpr v_int32 ConnectionStatistics::HANDSHAKE_FAILURE_REASONS;
+
+std::atomic<v_int32> ConnectionStatistics::THREADS_COUNTER(0);
+thread_local v_int32 ConnectionStatistics::THREAD_INDEX = -1;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Histogram
+
+void ConnectionStatistics::Histogram::add(v_int64 value) {
+  buckets[getBucketIndex(value)] ++;
+  count ++;
+  sum += value;
+}
+
+v_int64 ConnectionStatistics::Histogram::getPercentile(v_float64 percentile) const {
+
+  if(count == 0) {
+    return 0;
+  }
+
+  v_int64 rank = (v_int64) (percentile * count);
+  if(rank < 1) {
+    rank = 1;
+  }
+
+  v_int64 total = 0;
+  for(v_int32 i = 0; i < HISTOGRAM_BUCKETS - 1; i ++) {
+    total += buckets[i];
+    if(total >= rank) {
+      return getBucketUpperBound(i);
+    }
+  }
+
+  /* not bounded - the lower bound is the best guess */
+  return getBucketUpperBound(HISTOGRAM_BUCKETS - 2);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AtomicHistogram
+
+ConnectionStatistics::AtomicHistogram::AtomicHistogram()
+  : m_count(0)
+  , m_sum(0)
+{
+  for(v_int32 i = 0; i < HISTOGRAM_BUCKETS; i ++) {
+    m_buckets[i] = 0;
+  }
+}
+
+void ConnectionStatistics::AtomicHistogram::add(v_int64 value) {
+  m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void ConnectionStatistics::AtomicHistogram::addTo(Histogram& histogram) const {
+  for(v_int32 i = 0; i < HISTOGRAM_BUCKETS; i ++) {
+    histogram.buckets[i] += m_buckets[i].load(std::memory_order_relaxed);
+  }
+  histogram.count += m_count.load(std::memory_order_relaxed);
+  histogram.sum += m_sum.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shard
+
+ConnectionStatistics::Shard::Shard()
+  : connectionsOpened(0)
+  , connectionsClosed(0)
+  , handshakes(0)
+  , resumedHandshakes(0)
+  , plaintextBytesRead(0)
+  , plaintextBytesWritten(0)
+  , ciphertextBytesRead(0)
+  , ciphertextBytesWritten(0)
+  , recordsRead(0)
+  , recordsWritten(0)
+  , readRetries(0)
+  , writeRetries(0)
+{
+  for(v_int32 i = 0; i < HANDSHAKE_FAILURE_REASONS; i ++) {
+    handshakeFailures[i] = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ConnectionStatistics
+
+ConnectionStatistics::ConnectionStatistics(v_int32 shardsCount)
+  : m_shardsCount(shardsCount)
+{
+
+  if(m_shardsCount <= 0) {
+    m_shardsCount = (v_int32) std::thread::hardware_concurrency();
+  }
+
+  if(m_shardsCount <= 0) {
+    m_shardsCount = 1;
+  }
+
+  m_shards.reset(new Shard[m_shardsCount]);
+
+}
+
+std::shared_ptr<ConnectionStatistics> ConnectionStatistics::createShared(v_int32 shardsCount) {
+  return std::make_shared<ConnectionStatistics>(shardsCount);
+}
+
+v_int32 ConnectionStatistics::getBucketIndex(v_int64 value) {
+  v_int32 index = 0;
+  while(value > 0 && index < HISTOGRAM_BUCKETS - 1) {
+    value >>= 1;
+    index ++;
+  }
+  return index;
+}
+
+v_int64 ConnectionStatistics::getBucketUpperBound(v_int32 index) {
+  if(index >= HISTOGRAM_BUCKETS - 1) {
+    return -1;
+  }
+  return ((v_int64) 1) << index;
+}
+
+ConnectionStatistics::Shard& ConnectionStatistics::getShard() {
+
+  /* threads are numbered once - consecutive threads get different shards */
+  if(THREAD_INDEX < 0) {
+    THREAD_INDEX = THREADS_COUNTER.fetch_add(1, std::memory_order_relaxed) & 0x7FFFFFFF;
+  }
+
+  return m_shards[THREAD_INDEX % m_shardsCount];
+
+}
+
+void ConnectionStatistics::onConnectionOpened() {
+  getShard().connectionsOpened.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConnectionStatistics::onHandshake(bool resumed, v_int64 durationMicro) {
+  auto& shard = getShard();
+  if(resumed) {
+    shard.resumedHandshakes.fetch_add(1, std::memory_order_relaxed);
+    shard.resumedHandshakeLatency.add(durationMicro);
+  } else {
+    shard.handshakes.fetch_add(1, std::memory_order_relaxed);
+    shard.handshakeLatency.add(durationMicro);
+  }
+}
+
+void ConnectionStatistics::onHandshakeFailed(Connection::HandshakeFailure reason) {
+  v_int32 index = reason;
+  if(index < 0 || index >= HANDSHAKE_FAILURE_REASONS) {
+    index = Connection::HandshakeFailure::PROTOCOL;
+  }
+  getShard().handshakeFailures[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConnectionStatistics::onTlsRead(v_int64 durationMicro, v_int64 bytes) {
+  auto& shard = getShard();
+  shard.tlsReadLatency.add(durationMicro);
+  if(bytes > 0) {
+    shard.plaintextBytesRead.fetch_add(bytes, std::memory_order_relaxed);
+  }
+}
+
+void ConnectionStatistics::onTlsWrite(v_int64 durationMicro, v_int64 bytes) {
+  auto& shard = getShard();
+  shard.tlsWriteLatency.add(durationMicro);
+  if(bytes > 0) {
+    shard.plaintextBytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+  }
+}
+
+void ConnectionStatistics::onConnectionClosed(const Connection::Metrics& metrics) {
+  auto& shard = getShard();
+  shard.connectionsClosed.fetch_add(1, std::memory_order_relaxed);
+  shard.ciphertextBytesRead.fetch_add(metrics.ciphertextBytesRead, std::memory_order_relaxed);
+  shard.ciphertextBytesWritten.fetch_add(metrics.ciphertextBytesWritten, std::memory_order_relaxed);
+  shard.recordsRead.fetch_add(metrics.recordsRead, std::memory_order_relaxed);
+  shard.recordsWritten.fetch_add(metrics.recordsWritten, std::memory_order_relaxed);
+  shard.readRetries.fetch_add(metrics.readRetries, std::memory_order_relaxed);
+  shard.writeRetries.fetch_add(metrics.writeRetries, std::memory_order_relaxed);
+}
+
+ConnectionStatistics::Snapshot ConnectionStatistics::getSnapshot() const {
+
+  Snapshot result;
+  std::memset(&result, 0, sizeof(Snapshot));
+
+  for(v_int32 i = 0; i < m_shardsCount; i ++) {
+    const Shard& shard = m_shards[i];
+    result.connectionsOpened += shard.connectionsOpened.load(std::memory_order_relaxed);
+    result.connectionsClosed += shard.connectionsClosed.load(std::memory_order_relaxed);
+    result.handshakes += shard.handshakes.load(std::memory_order_relaxed);
+    result.resumedHandshakes += shard.resumedHandshakes.load(std::memory_order_relaxed);
+    for(v_int32 reason = 0; reason < HANDSHAKE_FAILURE_REASONS; reason ++) {
+      v_int64 failures = shard.handshakeFailures[reason].load(std::memory_order_relaxed);
+      result.handshakeFailuresByReason[reason] += failures;
+      result.handshakeFailures += failures;
+    }
+    result.plaintextBytesRead += shard.plaintextBytesRead.load(std::memory_order_relaxed);
+    result.plaintextBytesWritten += shard.plaintextBytesWritten.load(std::memory_order_relaxed);
+    result.ciphertextBytesRead += shard.ciphertextBytesRead.load(std::memory_order_relaxed);
+    result.ciphertextBytesWritten += shard.ciphertextBytesWritten.load(std::memory_order_relaxed);
+    result.recordsRead += shard.recordsRead.load(std::memory_order_relaxed);
+    result.recordsWritten += shard.recordsWritten.load(std::memory_order_relaxed);
+    result.readRetries += shard.readRetries.load(std::memory_order_relaxed);
+    result.writeRetries += shard.writeRetries.load(std::memory_order_relaxed);
+    shard.handshakeLatency.addTo(result.handshakeLatency);
+    shard.resumedHandshakeLatency.addTo(result.resumedHandshakeLatency);
+    shard.tlsReadLatency.addTo(result.tlsReadLatency);
+    shard.tlsWriteLatency.addTo(result.tlsWriteLatency);
+  }
+
+  return result;
+
+}
+
+}}
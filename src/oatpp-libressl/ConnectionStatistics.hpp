@@ -0,0 +1,309 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_ConnectionStatistics_hpp
+#define oatpp_libressl_ConnectionStatistics_hpp
+
+#include "oatpp-libressl/Connection.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Aggregated metrics of the connections of a connection provider. <br>
+ * Counters and histograms are sharded - every thread updates its own shard with relaxed atomic increments,
+ * so recording doesn't take locks and threads don't contend on the same cache lines.
+ * Shards are summed up on &l:ConnectionStatistics::getSnapshot ();.
+ */
+class ConnectionStatistics {
+public:
+
+  /**
+   * Number of histogram buckets.
+   * Bucket `0` counts zero values, bucket `i` counts values in `[2^(i-1), 2^i)`, the last bucket counts everything above.
+   */
+  static constexpr v_int32 HISTOGRAM_BUCKETS = 32;
+
+  /**
+   * Number of &id:oatpp::libressl::Connection::HandshakeFailure; reasons.
+   */
+  static constexpr v_int32 HANDSHAKE_FAILURE_REASONS = 5;
+
+  /**
+   * Histogram with power-of-two buckets. Values are in microseconds.
+   */
+  struct Histogram {
+
+    /**
+     * Number of values in each bucket.
+     */
+    v_int64 buckets[HISTOGRAM_BUCKETS];
+
+    /**
+     * Total number of values.
+     */
+    v_int64 count;
+
+    /**
+     * Sum of all values.
+     */
+    v_int64 sum;
+
+    /**
+     * Add value. Not thread-safe.
+     * @param value
+     */
+    void add(v_int64 value);
+
+    /**
+     * Get approximate percentile - upper bound of the bucket containing it.
+     * @param percentile - percentile in range `(0, 1]`. Ex.: `0.99`.
+     * @return - value. `0` if histogram is empty.
+     */
+    v_int64 getPercentile(v_float64 percentile) const;
+
+  };
+
+  /**
+   * Snapshot of the aggregated metrics.
+   */
+  struct Snapshot {
+
+    /**
+     * Number of connections created.
+     */
+    v_int64 connectionsOpened;
+
+    /**
+     * Number of destroyed connections. Ciphertext, records and retries counters below are added when connection is destroyed.
+     */
+    v_int64 connectionsClosed;
+
+    /**
+     * Number of completed full handshakes.
+     */
+    v_int64 handshakes;
+
+    /**
+     * Number of completed handshakes which resumed a session.
+     */
+    v_int64 resumedHandshakes;
+
+    /**
+     * Number of failed handshakes.
+     */
+    v_int64 handshakeFailures;
+
+    /**
+     * Number of failed handshakes by reason. Indexed by &id:oatpp::libressl::Connection::HandshakeFailure;.
+     */
+    v_int64 handshakeFailuresByReason[HANDSHAKE_FAILURE_REASONS];
+
+    /**
+     * Plaintext bytes returned by `tls_read` (decrypted).
+     */
+    v_int64 plaintextBytesRead;
+
+    /**
+     * Plaintext bytes accepted by `tls_write` (encrypted).
+     */
+    v_int64 plaintextBytesWritten;
+
+    /**
+     * Ciphertext bytes read from the transport, including handshake.
+     */
+    v_int64 ciphertextBytesRead;
+
+    /**
+     * Ciphertext bytes written to the transport, including handshake.
+     */
+    v_int64 ciphertextBytesWritten;
+
+    /**
+     * TLS records read.
+     */
+    v_int64 recordsRead;
+
+    /**
+     * TLS records written.
+     */
+    v_int64 recordsWritten;
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_READ; results.
+     */
+    v_int64 readRetries;
+
+    /**
+     * Number of &id:oatpp::IOError::RETRY_WRITE; results.
+     */
+    v_int64 writeRetries;
+
+    /**
+     * Duration of completed full handshakes.
+     */
+    Histogram handshakeLatency;
+
+    /**
+     * Duration of completed handshakes which resumed a session.
+     */
+    Histogram resumedHandshakeLatency;
+
+    /**
+     * Time spent inside each `tls_read` call.
+     */
+    Histogram tlsReadLatency;
+
+    /**
+     * Time spent inside each `tls_write` call.
+     */
+    Histogram tlsWriteLatency;
+
+  };
+
+private:
+
+  class AtomicHistogram {
+  private:
+    std::atomic<v_int64> m_buckets[HISTOGRAM_BUCKETS];
+    std::atomic<v_int64> m_count;
+    std::atomic<v_int64> m_sum;
+  public:
+    AtomicHistogram();
+    void add(v_int64 value);
+    void addTo(Histogram& histogram) const;
+  };
+
+  struct Shard {
+    std::atomic<v_int64> connectionsOpened;
+    std::atomic<v_int64> connectionsClosed;
+    std::atomic<v_int64> handshakes;
+    std::atomic<v_int64> resumedHandshakes;
+    std::atomic<v_int64> handshakeFailures[HANDSHAKE_FAILURE_REASONS];
+    std::atomic<v_int64> plaintextBytesRead;
+    std::atomic<v_int64> plaintextBytesWritten;
+    std::atomic<v_int64> ciphertextBytesRead;
+    std::atomic<v_int64> ciphertextBytesWritten;
+    std::atomic<v_int64> recordsRead;
+    std::atomic<v_int64> recordsWritten;
+    std::atomic<v_int64> readRetries;
+    std::atomic<v_int64> writeRetries;
+    AtomicHistogram handshakeLatency;
+    AtomicHistogram resumedHandshakeLatency;
+    AtomicHistogram tlsReadLatency;
+    AtomicHistogram tlsWriteLatency;
+    /* keep shards of different threads on different cache lines */
+    v_char8 padding[64];
+    Shard();
+  };
+
+private:
+  static std::atomic<v_int32> THREADS_COUNTER;
+  static thread_local v_int32 THREAD_INDEX;
+private:
+  std::unique_ptr<Shard[]> m_shards;
+  v_int32 m_shardsCount;
+private:
+  Shard& getShard();
+public:
+
+  /**
+   * Constructor.
+   * @param shardsCount - number of shards. `0` - number of hardware threads.
+   */
+  ConnectionStatistics(v_int32 shardsCount = 0);
+
+  /**
+   * Create shared ConnectionStatistics.
+   * @param shardsCount - number of shards. `0` - number of hardware threads.
+   * @return - `std::shared_ptr` to ConnectionStatistics.
+   */
+  static std::shared_ptr<ConnectionStatistics> createShared(v_int32 shardsCount = 0);
+
+  /**
+   * Get histogram bucket of the value.
+   * @param value
+   * @return - bucket index.
+   */
+  static v_int32 getBucketIndex(v_int64 value);
+
+  /**
+   * Get exclusive upper bound of the histogram bucket.
+   * @param index - bucket index.
+   * @return - upper bound. `-1` for the last bucket which is not bounded.
+   */
+  static v_int64 getBucketUpperBound(v_int32 index);
+
+  /**
+   * Record created connection.
+   */
+  void onConnectionOpened();
+
+  /**
+   * Record completed handshake.
+   * @param resumed - `true` if the handshake resumed a session.
+   * @param durationMicro - handshake duration in microseconds.
+   */
+  void onHandshake(bool resumed, v_int64 durationMicro);
+
+  /**
+   * Record failed handshake.
+   * @param reason - &id:oatpp::libressl::Connection::HandshakeFailure;.
+   */
+  void onHandshakeFailed(Connection::HandshakeFailure reason);
+
+  /**
+   * Record `tls_read` call.
+   * @param durationMicro - time spent in the call in microseconds.
+   * @param bytes - plaintext bytes returned by the call.
+   */
+  void onTlsRead(v_int64 durationMicro, v_int64 bytes);
+
+  /**
+   * Record `tls_write` call.
+   * @param durationMicro - time spent in the call in microseconds.
+   * @param bytes - plaintext bytes accepted by the call.
+   */
+  void onTlsWrite(v_int64 durationMicro, v_int64 bytes);
+
+  /**
+   * Add counters of the destroyed connection.
+   * @param metrics - &id:oatpp::libressl::Connection::Metrics;.
+   */
+  void onConnectionClosed(const Connection::Metrics& metrics);
+
+  /**
+   * Get snapshot of the aggregated metrics.
+   * @return - &l:ConnectionStatistics::Snapshot;.
+   */
+  Snapshot getSnapshot() const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_ConnectionStatistics_hpp
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "HandshakeProfiler.hpp"
+
+#include <cstring>
+
+namespace oatpp { namespace libressl {
+
+const char* const HandshakeProfiler::UNKNOWN = "unknown";
+
+std::shared_ptr<HandshakeProfiler> HandshakeProfiler::createShared() {
+  return std::make_shared<HandshakeProfiler>();
+}
+
+void HandshakeProfiler::onHandshake(const char* cipher, const oatpp::String& certificateType, const HandshakeTimeline& timeline) {
+
+  if(cipher == nullptr) {
+    cipher = UNKNOWN;
+  }
+
+  const char* type = certificateType ? certificateType->c_str() : UNKNOWN;
+
+  std::string key(cipher);
+  key.push_back('/');
+  key.append(type);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_profiles.find(key);
+  if(it == m_profiles.end()) {
+    Profile profile;
+    std::memset(profile.phases, 0, sizeof(profile.phases));
+    std::memset(&profile.total, 0, sizeof(profile.total));
+    profile.cipher = cipher;
+    profile.certificateType = type;
+    profile.flights = 0;
+    it = m_profiles.insert({key, profile}).first;
+  }
+
+  Profile& profile = it->second;
+  for(v_int32 i = 0; i < HandshakeTimeline::PHASES_COUNT; i ++) {
+    profile.phases[i].add(timeline.getPhaseDuration((HandshakeTimeline::Phase) i));
+  }
+  profile.total.add(timeline.getDuration());
+  profile.flights += timeline.getFlightsCount();
+
+}
+
+std::vector<HandshakeProfiler::Profile> HandshakeProfiler::getProfiles() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Profile> result;
+  result.reserve(m_profiles.size());
+  for(auto& pair : m_profiles) {
+    result.push_back(pair.second);
+  }
+  return result;
+}
+
+void HandshakeProfiler::reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_profiles.clear();
+}
+
+}}
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_HandshakeProfiler_hpp
+#define oatpp_libressl_HandshakeProfiler_hpp
+
+#include "oatpp-libressl/ConnectionStatistics.hpp"
+#include "oatpp-libressl/HandshakeTimeline.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Handshake phase profiler. Aggregates &id:oatpp::libressl::HandshakeTimeline; of completed handshakes
+ * into per-phase latency histograms, split by cipher suite and certificate type. <br>
+ * Shows whether the handshake time goes to local computation (RSA signing, ECDHE), to sending large flights
+ * (certificate chain) or to waiting for the peer (network round trips). <br>
+ * Enabled with &id:oatpp::libressl::Config::setHandshakeProfiler;. Each completed handshake takes the profiler lock once -
+ * meant for tuning sessions rather than to be left on under the full load.
+ */
+class HandshakeProfiler {
+public:
+
+  /**
+   * Label used when cipher suite or certificate type is not known.
+   */
+  static const char* const UNKNOWN;
+
+  /**
+   * Profile of handshakes with the same cipher suite and certificate type.
+   */
+  struct Profile {
+
+    /**
+     * Cipher suite. Ex.: `TLS_AES_256_GCM_SHA384`.
+     */
+    oatpp::String cipher;
+
+    /**
+     * Key type of the server certificate. See &id:oatpp::libressl::CertificateIndex::getCertificateType;.
+     */
+    oatpp::String certificateType;
+
+    /**
+     * Latency of each phase. Indexed by &id:oatpp::libressl::HandshakeTimeline::Phase;.
+     */
+    ConnectionStatistics::Histogram phases[HandshakeTimeline::PHASES_COUNT];
+
+    /**
+     * Handshake duration. `total.count` is the number of handshakes in the profile.
+     */
+    ConnectionStatistics::Histogram total;
+
+    /**
+     * Sum of flights of all handshakes.
+     */
+    v_int64 flights;
+
+  };
+
+private:
+  std::unordered_map<std::string, Profile> m_profiles;
+  mutable std::mutex m_mutex;
+public:
+
+  /**
+   * Create shared HandshakeProfiler.
+   * @return - `std::shared_ptr` to HandshakeProfiler.
+   */
+  static std::shared_ptr<HandshakeProfiler> createShared();
+
+  /**
+   * Add timeline of the completed handshake.
+   * @param cipher - cipher suite. `nullptr` - &l:HandshakeProfiler::UNKNOWN;.
+   * @param certificateType - key type of the server certificate. `nullptr` - &l:HandshakeProfiler::UNKNOWN;.
+   * @param timeline - &id:oatpp::libressl::HandshakeTimeline;.
+   */
+  void onHandshake(const char* cipher, const oatpp::String& certificateType, const HandshakeTimeline& timeline);
+
+  /**
+   * Get profiles collected so far.
+   * @return - `std::vector` of &l:HandshakeProfiler::Profile;.
+   */
+  std::vector<Profile> getProfiles() const;
+
+  /**
+   * Drop collected profiles.
+   */
+  void reset();
+
+};
+
+}}
+
+#endif // oatpp_libressl_HandshakeProfiler_hpp
@@ -0,0 +1,105 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "HandshakeTimeline.hpp"
+
+namespace oatpp { namespace libressl {
+
+constexpr v_int32 HandshakeTimeline::PHASES_COUNT;
+
+HandshakeTimeline::HandshakeTimeline()
+  : m_startTick(0)
+  , m_lastTick(0)
+  , m_lastEvent(Event::NONE)
+  , m_flights(0)
+{
+  for(v_int32 i = 0; i < PHASES_COUNT; i ++) {
+    m_phases[i] = 0;
+  }
+}
+
+const char* HandshakeTimeline::getPhaseName(Phase phase) {
+  switch(phase) {
+    case Phase::PROCESSING: return "processing";
+    case Phase::SENDING: return "sending";
+    case Phase::WAITING: return "waiting";
+    case Phase::RECEIVING: return "receiving";
+    default:
+      return "unknown";
+  }
+}
+
+void HandshakeTimeline::start(v_int64 tick) {
+  m_startTick = tick;
+  m_lastTick = tick;
+  m_lastEvent = Event::NONE;
+  m_flights = 0;
+  for(v_int32 i = 0; i < PHASES_COUNT; i ++) {
+    m_phases[i] = 0;
+  }
+}
+
+void HandshakeTimeline::onRead(v_int64 tick) {
+  if(m_lastEvent == Event::READ) {
+    m_phases[Phase::RECEIVING] += tick - m_lastTick;
+  } else {
+    m_phases[Phase::WAITING] += tick - m_lastTick;
+    m_flights ++;
+  }
+  m_lastTick = tick;
+  m_lastEvent = Event::READ;
+}
+
+void HandshakeTimeline::onWrite(v_int64 tick) {
+  if(m_lastEvent == Event::WRITE) {
+    m_phases[Phase::SENDING] += tick - m_lastTick;
+  } else {
+    m_phases[Phase::PROCESSING] += tick - m_lastTick;
+    m_flights ++;
+  }
+  m_lastTick = tick;
+  m_lastEvent = Event::WRITE;
+}
+
+void HandshakeTimeline::finish(v_int64 tick) {
+  /* the last flight is processed (or sent) locally - nothing is awaited after it */
+  m_phases[Phase::PROCESSING] += tick - m_lastTick;
+  m_lastTick = tick;
+  m_lastEvent = Event::NONE;
+}
+
+v_int64 HandshakeTimeline::getPhaseDuration(Phase phase) const {
+  return m_phases[phase];
+}
+
+v_int64 HandshakeTimeline::getDuration() const {
+  return m_lastTick - m_startTick;
+}
+
+v_int32 HandshakeTimeline::getFlightsCount() const {
+  return m_flights;
+}
+
+}}
@@ -0,0 +1,152 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_HandshakeTimeline_hpp
+#define oatpp_libressl_HandshakeTimeline_hpp
+
+#include "oatpp/core/Types.hpp"
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Splits the duration of a TLS handshake into phases by the transport I/O done during the handshake. <br>
+ * The handshake is a sequence of flights - messages sent by one side before it waits for the other.
+ * Time between receiving the peer flight and sending the own flight is spent on local computation (key exchange, signing),
+ * time between sending the own flight and receiving the peer flight is the network round trip plus the peer's computation.
+ */
+class HandshakeTimeline {
+public:
+
+  /**
+   * Handshake phase.
+   */
+  enum Phase : v_int32 {
+
+    /**
+     * Local computation - from the handshake start or the last received bytes to the first bytes of the next own flight.
+     * Includes key exchange, signing with the private key and verification of the peer messages.
+     */
+    PROCESSING = 0,
+
+    /**
+     * Sending of the own flight - from its first to its last write. Grows with the flight size (Ex.: certificate chain)
+     * when the transport can't take the whole flight at once.
+     */
+    SENDING = 1,
+
+    /**
+     * Waiting for the peer - from the last write (or the handshake start) to the first bytes of the peer flight.
+     * Network round trip plus computation on the peer side.
+     */
+    WAITING = 2,
+
+    /**
+     * Receiving of the peer flight - from its first to its last read.
+     */
+    RECEIVING = 3
+
+  };
+
+  /**
+   * Number of phases.
+   */
+  static constexpr v_int32 PHASES_COUNT = 4;
+
+private:
+
+  enum Event : v_int32 {
+    NONE = 0,
+    READ = 1,
+    WRITE = 2
+  };
+
+private:
+  v_int64 m_startTick;
+  v_int64 m_lastTick;
+  Event m_lastEvent;
+  v_int64 m_phases[PHASES_COUNT];
+  v_int32 m_flights;
+public:
+
+  /**
+   * Constructor.
+   */
+  HandshakeTimeline();
+
+  /**
+   * Get name of the phase.
+   * @param phase - &l:HandshakeTimeline::Phase;.
+   * @return - lowercase name. Ex.: `processing`.
+   */
+  static const char* getPhaseName(Phase phase);
+
+  /**
+   * Start the timeline.
+   * @param tick - handshake start in microseconds.
+   */
+  void start(v_int64 tick);
+
+  /**
+   * Record bytes received from the peer.
+   * @param tick - time in microseconds.
+   */
+  void onRead(v_int64 tick);
+
+  /**
+   * Record bytes sent to the peer.
+   * @param tick - time in microseconds.
+   */
+  void onWrite(v_int64 tick);
+
+  /**
+   * Finish the timeline.
+   * @param tick - handshake completion in microseconds.
+   */
+  void finish(v_int64 tick);
+
+  /**
+   * Get time spent in the phase.
+   * @param phase - &l:HandshakeTimeline::Phase;.
+   * @return - duration in microseconds.
+   */
+  v_int64 getPhaseDuration(Phase phase) const;
+
+  /**
+   * Get duration of the handshake - sum of all phases.
+   * @return - duration in microseconds.
+   */
+  v_int64 getDuration() const;
+
+  /**
+   * Get number of flights sent and received.
+   * @return
+   */
+  v_int32 getFlightsCount() const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_HandshakeTimeline_hpp
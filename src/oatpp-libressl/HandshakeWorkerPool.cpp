@@ -0,0 +1,119 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "HandshakeWorkerPool.hpp"
+
+namespace oatpp { namespace libressl {
+
+HandshakeWorkerPool::HandshakeWorkerPool(v_int32 threadsCount)
+  : m_running(true)
+  , m_tasksExecuted(0)
+  , m_threadsCount(threadsCount < 1 ? 1 : threadsCount)
+{
+  for(v_int32 i = 0; i < m_threadsCount; i ++) {
+    m_threads.push_back(std::thread(&HandshakeWorkerPool::run, this));
+  }
+}
+
+HandshakeWorkerPool::~HandshakeWorkerPool() {
+  stop();
+}
+
+std::shared_ptr<HandshakeWorkerPool> HandshakeWorkerPool::createShared(v_int32 threadsCount) {
+  return std::make_shared<HandshakeWorkerPool>(threadsCount);
+}
+
+void HandshakeWorkerPool::run() {
+
+  while(true) {
+
+    Task task;
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while(m_running && m_tasks.empty()) {
+        m_condition.wait(lock);
+      }
+      if(m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+    m_tasksExecuted ++;
+
+  }
+
+}
+
+bool HandshakeWorkerPool::submit(Task&& task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_running) {
+      return false;
+    }
+    m_tasks.push_back(std::move(task));
+  }
+  m_condition.notify_one();
+  return true;
+}
+
+void HandshakeWorkerPool::stop() {
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_running && m_threads.empty()) {
+      return;
+    }
+    m_running = false;
+  }
+
+  m_condition.notify_all();
+
+  for(auto& thread : m_threads) {
+    if(thread.joinable()) {
+      thread.join();
+    }
+  }
+  m_threads.clear();
+
+}
+
+v_int32 HandshakeWorkerPool::getThreadsCount() const {
+  return m_threadsCount;
+}
+
+v_int64 HandshakeWorkerPool::getQueueSize() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return (v_int64) m_tasks.size();
+}
+
+v_int64 HandshakeWorkerPool::getTasksExecuted() const {
+  return m_tasksExecuted;
+}
+
+}}
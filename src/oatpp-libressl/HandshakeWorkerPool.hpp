@@ -0,0 +1,122 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_HandshakeWorkerPool_hpp
+#define oatpp_libressl_HandshakeWorkerPool_hpp
+
+#include "oatpp/core/Types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Dedicated thread pool for TLS handshake steps. <br>
+ * Handshake steps involve private-key operations which may take milliseconds of CPU time.
+ * When a pool is set via &id:oatpp::libressl::Config::setHandshakeWorkerPool;, asynchronous handshakes
+ * (&id:oatpp::libressl::Connection::ConnectionContext::initAsync;) run their steps on the pool threads,
+ * so that the executor threads stay free to serve established connections.
+ */
+class HandshakeWorkerPool {
+public:
+
+  /**
+   * Task to execute.
+   */
+  typedef std::function<void()> Task;
+
+private:
+  std::vector<std::thread> m_threads;
+  std::list<Task> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_running;
+  std::atomic<v_int64> m_tasksExecuted;
+  v_int32 m_threadsCount;
+private:
+  void run();
+public:
+
+  /**
+   * Constructor.
+   * @param threadsCount - number of worker threads.
+   */
+  HandshakeWorkerPool(v_int32 threadsCount = 1);
+
+  /**
+   * Non-virtual destructor.
+   * Calls &l:HandshakeWorkerPool::stop ();.
+   */
+  ~HandshakeWorkerPool();
+
+  /**
+   * Create shared HandshakeWorkerPool.
+   * @param threadsCount - number of worker threads.
+   * @return - `std::shared_ptr` to HandshakeWorkerPool.
+   */
+  static std::shared_ptr<HandshakeWorkerPool> createShared(v_int32 threadsCount = 1);
+
+  /**
+   * Submit task for execution on one of the pool threads.
+   * @param task - &l:HandshakeWorkerPool::Task;.
+   * @return - `true` if the task was accepted. `false` if the pool is stopped.
+   */
+  bool submit(Task&& task);
+
+  /**
+   * Stop the pool and join worker threads. Tasks which are already queued are executed before the threads exit.
+   */
+  void stop();
+
+  /**
+   * Get number of worker threads.
+   * @return
+   */
+  v_int32 getThreadsCount() const;
+
+  /**
+   * Get number of tasks waiting in the queue.
+   * @return
+   */
+  v_int64 getQueueSize();
+
+  /**
+   * Get total number of executed tasks.
+   * @return
+   */
+  v_int64 getTasksExecuted() const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_HandshakeWorkerPool_hpp
@@ -0,0 +1,205 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "PrometheusExporter.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace oatpp { namespace libressl {
+
+const char* const PrometheusExporter::CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+namespace {
+
+/* indexed by Connection::HandshakeFailure */
+const char* const FAILURE_REASONS[ConnectionStatistics::HANDSHAKE_FAILURE_REASONS] = {
+  "protocol",
+  "peer_verification",
+  "setup",
+  "transport",
+  "server_name"
+};
+
+struct Sample {
+  std::string labels;
+  ConnectionStatistics::Snapshot snapshot;
+};
+
+}
+
+PrometheusExporter::PrometheusExporter(const oatpp::String& prefix)
+  : m_prefix(prefix)
+{}
+
+std::shared_ptr<PrometheusExporter> PrometheusExporter::createShared(const oatpp::String& prefix) {
+  return std::make_shared<PrometheusExporter>(prefix);
+}
+
+std::string PrometheusExporter::escapeLabelValue(const oatpp::String& value) {
+  std::string result;
+  result.reserve(value->size());
+  for(char c : *value) {
+    switch(c) {
+      case '\\': result += "\\\\"; break;
+      case '"': result += "\\\""; break;
+      case '\n': result += "\\n"; break;
+      default: result += c;
+    }
+  }
+  return result;
+}
+
+void PrometheusExporter::writeSeconds(data::stream::BufferOutputStream& stream, v_int64 micro) {
+  char buffer[32];
+  int size = std::snprintf(buffer, sizeof(buffer), "%lld.%06lld", (long long) (micro / 1000000), (long long) (micro % 1000000));
+  stream.writeSimple(buffer, size);
+}
+
+void PrometheusExporter::writeHeader(data::stream::BufferOutputStream& stream, const char* name, const char* type, const char* help) const {
+  stream << "# HELP " << m_prefix << "_" << name << " " << help << "\n";
+  stream << "# TYPE " << m_prefix << "_" << name << " " << type << "\n";
+}
+
+void PrometheusExporter::writeSample(data::stream::BufferOutputStream& stream,
+                                     const char* name,
+                                     const std::string& labels,
+                                     v_int64 value) const
+{
+  stream << m_prefix << "_" << name << "{" << labels.c_str() << "} " << value << "\n";
+}
+
+void PrometheusExporter::writeHistogram(data::stream::BufferOutputStream& stream,
+                                        const char* name,
+                                        const std::string& labels,
+                                        const ConnectionStatistics::Histogram& histogram) const
+{
+
+  v_int64 cumulative = 0;
+  for(v_int32 i = 0; i < ConnectionStatistics::HISTOGRAM_BUCKETS - 1; i ++) {
+    cumulative += histogram.buckets[i];
+    stream << m_prefix << "_" << name << "_bucket{" << labels.c_str() << ",le=\"";
+    writeSeconds(stream, ConnectionStatistics::getBucketUpperBound(i));
+    stream << "\"} " << cumulative << "\n";
+  }
+
+  stream << m_prefix << "_" << name << "_bucket{" << labels.c_str() << ",le=\"+Inf\"} " << histogram.count << "\n";
+
+  stream << m_prefix << "_" << name << "_sum{" << labels.c_str() << "} ";
+  writeSeconds(stream, histogram.sum);
+  stream << "\n";
+
+  stream << m_prefix << "_" << name << "_count{" << labels.c_str() << "} " << histogram.count << "\n";
+
+}
+
+void PrometheusExporter::addStatistics(const oatpp::String& provider, const std::shared_ptr<ConnectionStatistics>& statistics) {
+  if(!provider || !statistics) {
+    throw std::runtime_error("[oatpp::libressl::PrometheusExporter::addStatistics()]: Error. Provider name and statistics must not be null.");
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sources.push_back({provider, statistics});
+}
+
+oatpp::String PrometheusExporter::render() const {
+
+  std::vector<Sample> samples;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    samples.reserve(m_sources.size());
+    for(auto& source : m_sources) {
+      Sample sample;
+      sample.labels = "provider=\"" + escapeLabelValue(source.name) + "\"";
+      sample.snapshot = source.statistics->getSnapshot();
+      samples.push_back(sample);
+    }
+  }
+
+  data::stream::BufferOutputStream stream(16 * 1024);
+
+  writeHeader(stream, "connections_opened_total", "counter", "TLS connections created.");
+  for(auto& sample : samples) {
+    writeSample(stream, "connections_opened_total", sample.labels, sample.snapshot.connectionsOpened);
+  }
+
+  writeHeader(stream, "connections_closed_total", "counter", "TLS connections destroyed.");
+  for(auto& sample : samples) {
+    writeSample(stream, "connections_closed_total", sample.labels, sample.snapshot.connectionsClosed);
+  }
+
+  writeHeader(stream, "connections_live", "gauge", "TLS connections currently alive.");
+  for(auto& sample : samples) {
+    writeSample(stream, "connections_live", sample.labels, sample.snapshot.connectionsOpened - sample.snapshot.connectionsClosed);
+  }
+
+  writeHeader(stream, "handshakes_total", "counter", "Completed TLS handshakes by type.");
+  for(auto& sample : samples) {
+    writeSample(stream, "handshakes_total", sample.labels + ",type=\"full\"", sample.snapshot.handshakes);
+    writeSample(stream, "handshakes_total", sample.labels + ",type=\"resumed\"", sample.snapshot.resumedHandshakes);
+  }
+
+  writeHeader(stream, "handshake_failures_total", "counter", "Failed TLS handshakes by reason.");
+  for(auto& sample : samples) {
+    for(v_int32 reason = 0; reason < ConnectionStatistics::HANDSHAKE_FAILURE_REASONS; reason ++) {
+      writeSample(stream, "handshake_failures_total",
+                  sample.labels + ",reason=\"" + FAILURE_REASONS[reason] + "\"",
+                  sample.snapshot.handshakeFailuresByReason[reason]);
+    }
+  }
+
+  writeHeader(stream, "bytes_encrypted_total", "counter", "Plaintext bytes encrypted by tls_write.");
+  for(auto& sample : samples) {
+    writeSample(stream, "bytes_encrypted_total", sample.labels, sample.snapshot.plaintextBytesWritten);
+  }
+
+  writeHeader(stream, "bytes_decrypted_total", "counter", "Plaintext bytes decrypted by tls_read.");
+  for(auto& sample : samples) {
+    writeSample(stream, "bytes_decrypted_total", sample.labels, sample.snapshot.plaintextBytesRead);
+  }
+
+  writeHeader(stream, "ciphertext_bytes_total", "counter", "Ciphertext bytes of destroyed connections by direction, including handshake.");
+  for(auto& sample : samples) {
+    writeSample(stream, "ciphertext_bytes_total", sample.labels + ",direction=\"read\"", sample.snapshot.ciphertextBytesRead);
+    writeSample(stream, "ciphertext_bytes_total", sample.labels + ",direction=\"write\"", sample.snapshot.ciphertextBytesWritten);
+  }
+
+  writeHeader(stream, "handshake_duration_seconds", "histogram", "Duration of completed TLS handshakes by type.");
+  for(auto& sample : samples) {
+    writeHistogram(stream, "handshake_duration_seconds", sample.labels + ",type=\"full\"", sample.snapshot.handshakeLatency);
+    writeHistogram(stream, "handshake_duration_seconds", sample.labels + ",type=\"resumed\"", sample.snapshot.resumedHandshakeLatency);
+  }
+
+  writeHeader(stream, "io_duration_seconds", "histogram", "Time spent inside tls_read and tls_write calls, including encryption and decryption.");
+  for(auto& sample : samples) {
+    writeHistogram(stream, "io_duration_seconds", sample.labels + ",operation=\"read\"", sample.snapshot.tlsReadLatency);
+    writeHistogram(stream, "io_duration_seconds", sample.labels + ",operation=\"write\"", sample.snapshot.tlsWriteLatency);
+  }
+
+  return stream.toString();
+
+}
+
+}}
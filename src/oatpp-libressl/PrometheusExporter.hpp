@@ -0,0 +1,116 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_PrometheusExporter_hpp
+#define oatpp_libressl_PrometheusExporter_hpp
+
+#include "oatpp-libressl/ConnectionStatistics.hpp"
+
+#include "oatpp/core/data/stream/BufferStream.hpp"
+#include "oatpp/core/Types.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Renders &id:oatpp::libressl::ConnectionStatistics; in the Prometheus text exposition format. <br>
+ * Statistics of each provider are exported with the `provider` label. Counters are totals - rates, such as
+ * handshakes per second, are computed by Prometheus with `rate()`. Latencies are exported as histograms in seconds. <br>
+ * To serve metrics from a controller:
+ * ```cpp
+ * ENDPOINT("GET", "/metrics", metrics) {
+ *   auto response = createResponse(Status::CODE_200, m_exporter->render());
+ *   response->putHeader(Header::CONTENT_TYPE, oatpp::libressl::PrometheusExporter::CONTENT_TYPE);
+ *   return response;
+ * }
+ * ```
+ */
+class PrometheusExporter {
+public:
+
+  /**
+   * Content type of the rendered text.
+   */
+  static const char* const CONTENT_TYPE;
+
+private:
+
+  struct Source {
+    oatpp::String name;
+    std::shared_ptr<ConnectionStatistics> statistics;
+  };
+
+private:
+  static std::string escapeLabelValue(const oatpp::String& value);
+  static void writeSeconds(data::stream::BufferOutputStream& stream, v_int64 micro);
+  void writeHeader(data::stream::BufferOutputStream& stream, const char* name, const char* type, const char* help) const;
+  void writeSample(data::stream::BufferOutputStream& stream, const char* name, const std::string& labels, v_int64 value) const;
+  void writeHistogram(data::stream::BufferOutputStream& stream,
+                      const char* name,
+                      const std::string& labels,
+                      const ConnectionStatistics::Histogram& histogram) const;
+private:
+  oatpp::String m_prefix;
+  std::vector<Source> m_sources;
+  mutable std::mutex m_mutex;
+public:
+
+  /**
+   * Constructor.
+   * @param prefix - prefix of the metric names.
+   */
+  PrometheusExporter(const oatpp::String& prefix = "oatpp_libressl");
+
+  /**
+   * Create shared PrometheusExporter.
+   * @param prefix - prefix of the metric names.
+   * @return - `std::shared_ptr` to PrometheusExporter.
+   */
+  static std::shared_ptr<PrometheusExporter> createShared(const oatpp::String& prefix = "oatpp_libressl");
+
+  /**
+   * Add statistics to export. <br>
+   * Ex.: `exporter->addStatistics("https", serverConnectionProvider->getStatistics())`.
+   * @param provider - value of the `provider` label.
+   * @param statistics - &id:oatpp::libressl::ConnectionStatistics;.
+   * @throws - `std::runtime_error` if any of the arguments is `nullptr`.
+   */
+  void addStatistics(const oatpp::String& provider, const std::shared_ptr<ConnectionStatistics>& statistics);
+
+  /**
+   * Render current values of all statistics.
+   * @return - text in the Prometheus exposition format.
+   */
+  oatpp::String render() const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_PrometheusExporter_hpp
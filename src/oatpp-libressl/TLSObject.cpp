@@ -49,6 +49,14 @@ oatpp::String TLSObject::getServerName() {
   return m_serverName;
 }
 
+void TLSObject::setCertificateType(const oatpp::String& certificateType) {
+  m_certificateType = certificateType;
+}
+
+oatpp::String TLSObject::getCertificateType() {
+  return m_certificateType;
+}
+
 void TLSObject::annul() {
   m_closed = true;
   m_tlsHandle = nullptr;
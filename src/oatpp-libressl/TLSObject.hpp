@@ -55,6 +55,7 @@ private:
   TLSHandle m_tlsHandle;
   Type m_type;
   oatpp::String m_serverName;
+  oatpp::String m_certificateType;
   bool m_closed;
 public:
 
@@ -90,6 +91,19 @@ public:
    */
   oatpp::String getServerName();
 
+  /**
+   * Set key type of the certificate served with this object - applicable if `TLSObject::Type == SERVER`.
+   * See &id:oatpp::libressl::CertificateIndex::getCertificateType;.
+   * @param certificateType
+   */
+  void setCertificateType(const oatpp::String& certificateType);
+
+  /**
+   * Get key type of the certificate served with this object.
+   * @return - certificate type. `nullptr` if not known.
+   */
+  oatpp::String getCertificateType();
+
   /**
    * Forget about TLS handle. TLS handle won't be freed on the destruction of TLS Object.
    */
@@ -0,0 +1,150 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "TrustStore.hpp"
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+
+namespace oatpp { namespace libressl {
+
+TrustStore::TrustStore(X509_STORE* store, v_int64 certificatesCount)
+  : m_store(store)
+  , m_certificatesCount(certificatesCount)
+{}
+
+TrustStore::~TrustStore() {
+  X509_STORE_free(m_store);
+}
+
+std::shared_ptr<TrustStore> TrustStore::createFromPem(const oatpp::String& pem) {
+
+  if(!pem) {
+    throw std::runtime_error("[oatpp::libressl::TrustStore::createFromPem()]: Error. Empty CA bundle.");
+  }
+
+  BIO* bio = BIO_new_mem_buf(pem->data(), (int) pem->size());
+  if(bio == nullptr) {
+    throw std::runtime_error("[oatpp::libressl::TrustStore::createFromPem()]: Error. Failed to create BIO.");
+  }
+
+  STACK_OF(X509_INFO)* infos = PEM_X509_INFO_read_bio(bio, nullptr, nullptr, nullptr);
+  BIO_free(bio);
+
+  if(infos == nullptr) {
+    throw std::runtime_error("[oatpp::libressl::TrustStore::createFromPem()]: Error. Failed to parse CA bundle.");
+  }
+
+  X509_STORE* store = X509_STORE_new();
+  v_int64 count = 0;
+
+  for(int i = 0; i < sk_X509_INFO_num(infos); i ++) {
+    X509_INFO* info = sk_X509_INFO_value(infos, i);
+    if(info->x509 != nullptr && X509_STORE_add_cert(store, info->x509) == 1) {
+      count ++;
+    }
+  }
+
+  sk_X509_INFO_pop_free(infos, X509_INFO_free);
+  ERR_clear_error(); // duplicates in the bundle are not an error
+
+  if(count == 0) {
+    X509_STORE_free(store);
+    throw std::runtime_error("[oatpp::libressl::TrustStore::createFromPem()]: Error. No certificates in CA bundle.");
+  }
+
+  return std::make_shared<TrustStore>(store, count);
+
+}
+
+std::shared_ptr<TrustStore> TrustStore::createFromFile(const char* filename) {
+  auto pem = oatpp::String::loadFromFile(filename);
+  if(!pem) {
+    throw std::runtime_error("[oatpp::libressl::TrustStore::createFromFile()]: Error. Can't read CA bundle file.");
+  }
+  return createFromPem(pem);
+}
+
+v_int64 TrustStore::getCertificatesCount() const {
+  return m_certificatesCount;
+}
+
+bool TrustStore::verifyServerChain(const v_char8* chainPem, v_buff_size chainPemSize, oatpp::String* error) const {
+
+  if(chainPem == nullptr || chainPemSize <= 0) {
+    if(error) *error = "No peer certificate.";
+    return false;
+  }
+
+  BIO* bio = BIO_new_mem_buf(chainPem, (int) chainPemSize);
+  if(bio == nullptr) {
+    if(error) *error = "Failed to create BIO.";
+    return false;
+  }
+
+  X509* leaf = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+  STACK_OF(X509)* intermediates = sk_X509_new_null();
+
+  X509* cert;
+  while((cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) != nullptr) {
+    sk_X509_push(intermediates, cert);
+  }
+
+  BIO_free(bio);
+  ERR_clear_error(); // end of PEM data
+
+  bool result = false;
+
+  if(leaf == nullptr) {
+    if(error) *error = "Failed to parse peer certificate.";
+  } else {
+
+    X509_STORE_CTX* ctx = X509_STORE_CTX_new();
+
+    if(ctx != nullptr && X509_STORE_CTX_init(ctx, m_store, leaf, intermediates) == 1) {
+      X509_STORE_CTX_set_default(ctx, "ssl_server");
+      result = X509_verify_cert(ctx) == 1;
+      if(!result && error) {
+        *error = X509_verify_cert_error_string(X509_STORE_CTX_get_error(ctx));
+      }
+    } else if(error) {
+      *error = "Failed to init verification context.";
+    }
+
+    if(ctx != nullptr) {
+      X509_STORE_CTX_free(ctx);
+    }
+
+    X509_free(leaf);
+
+  }
+
+  sk_X509_pop_free(intermediates, X509_free);
+
+  return result;
+
+}
+
+}}
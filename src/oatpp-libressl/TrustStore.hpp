@@ -0,0 +1,94 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_TrustStore_hpp
+#define oatpp_libressl_TrustStore_hpp
+
+#include "oatpp/core/Types.hpp"
+
+#include <openssl/x509.h>
+
+#include <memory>
+
+namespace oatpp { namespace libressl {
+
+/**
+ * Immutable set of trusted CA certificates parsed once and shared between connections. <br>
+ * libtls parses the configured CA bundle for every new client context.
+ * With &id:oatpp::libressl::Config::setTrustStore; client connections verify the peer certificate chain
+ * against this pre-parsed store instead.
+ */
+class TrustStore {
+private:
+  X509_STORE* m_store;
+  v_int64 m_certificatesCount;
+public:
+
+  /**
+   * Constructor. Use &l:TrustStore::createFromPem (); or &l:TrustStore::createFromFile (); instead.
+   * @param store - `X509_STORE*`. TrustStore takes the ownership.
+   * @param certificatesCount - number of certificates in the store.
+   */
+  TrustStore(X509_STORE* store, v_int64 certificatesCount);
+
+  /**
+   * Non-virtual destructor.
+   */
+  ~TrustStore();
+
+  /**
+   * Create TrustStore from the PEM-encoded CA bundle.
+   * @param pem - CA bundle.
+   * @return - `std::shared_ptr` to TrustStore.
+   */
+  static std::shared_ptr<TrustStore> createFromPem(const oatpp::String& pem);
+
+  /**
+   * Create TrustStore from the PEM-encoded CA bundle file.
+   * @param filename - path to CA bundle file.
+   * @return - `std::shared_ptr` to TrustStore.
+   */
+  static std::shared_ptr<TrustStore> createFromFile(const char* filename);
+
+  /**
+   * Get number of certificates in the store.
+   * @return
+   */
+  v_int64 getCertificatesCount() const;
+
+  /**
+   * Verify PEM-encoded certificate chain as presented by the server - leaf certificate first.
+   * @param chainPem - chain as returned by `tls_peer_cert_chain_pem`.
+   * @param chainPemSize - size of the chain.
+   * @param error - optional output for the verification error.
+   * @return - `true` if the chain is trusted.
+   */
+  bool verifyServerChain(const v_char8* chainPem, v_buff_size chainPemSize, oatpp::String* error = nullptr) const;
+
+};
+
+}}
+
+#endif // oatpp_libressl_TrustStore_hpp
@@ -57,6 +57,7 @@ ConnectionProvider::ConnectionProvider(const std::shared_ptr<Config>& config,
   : m_connectionInvalidator(std::make_shared<ConnectionInvalidator>())
   , m_config(config)
   , m_streamProvider(streamProvider)
+  , m_statistics(ConnectionStatistics::createShared())
 {
 
   setProperty(PROPERTY_HOST, streamProvider->getProperty(PROPERTY_HOST).toString());
@@ -88,9 +89,48 @@ std::shared_ptr<ConnectionProvider> ConnectionProvider::createShared(const std::
   );
 }
 
+void ConnectionProvider::setSessionCache(const std::shared_ptr<SessionCache>& sessionCache) {
+
+  if(!sessionCache) {
+    m_sessionCache = nullptr;
+    m_sessionEntry = nullptr;
+    return;
+  }
+
+  auto entry = sessionCache->getEntry(getProperty(PROPERTY_HOST).toString(), getProperty(PROPERTY_PORT).toString());
+
+  /* session file is bound to the config - a config already bound to another upstream would resume the wrong session */
+  auto currentFd = m_config->getSessionFd();
+  if(currentFd != -1 && currentFd != entry->getFd() && !(m_sessionEntry && m_sessionEntry->getFd() == currentFd)) {
+    throw std::runtime_error("[oatpp::libressl::client::ConnectionProvider::setSessionCache()]: Error. "
+                             "Config is already bound to the session file of another upstream. Use a separate config per upstream.");
+  }
+
+  m_config->setSessionFd(entry->getFd(), entry->getMutex());
+
+  m_sessionCache = sessionCache;
+  m_sessionEntry = entry;
+
+}
+
+std::shared_ptr<SessionCache> ConnectionProvider::getSessionCache() const {
+  return m_sessionCache;
+}
+
+void ConnectionProvider::setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics) {
+  m_statistics = statistics;
+}
+
+std::shared_ptr<ConnectionStatistics> ConnectionProvider::getStatistics() const {
+  return m_statistics;
+}
   
 provider::ResourceHandle<data::stream::IOStream> ConnectionProvider::get() {
 
+  if(m_sessionCache) {
+    m_sessionCache->expireIfStale(m_sessionEntry);
+  }
+
   Connection::TLSHandle tlsHandle = tls_client();
   tls_configure(tlsHandle, m_config->getTLSConfig());
 
@@ -101,12 +141,23 @@ provider::ResourceHandle<data::stream::IOStream> ConnectionProvider::get() {
   }
 
   auto tlsObject = std::make_shared<TLSObject>(tlsHandle, TLSObject::Type::CLIENT, host);
-  auto connection = std::make_shared<Connection>(tlsObject, m_streamProvider->get());
+  auto connection = Connection::createShared(tlsObject, m_streamProvider->get());
+  connection->applyConfig(m_config);
+  connection->setStatistics(m_statistics);
 
   connection->setOutputStreamIOMode(oatpp::data::stream::IOMode::BLOCKING);
   connection->setInputStreamIOMode(oatpp::data::stream::IOMode::BLOCKING);
 
   connection->initContexts();
+
+  if(connection->getHandshakeState() != Connection::HandshakeState::COMPLETE) {
+    throw std::runtime_error("[oatpp::libressl::client::ConnectionProvider::get()]: Error. TLS handshake failed.");
+  }
+
+  if(m_sessionCache) {
+    m_sessionCache->onHandshake(tls_conn_session_resumed(connection->getTlsHandle()) == 1);
+  }
+
   return provider::ResourceHandle<data::stream::IOStream>(connection, m_connectionInvalidator);
 
 }
@@ -119,6 +170,9 @@ oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::str
     std::shared_ptr<ConnectionInvalidator> m_connectionInvalidator;
     std::shared_ptr<Config> m_config;
     std::shared_ptr<network::ClientConnectionProvider> m_streamProvider;
+    std::shared_ptr<SessionCache> m_sessionCache;
+    std::shared_ptr<SessionCache::Entry> m_sessionEntry;
+    std::shared_ptr<ConnectionStatistics> m_statistics;
   private:
     provider::ResourceHandle<data::stream::IOStream> m_stream;
     std::shared_ptr<Connection> m_connection;
@@ -126,10 +180,16 @@ oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::str
 
     ConnectCoroutine(const std::shared_ptr<ConnectionInvalidator>& connectionInvalidator,
                      const std::shared_ptr<Config>& config,
-                     const std::shared_ptr<network::ClientConnectionProvider>& streamProvider)
+                     const std::shared_ptr<network::ClientConnectionProvider>& streamProvider,
+                     const std::shared_ptr<SessionCache>& sessionCache,
+                     const std::shared_ptr<SessionCache::Entry>& sessionEntry,
+                     const std::shared_ptr<ConnectionStatistics>& statistics)
       : m_connectionInvalidator(connectionInvalidator)
       , m_config(config)
       , m_streamProvider(streamProvider)
+      , m_sessionCache(sessionCache)
+      , m_sessionEntry(sessionEntry)
+      , m_statistics(statistics)
     {}
 
     Action act() override {
@@ -145,6 +205,10 @@ oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::str
 
     Action secureConnection() {
 
+      if(m_sessionCache) {
+        m_sessionCache->expireIfStale(m_sessionEntry);
+      }
+
       Connection::TLSHandle tlsHandle = tls_client();
       tls_configure(tlsHandle, m_config->getTLSConfig());
 
@@ -155,7 +219,9 @@ oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::str
       }
 
       auto tlsObject = std::make_shared<TLSObject>(tlsHandle, TLSObject::Type::CLIENT, host);
-      m_connection = std::make_shared<Connection>(tlsObject, m_stream);
+      m_connection = Connection::createShared(tlsObject, m_stream);
+      m_connection->applyConfig(m_config);
+      m_connection->setStatistics(m_statistics);
 
       m_connection->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
       m_connection->setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
@@ -165,13 +231,16 @@ oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::str
     }
 
     Action onSuccess() {
+      if(m_sessionCache) {
+        m_sessionCache->onHandshake(tls_conn_session_resumed(m_connection->getTlsHandle()) == 1);
+      }
       return _return(provider::ResourceHandle<data::stream::IOStream>(m_connection, m_connectionInvalidator));
     }
 
 
   };
 
-  return ConnectCoroutine::startForResult(m_connectionInvalidator, m_config, m_streamProvider);
+  return ConnectCoroutine::startForResult(m_connectionInvalidator, m_config, m_streamProvider, m_sessionCache, m_sessionEntry, m_statistics);
 
 }
   
@@ -25,7 +25,10 @@
 #ifndef oatpp_libressl_client_ConnectionProvider_hpp
 #define oatpp_libressl_client_ConnectionProvider_hpp
 
+#include "SessionCache.hpp"
+
 #include "oatpp-libressl/Config.hpp"
+#include "oatpp-libressl/ConnectionStatistics.hpp"
 #include "oatpp-libressl/TLSObject.hpp"
 
 #include "oatpp/network/Address.hpp"
@@ -51,6 +54,9 @@ private:
   std::shared_ptr<oatpp::network::ClientConnectionProvider> m_streamProvider;
   bool m_closed;
   std::shared_ptr<TLSObject> m_tlsObject;
+  std::shared_ptr<SessionCache> m_sessionCache;
+  std::shared_ptr<SessionCache::Entry> m_sessionEntry;
+  std::shared_ptr<ConnectionStatistics> m_statistics;
 public:
   /**
    * Constructor.
@@ -87,6 +93,36 @@ public:
     // DO NOTHING
   }
 
+  /**
+   * Enable session resumption with the session cache. <br>
+   * Binds the cache entry of this provider's `host:port` to the provider's config. <br>
+   * libtls keeps the session file in the config, so the config is what actually selects the session -
+   * *config must not be shared with providers of other upstreams.* Providers of the same upstream may share it along with the cache. <br>
+   * Must be called before any connection is obtained.
+   * @param sessionCache - &id:oatpp::libressl::client::SessionCache;.
+   * @throws - `std::runtime_error` if the config is already bound to the session file of another upstream.
+   */
+  void setSessionCache(const std::shared_ptr<SessionCache>& sessionCache);
+
+  /**
+   * Get session cache.
+   * @return - &id:oatpp::libressl::client::SessionCache;. `nullptr` if not set.
+   */
+  std::shared_ptr<SessionCache> getSessionCache() const;
+
+  /**
+   * Set statistics to aggregate metrics of the connections to. Providers may share the same statistics. <br>
+   * Each provider collects its own statistics by default.
+   * @param statistics - &id:oatpp::libressl::ConnectionStatistics;. `nullptr` - don't collect.
+   */
+  void setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics);
+
+  /**
+   * Get statistics of the connections.
+   * @return - &id:oatpp::libressl::ConnectionStatistics;. `nullptr` if not collected.
+   */
+  std::shared_ptr<ConnectionStatistics> getStatistics() const;
+
   /**
    * Get connection.
    * @return - `std::shared_ptr` to &id:oatpp::data::stream::IOStream;.
@@ -0,0 +1,424 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "PoolingConnectionProvider.hpp"
+
+#include "oatpp/core/base/Environment.hpp"
+
+namespace oatpp { namespace libressl { namespace client {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider::Options
+
+PoolingConnectionProvider::Options::Options(v_int64 pMaxIdleConnections,
+                                            v_int64 pMaxIdleTime,
+                                            v_int64 pMaxLifetime,
+                                            v_int64 pMinIdleConnections,
+                                            v_int64 pPrewarmInterval)
+  : maxIdleConnections(pMaxIdleConnections)
+  , minIdleConnections(pMinIdleConnections)
+  , maxIdleTime(pMaxIdleTime)
+  , maxLifetime(pMaxLifetime)
+  , prewarmInterval(pPrewarmInterval)
+{}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider::Pool
+
+PoolingConnectionProvider::Pool::Pool(const Options& options)
+  : m_options(options)
+  , m_closed(false)
+  , hits(0)
+  , misses(0)
+  , evictions(0)
+  , prewarmed(0)
+  , prewarmFailures(0)
+{}
+
+const PoolingConnectionProvider::Options& PoolingConnectionProvider::Pool::getOptions() const {
+  return m_options;
+}
+
+bool PoolingConnectionProvider::Pool::isExpired(const Entry& entry, v_int64 tick) const {
+  if(tick - entry.releasedTick > m_options.maxIdleTime) {
+    return true;
+  }
+  return m_options.maxLifetime > 0 && tick - entry.createdTick > m_options.maxLifetime;
+}
+
+void PoolingConnectionProvider::Pool::evict(const Entry& entry) {
+  evictions ++;
+  entry.handle.invalidator->invalidate(entry.handle.object);
+}
+
+bool PoolingConnectionProvider::Pool::acquire(Entry& result) {
+
+  while(true) {
+
+    Entry entry;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(m_idle.empty()) {
+        return false;
+      }
+      /* LIFO - take the most recently used connection */
+      entry = m_idle.back();
+      m_idle.pop_back();
+    }
+
+    auto connection = std::static_pointer_cast<Connection>(entry.handle.object);
+
+    if(isExpired(entry, oatpp::base::Environment::getMicroTickCount()) || !connection->isAlive()) {
+      evict(entry);
+      continue;
+    }
+
+    hits ++;
+    result = entry;
+    return true;
+
+  }
+
+}
+
+void PoolingConnectionProvider::Pool::release(const Entry& entry) {
+
+  Entry released = entry;
+  released.releasedTick = oatpp::base::Environment::getMicroTickCount();
+
+  std::vector<Entry> evicted;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_closed || isExpired(released, released.releasedTick)) {
+      evicted.push_back(released);
+    } else {
+      m_idle.push_back(released);
+      /* least recently used connections go first */
+      while((v_int64) m_idle.size() > m_options.maxIdleConnections) {
+        evicted.push_back(m_idle.front());
+        m_idle.erase(m_idle.begin());
+      }
+    }
+  }
+
+  for(auto& e : evicted) {
+    evict(e);
+  }
+
+}
+
+void PoolingConnectionProvider::Pool::evictExpired() {
+
+  std::vector<Entry> evicted;
+  auto tick = oatpp::base::Environment::getMicroTickCount();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_idle.begin();
+    while(it != m_idle.end()) {
+      if(isExpired(*it, tick)) {
+        evicted.push_back(*it);
+        it = m_idle.erase(it);
+      } else {
+        it ++;
+      }
+    }
+  }
+
+  for(auto& e : evicted) {
+    evict(e);
+  }
+
+}
+
+void PoolingConnectionProvider::Pool::close() {
+
+  std::vector<Entry> idle;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    idle.swap(m_idle);
+  }
+
+  for(auto& e : idle) {
+    e.handle.invalidator->invalidate(e.handle.object);
+  }
+
+}
+
+bool PoolingConnectionProvider::Pool::isClosed() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_closed;
+}
+
+v_int64 PoolingConnectionProvider::Pool::getIdleCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return (v_int64) m_idle.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider::PooledConnection
+
+PoolingConnectionProvider::PooledConnection::PooledConnection(const Entry& entry, const std::shared_ptr<Pool>& pool)
+  : m_entry(entry)
+  , m_pool(pool)
+  , m_valid(true)
+{}
+
+PoolingConnectionProvider::PooledConnection::~PooledConnection() {
+  if(m_valid) {
+    auto pool = m_pool.lock();
+    if(pool) {
+      pool->release(m_entry);
+    } else {
+      m_entry.handle.invalidator->invalidate(m_entry.handle.object);
+    }
+  }
+}
+
+std::shared_ptr<Connection> PoolingConnectionProvider::PooledConnection::getConnection() const {
+  return std::static_pointer_cast<Connection>(m_entry.handle.object);
+}
+
+void PoolingConnectionProvider::PooledConnection::invalidate() {
+  bool expected = true;
+  if(m_valid.compare_exchange_strong(expected, false)) {
+    m_entry.handle.invalidator->invalidate(m_entry.handle.object);
+  }
+}
+
+v_io_size PoolingConnectionProvider::PooledConnection::write(const void *buff, v_buff_size count, async::Action& action) {
+  return m_entry.handle.object->write(buff, count, action);
+}
+
+v_io_size PoolingConnectionProvider::PooledConnection::read(void *buff, v_buff_size count, async::Action& action) {
+  return m_entry.handle.object->read(buff, count, action);
+}
+
+void PoolingConnectionProvider::PooledConnection::setOutputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
+  m_entry.handle.object->setOutputStreamIOMode(ioMode);
+}
+
+oatpp::data::stream::IOMode PoolingConnectionProvider::PooledConnection::getOutputStreamIOMode() {
+  return m_entry.handle.object->getOutputStreamIOMode();
+}
+
+oatpp::data::stream::Context& PoolingConnectionProvider::PooledConnection::getOutputStreamContext() {
+  return m_entry.handle.object->getOutputStreamContext();
+}
+
+void PoolingConnectionProvider::PooledConnection::setInputStreamIOMode(oatpp::data::stream::IOMode ioMode) {
+  m_entry.handle.object->setInputStreamIOMode(ioMode);
+}
+
+oatpp::data::stream::IOMode PoolingConnectionProvider::PooledConnection::getInputStreamIOMode() {
+  return m_entry.handle.object->getInputStreamIOMode();
+}
+
+oatpp::data::stream::Context& PoolingConnectionProvider::PooledConnection::getInputStreamContext() {
+  return m_entry.handle.object->getInputStreamContext();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider::PooledConnectionInvalidator
+
+void PoolingConnectionProvider::PooledConnectionInvalidator::invalidate(const std::shared_ptr<data::stream::IOStream>& connection) {
+  auto c = std::static_pointer_cast<PooledConnection>(connection);
+  c->invalidate();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider::PrewarmCoroutine
+
+class PoolingConnectionProvider::PrewarmCoroutine : public async::Coroutine<PrewarmCoroutine> {
+private:
+  std::shared_ptr<ConnectionProvider> m_connectionProvider;
+  std::shared_ptr<Pool> m_pool;
+public:
+
+  PrewarmCoroutine(const std::shared_ptr<ConnectionProvider>& connectionProvider, const std::shared_ptr<Pool>& pool)
+    : m_connectionProvider(connectionProvider)
+    , m_pool(pool)
+  {}
+
+  Action act() override {
+
+    if(m_pool->isClosed()) {
+      return finish();
+    }
+
+    m_pool->evictExpired();
+
+    if(m_pool->getIdleCount() < m_pool->getOptions().minIdleConnections) {
+      return m_connectionProvider->getAsync().callbackTo(&PrewarmCoroutine::onConnected);
+    }
+
+    return waitRepeat(std::chrono::microseconds(m_pool->getOptions().prewarmInterval));
+
+  }
+
+  Action onConnected(const provider::ResourceHandle<data::stream::IOStream>& connection) {
+
+    if(connection) {
+      Entry entry;
+      entry.handle = connection;
+      entry.createdTick = oatpp::base::Environment::getMicroTickCount();
+      entry.releasedTick = entry.createdTick;
+      m_pool->prewarmed ++;
+      m_pool->release(entry);
+    }
+
+    return yieldTo(&PrewarmCoroutine::act);
+
+  }
+
+  Action handleError(Error* error) override {
+    (void) error;
+    /* upstream is not reachable now - try again later */
+    m_pool->prewarmFailures ++;
+    return waitRepeat(std::chrono::microseconds(m_pool->getOptions().prewarmInterval));
+  }
+
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PoolingConnectionProvider
+
+PoolingConnectionProvider::PoolingConnectionProvider(const std::shared_ptr<ConnectionProvider>& connectionProvider, const Options& options)
+  : m_connectionProvider(connectionProvider)
+  , m_pool(std::make_shared<Pool>(options))
+  , m_invalidator(std::make_shared<PooledConnectionInvalidator>())
+  , m_prewarming(false)
+{
+  setProperty(PROPERTY_HOST, connectionProvider->getProperty(PROPERTY_HOST).toString());
+  setProperty(PROPERTY_PORT, connectionProvider->getProperty(PROPERTY_PORT).toString());
+}
+
+std::shared_ptr<PoolingConnectionProvider> PoolingConnectionProvider::createShared(const std::shared_ptr<ConnectionProvider>& connectionProvider,
+                                                                                   const Options& options)
+{
+  return std::make_shared<PoolingConnectionProvider>(connectionProvider, options);
+}
+
+PoolingConnectionProvider::~PoolingConnectionProvider() {
+  m_pool->close();
+}
+
+provider::ResourceHandle<data::stream::IOStream> PoolingConnectionProvider::wrap(const Entry& entry,
+                                                                                 const std::shared_ptr<Pool>& pool,
+                                                                                 const std::shared_ptr<PooledConnectionInvalidator>& invalidator,
+                                                                                 oatpp::data::stream::IOMode ioMode)
+{
+  auto connection = std::make_shared<PooledConnection>(entry, pool);
+  connection->setOutputStreamIOMode(ioMode);
+  connection->setInputStreamIOMode(ioMode);
+  return provider::ResourceHandle<data::stream::IOStream>(connection, invalidator);
+}
+
+void PoolingConnectionProvider::stop() {
+  m_pool->close();
+  m_connectionProvider->stop();
+}
+
+provider::ResourceHandle<data::stream::IOStream> PoolingConnectionProvider::get() {
+
+  Entry entry;
+
+  if(!m_pool->acquire(entry)) {
+    m_pool->misses ++;
+    entry.handle = m_connectionProvider->get();
+    entry.createdTick = oatpp::base::Environment::getMicroTickCount();
+    entry.releasedTick = entry.createdTick;
+  }
+
+  return wrap(entry, m_pool, m_invalidator, oatpp::data::stream::IOMode::BLOCKING);
+
+}
+
+oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> PoolingConnectionProvider::getAsync() {
+
+  class GetCoroutine : public async::CoroutineWithResult<GetCoroutine, const provider::ResourceHandle<data::stream::IOStream>&> {
+  private:
+    std::shared_ptr<ConnectionProvider> m_connectionProvider;
+    std::shared_ptr<Pool> m_pool;
+    std::shared_ptr<PooledConnectionInvalidator> m_invalidator;
+  public:
+
+    GetCoroutine(const std::shared_ptr<ConnectionProvider>& connectionProvider,
+                 const std::shared_ptr<Pool>& pool,
+                 const std::shared_ptr<PooledConnectionInvalidator>& invalidator)
+      : m_connectionProvider(connectionProvider)
+      , m_pool(pool)
+      , m_invalidator(invalidator)
+    {}
+
+    Action act() override {
+
+      Entry entry;
+      if(m_pool->acquire(entry)) {
+        return _return(wrap(entry, m_pool, m_invalidator, oatpp::data::stream::IOMode::ASYNCHRONOUS));
+      }
+
+      m_pool->misses ++;
+      return m_connectionProvider->getAsync().callbackTo(&GetCoroutine::onConnected);
+
+    }
+
+    Action onConnected(const provider::ResourceHandle<data::stream::IOStream>& connection) {
+      Entry entry;
+      entry.handle = connection;
+      entry.createdTick = oatpp::base::Environment::getMicroTickCount();
+      entry.releasedTick = entry.createdTick;
+      return _return(wrap(entry, m_pool, m_invalidator, oatpp::data::stream::IOMode::ASYNCHRONOUS));
+    }
+
+  };
+
+  return GetCoroutine::startForResult(m_connectionProvider, m_pool, m_invalidator);
+
+}
+
+void PoolingConnectionProvider::startPrewarming(const std::shared_ptr<async::Executor>& executor) {
+  bool expected = false;
+  if(m_prewarming.compare_exchange_strong(expected, true)) {
+    executor->execute<PrewarmCoroutine>(m_connectionProvider, m_pool);
+  }
+}
+
+PoolingConnectionProvider::Metrics PoolingConnectionProvider::getMetrics() {
+  Metrics metrics;
+  metrics.hits = m_pool->hits;
+  metrics.misses = m_pool->misses;
+  metrics.evictions = m_pool->evictions;
+  metrics.prewarmed = m_pool->prewarmed;
+  metrics.prewarmFailures = m_pool->prewarmFailures;
+  metrics.idle = m_pool->getIdleCount();
+  return metrics;
+}
+
+}}}
@@ -0,0 +1,291 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_client_PoolingConnectionProvider_hpp
+#define oatpp_libressl_client_PoolingConnectionProvider_hpp
+
+#include "ConnectionProvider.hpp"
+
+#include "oatpp-libressl/Connection.hpp"
+
+#include "oatpp/core/async/Executor.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace oatpp { namespace libressl { namespace client {
+
+/**
+ * Keep-alive pool of established TLS connections to the upstream of the wrapped &id:oatpp::libressl::client::ConnectionProvider;. <br>
+ * Connections are returned to the pool when the last reference to the returned stream is released, unless the stream was invalidated.
+ * The pool is LIFO - the most recently used connection is handed out first, so the rest can expire. <br>
+ * Before a pooled connection is handed out it is checked with &id:oatpp::libressl::Connection::isAlive; -
+ * a non-blocking probe which detects close_notify from the peer and closed transport. <br>
+ * Since the wrapped provider targets a single upstream, the pool is a per-host pool. <br>
+ * With &l:PoolingConnectionProvider::startPrewarming (); the pool is topped up in the background, so that traffic spikes
+ * don't pay TCP + TLS setup on the request path.
+ * Extends &id:oatpp::network::ClientConnectionProvider;.
+ */
+class PoolingConnectionProvider : public oatpp::network::ClientConnectionProvider {
+public:
+
+  /**
+   * Pool options.
+   */
+  struct Options {
+
+    /**
+     * Max number of idle connections kept in the pool.
+     */
+    v_int64 maxIdleConnections;
+
+    /**
+     * Number of idle connections kept established by &l:PoolingConnectionProvider::startPrewarming ();.
+     */
+    v_int64 minIdleConnections;
+
+    /**
+     * Max time in microseconds connection may stay idle in the pool.
+     */
+    v_int64 maxIdleTime;
+
+    /**
+     * Max connection age in microseconds. Older connections are not reused - also limits reuse of connections
+     * whose TLS session is about to expire. `0` - no limit.
+     */
+    v_int64 maxLifetime;
+
+    /**
+     * Interval in microseconds between the checks of the prewarming coroutine.
+     */
+    v_int64 prewarmInterval;
+
+    /**
+     * Constructor.
+     * @param pMaxIdleConnections - max number of idle connections kept in the pool.
+     * @param pMaxIdleTime - max idle time in microseconds.
+     * @param pMaxLifetime - max connection age in microseconds. `0` - no limit.
+     * @param pMinIdleConnections - number of idle connections kept established by prewarming.
+     * @param pPrewarmInterval - interval in microseconds between the checks of the prewarming coroutine.
+     */
+    Options(v_int64 pMaxIdleConnections = 16,
+            v_int64 pMaxIdleTime = 60 * 1000 * 1000,
+            v_int64 pMaxLifetime = 0,
+            v_int64 pMinIdleConnections = 0,
+            v_int64 pPrewarmInterval = 100 * 1000);
+
+  };
+
+  /**
+   * Pool counters.
+   */
+  struct Metrics {
+
+    /**
+     * Warm hits - number of connections taken from the pool.
+     */
+    v_int64 hits;
+
+    /**
+     * Cold connects - number of connections established on the request path because the pool had no reusable connection.
+     */
+    v_int64 misses;
+
+    /**
+     * Number of connections dropped from the pool - expired, dead, or over the pool size.
+     */
+    v_int64 evictions;
+
+    /**
+     * Number of connections established in background by prewarming.
+     */
+    v_int64 prewarmed;
+
+    /**
+     * Number of failed background connects.
+     */
+    v_int64 prewarmFailures;
+
+    /**
+     * Number of idle connections in the pool at the moment.
+     */
+    v_int64 idle;
+
+  };
+
+private:
+
+  struct Entry {
+    provider::ResourceHandle<data::stream::IOStream> handle;
+    v_int64 createdTick;
+    v_int64 releasedTick;
+  };
+
+  class Pool {
+  private:
+    Options m_options;
+    std::mutex m_mutex;
+    std::vector<Entry> m_idle;
+    bool m_closed;
+  public:
+    std::atomic<v_int64> hits;
+    std::atomic<v_int64> misses;
+    std::atomic<v_int64> evictions;
+    std::atomic<v_int64> prewarmed;
+    std::atomic<v_int64> prewarmFailures;
+  private:
+    bool isExpired(const Entry& entry, v_int64 tick) const;
+    void evict(const Entry& entry);
+  public:
+    Pool(const Options& options);
+    const Options& getOptions() const;
+    bool acquire(Entry& entry);
+    void release(const Entry& entry);
+    void evictExpired();
+    void close();
+    bool isClosed();
+    v_int64 getIdleCount();
+  };
+
+  class PrewarmCoroutine; // FWD
+
+public:
+
+  /**
+   * Proxy of the pooled connection. Returns connection to the pool on destruction unless invalidated.
+   */
+  class PooledConnection : public data::stream::IOStream {
+  private:
+    Entry m_entry;
+    std::weak_ptr<Pool> m_pool;
+    std::atomic<bool> m_valid;
+  public:
+
+    PooledConnection(const Entry& entry, const std::shared_ptr<Pool>& pool);
+
+    ~PooledConnection();
+
+    /**
+     * Get underlying &id:oatpp::libressl::Connection;.
+     * @return
+     */
+    std::shared_ptr<Connection> getConnection() const;
+
+    /**
+     * Mark connection as not reusable and invalidate the underlying connection.
+     */
+    void invalidate();
+
+    v_io_size write(const void *buff, v_buff_size count, async::Action& action) override;
+    v_io_size read(void *buff, v_buff_size count, async::Action& action) override;
+
+    void setOutputStreamIOMode(oatpp::data::stream::IOMode ioMode) override;
+    oatpp::data::stream::IOMode getOutputStreamIOMode() override;
+    oatpp::data::stream::Context& getOutputStreamContext() override;
+
+    void setInputStreamIOMode(oatpp::data::stream::IOMode ioMode) override;
+    oatpp::data::stream::IOMode getInputStreamIOMode() override;
+    oatpp::data::stream::Context& getInputStreamContext() override;
+
+  };
+
+private:
+
+  class PooledConnectionInvalidator : public provider::Invalidator<data::stream::IOStream> {
+  public:
+    void invalidate(const std::shared_ptr<data::stream::IOStream>& connection) override;
+  };
+
+private:
+  std::shared_ptr<ConnectionProvider> m_connectionProvider;
+  std::shared_ptr<Pool> m_pool;
+  std::shared_ptr<PooledConnectionInvalidator> m_invalidator;
+  std::atomic<bool> m_prewarming;
+private:
+  static provider::ResourceHandle<data::stream::IOStream> wrap(const Entry& entry,
+                                                               const std::shared_ptr<Pool>& pool,
+                                                               const std::shared_ptr<PooledConnectionInvalidator>& invalidator,
+                                                               oatpp::data::stream::IOMode ioMode);
+public:
+
+  /**
+   * Constructor.
+   * @param connectionProvider - &id:oatpp::libressl::client::ConnectionProvider;.
+   * @param options - &l:PoolingConnectionProvider::Options;.
+   */
+  PoolingConnectionProvider(const std::shared_ptr<ConnectionProvider>& connectionProvider, const Options& options = Options());
+
+  /**
+   * Create shared PoolingConnectionProvider.
+   * @param connectionProvider - &id:oatpp::libressl::client::ConnectionProvider;.
+   * @param options - &l:PoolingConnectionProvider::Options;.
+   * @return - `std::shared_ptr` to PoolingConnectionProvider.
+   */
+  static std::shared_ptr<PoolingConnectionProvider> createShared(const std::shared_ptr<ConnectionProvider>& connectionProvider,
+                                                                 const Options& options = Options());
+
+  /**
+   * Virtual destructor.
+   */
+  ~PoolingConnectionProvider();
+
+  /**
+   * Close idle connections and stop the wrapped provider.
+   */
+  void stop() override;
+
+  /**
+   * Get pooled connection or establish new one. Returned connection is in &id:oatpp::data::stream::IOMode::BLOCKING; mode.
+   * @return - &id:oatpp::provider::ResourceHandle;.
+   */
+  provider::ResourceHandle<data::stream::IOStream> get() override;
+
+  /**
+   * Get pooled connection or establish new one in asynchronous manner.
+   * Returned connection is in &id:oatpp::data::stream::IOMode::ASYNCHRONOUS; mode.
+   * @return - &id:oatpp::async::CoroutineStarterForResult;.
+   */
+  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<oatpp::data::stream::IOStream>&> getAsync() override;
+
+  /**
+   * Start background coroutine which keeps &l:PoolingConnectionProvider::Options::minIdleConnections; established
+   * idle connections in the pool and evicts expired ones. Connections are established with `getAsync()` of the wrapped provider.
+   * The coroutine runs until the provider is stopped.
+   * @param executor - &id:oatpp::async::Executor; to run the coroutine on.
+   */
+  void startPrewarming(const std::shared_ptr<async::Executor>& executor);
+
+  /**
+   * Get pool counters.
+   * @return - &l:PoolingConnectionProvider::Metrics;.
+   */
+  Metrics getMetrics();
+
+};
+
+}}}
+
+#endif // oatpp_libressl_client_PoolingConnectionProvider_hpp
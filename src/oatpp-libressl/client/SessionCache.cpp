@@ -0,0 +1,166 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "SessionCache.hpp"
+
+#if !(defined(WIN32) || defined(_WIN32))
+  #include <stdlib.h>
+  #include <sys/stat.h>
+  #include <time.h>
+  #include <unistd.h>
+#endif
+
+namespace oatpp { namespace libressl { namespace client {
+
+SessionCache::Entry::Entry(int fd)
+  : m_fd(fd)
+  , m_mutex(std::make_shared<std::mutex>())
+{}
+
+SessionCache::Entry::~Entry() {
+#if !(defined(WIN32) || defined(_WIN32))
+  ::close(m_fd);
+#endif
+}
+
+int SessionCache::Entry::getFd() const {
+  return m_fd;
+}
+
+std::shared_ptr<std::mutex> SessionCache::Entry::getMutex() const {
+  return m_mutex;
+}
+
+SessionCache::SessionCache(v_int64 maxEntries, const std::chrono::seconds& ttl)
+  : m_maxEntries(maxEntries < 1 ? 1 : maxEntries)
+  , m_ttlSeconds(ttl.count())
+  , m_resumed(0)
+  , m_full(0)
+  , m_expired(0)
+{}
+
+std::shared_ptr<SessionCache> SessionCache::createShared(v_int64 maxEntries, const std::chrono::seconds& ttl) {
+  return std::make_shared<SessionCache>(maxEntries, ttl);
+}
+
+std::shared_ptr<SessionCache::Entry> SessionCache::getEntry(const oatpp::String& host, const oatpp::String& port) {
+
+  std::string key;
+  if(host) key.append(host->data(), host->size());
+  key.append(":");
+  if(port) key.append(port->data(), port->size());
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_index.find(key);
+  if(it != m_index.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->second;
+  }
+
+  std::shared_ptr<Entry> entry;
+
+#if !(defined(WIN32) || defined(_WIN32))
+
+  char path[] = "/tmp/oatpp-libressl-session-XXXXXX";
+  int fd = mkstemp(path); // mkstemp creates the file with 0600 permissions - as libtls requires
+  if(fd < 0) {
+    throw std::runtime_error("[oatpp::libressl::client::SessionCache::getEntry()]: Error. Can't create session file.");
+  }
+  unlink(path);
+
+  entry = std::make_shared<Entry>(fd);
+
+#else
+  throw std::runtime_error("[oatpp::libressl::client::SessionCache::getEntry()]: Error. Session files are not supported on this platform.");
+#endif
+
+  m_entries.push_front(std::make_pair(key, entry));
+  m_index[key] = m_entries.begin();
+
+  while((v_int64) m_entries.size() > m_maxEntries) {
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+
+  return entry;
+
+}
+
+void SessionCache::expireIfStale(const std::shared_ptr<Entry>& entry) {
+#if !(defined(WIN32) || defined(_WIN32))
+
+  std::lock_guard<std::mutex> lock(*entry->getMutex());
+
+  struct stat st;
+  if(fstat(entry->getFd(), &st) != 0 || st.st_size == 0) {
+    return;
+  }
+
+  if(time(nullptr) - st.st_mtime >= m_ttlSeconds) {
+    /* empty file means no session */
+    if(ftruncate(entry->getFd(), 0) == 0) {
+      m_expired ++;
+    }
+  }
+
+#endif
+}
+
+void SessionCache::onHandshake(bool resumed) {
+  if(resumed) {
+    m_resumed ++;
+  } else {
+    m_full ++;
+  }
+}
+
+v_int64 SessionCache::getResumedCount() const {
+  return m_resumed;
+}
+
+v_int64 SessionCache::getFullCount() const {
+  return m_full;
+}
+
+v_int64 SessionCache::getExpiredCount() const {
+  return m_expired;
+}
+
+v_float64 SessionCache::getHitRate() const {
+  v_int64 resumed = m_resumed;
+  v_int64 total = resumed + m_full;
+  if(total == 0) {
+    return 0;
+  }
+  return (v_float64) resumed / (v_float64) total;
+}
+
+v_int64 SessionCache::getSize() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return (v_int64) m_entries.size();
+}
+
+}}}
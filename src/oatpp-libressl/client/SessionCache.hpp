@@ -0,0 +1,174 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_client_SessionCache_hpp
+#define oatpp_libressl_client_SessionCache_hpp
+
+#include "oatpp/core/Types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace oatpp { namespace libressl { namespace client {
+
+/**
+ * Client TLS session cache keyed by `host:port`. <br>
+ * libtls keeps client sessions in files (`tls_config_set_session_fd`). The cache owns one unlinked temporary
+ * session file per upstream and binds it to the config of the &id:oatpp::libressl::client::ConnectionProvider;
+ * via &id:oatpp::libressl::client::ConnectionProvider::setSessionCache;.
+ * Reconnects to the same upstream resume the stored session automatically. <br>
+ * *Note: session file is bound to the `tls_config`, so the `host:port` key is only as good as the config separation -
+ * a config used with the session cache must not be shared between providers of different upstreams
+ * (&id:oatpp::libressl::client::ConnectionProvider::setSessionCache; throws if it is).* <br>
+ * Connections hold the entry mutex only while libtls loads the session (connect) and saves it (last handshake step),
+ * so concurrent handshakes to the same upstream are not serialized.
+ */
+class SessionCache {
+public:
+
+  /**
+   * Session file of one upstream.
+   */
+  class Entry {
+  private:
+    int m_fd;
+    std::shared_ptr<std::mutex> m_mutex;
+  public:
+
+    /**
+     * Constructor.
+     * @param fd - session file descriptor. Entry takes the ownership.
+     */
+    Entry(int fd);
+
+    /**
+     * Non-virtual destructor. Closes the file.
+     */
+    ~Entry();
+
+    /**
+     * Get session file descriptor.
+     * @return
+     */
+    int getFd() const;
+
+    /**
+     * Get mutex guarding the session file.
+     * @return
+     */
+    std::shared_ptr<std::mutex> getMutex() const;
+
+  };
+
+private:
+  typedef std::list<std::pair<std::string, std::shared_ptr<Entry>>> EntryList;
+private:
+  v_int64 m_maxEntries;
+  v_int64 m_ttlSeconds;
+  std::mutex m_mutex;
+  EntryList m_entries;
+  std::unordered_map<std::string, EntryList::iterator> m_index;
+private:
+  std::atomic<v_int64> m_resumed;
+  std::atomic<v_int64> m_full;
+  std::atomic<v_int64> m_expired;
+public:
+
+  /**
+   * Constructor.
+   * @param maxEntries - max number of upstreams to keep. Least recently used entries are evicted first.
+   * Evicted entry stays valid while it's used by some provider.
+   * @param ttl - max age of the stored session. Older sessions are dropped before connecting.
+   */
+  SessionCache(v_int64 maxEntries = 1024, const std::chrono::seconds& ttl = std::chrono::hours(2));
+
+  /**
+   * Create shared SessionCache.
+   * @param maxEntries - max number of upstreams to keep.
+   * @param ttl - max age of the stored session.
+   * @return - `std::shared_ptr` to SessionCache.
+   */
+  static std::shared_ptr<SessionCache> createShared(v_int64 maxEntries = 1024, const std::chrono::seconds& ttl = std::chrono::hours(2));
+
+  /**
+   * Get session file of the upstream. Creates new (empty) session file if there is no entry.
+   * @param host - upstream host.
+   * @param port - upstream port.
+   * @return - &l:SessionCache::Entry;.
+   */
+  std::shared_ptr<Entry> getEntry(const oatpp::String& host, const oatpp::String& port);
+
+  /**
+   * Drop the stored session if it's older than TTL. Called by the provider before connecting.
+   * @param entry - &l:SessionCache::Entry;.
+   */
+  void expireIfStale(const std::shared_ptr<Entry>& entry);
+
+  /**
+   * Count the handshake. Called by the provider after the handshake is complete.
+   * @param resumed - `true` if session was resumed.
+   */
+  void onHandshake(bool resumed);
+
+  /**
+   * Get number of resumed handshakes.
+   * @return
+   */
+  v_int64 getResumedCount() const;
+
+  /**
+   * Get number of full handshakes.
+   * @return
+   */
+  v_int64 getFullCount() const;
+
+  /**
+   * Get number of sessions dropped due to TTL.
+   * @return
+   */
+  v_int64 getExpiredCount() const;
+
+  /**
+   * Get resumption hit rate - resumed / (resumed + full).
+   * @return - value in range `[0, 1]`. `0` if there were no handshakes.
+   */
+  v_float64 getHitRate() const;
+
+  /**
+   * Get number of upstreams in the cache.
+   * @return
+   */
+  v_int64 getSize();
+
+};
+
+}}}
+
+#endif // oatpp_libressl_client_SessionCache_hpp
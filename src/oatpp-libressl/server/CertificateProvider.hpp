@@ -0,0 +1,64 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_server_CertificateProvider_hpp
+#define oatpp_libressl_server_CertificateProvider_hpp
+
+#include "oatpp-libressl/TLSObject.hpp"
+
+#include <memory>
+
+namespace oatpp { namespace libressl { namespace server {
+
+/**
+ * Provider of `tls_server` contexts by SNI server name. <br>
+ * Server connection reads the ClientHello (reassembled if it is split across records), asks the provider for the context
+ * of the requested server name and accepts TLS on that context. ClientHello without SNI is accepted on the default context,
+ * malformed or oversized ClientHello fails the handshake with &id:oatpp::libressl::Connection::HandshakeFailure::SERVER_NAME;.
+ * See &id:oatpp::libressl::server::ConnectionProvider::setCertificateProvider;.
+ */
+class CertificateProvider {
+public:
+
+  /**
+   * Default virtual destructor.
+   */
+  virtual ~CertificateProvider() = default;
+
+  /**
+   * Get `tls_server` context for the server name. <br>
+   * Called on the thread running the handshake, for each new connection which sent SNI.
+   * @param serverName - server name as sent by the client. Not normalized and not validated.
+   * @param size - size of the server name.
+   * @return - server &id:oatpp::libressl::TLSObject;. `nullptr` - use the default keypair of the config.
+   * @throws - `std::runtime_error` fails the handshake with &id:oatpp::libressl::Connection::HandshakeFailure::SERVER_NAME;.
+   */
+  virtual std::shared_ptr<TLSObject> getServerContext(const char* serverName, v_buff_size size) = 0;
+
+};
+
+}}}
+
+#endif /* oatpp_libressl_server_CertificateProvider_hpp */
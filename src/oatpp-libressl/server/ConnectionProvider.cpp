@@ -24,13 +24,58 @@
 
 #include "ConnectionProvider.hpp"
 
+#include "oatpp-libressl/server/TcpConnectionProvider.hpp"
 #include "oatpp-libressl/Connection.hpp"
 
-#include "oatpp/network/tcp/server/ConnectionProvider.hpp"
 #include "oatpp/core/utils/ConversionUtils.hpp"
 
+#include <sys/stat.h>
+
 namespace oatpp { namespace libressl { namespace server {
 
+namespace {
+
+/*
+ * Seconds of mtime are not enough - a file rewritten within the same second would be missed.
+ */
+struct FileVersion {
+
+  v_int64 mtimeSeconds;
+  v_int64 mtimeNanoseconds;
+  v_int64 size;
+  v_int64 inode;
+
+  bool operator==(const FileVersion& other) const {
+    return mtimeSeconds == other.mtimeSeconds && mtimeNanoseconds == other.mtimeNanoseconds &&
+           size == other.size && inode == other.inode;
+  }
+
+};
+
+FileVersion getFileVersion(const oatpp::String& file) {
+
+  FileVersion version = {-1, 0, -1, -1};
+
+  struct stat st;
+  if(stat(file->c_str(), &st) != 0) {
+    return version;
+  }
+
+  version.mtimeSeconds = (v_int64) st.st_mtime;
+#if defined(__APPLE__)
+  version.mtimeNanoseconds = (v_int64) st.st_mtimespec.tv_nsec;
+#elif !(defined(WIN32) || defined(_WIN32))
+  version.mtimeNanoseconds = (v_int64) st.st_mtim.tv_nsec;
+#endif
+  version.size = (v_int64) st.st_size;
+  version.inode = (v_int64) st.st_ino;
+
+  return version;
+
+}
+
+}
+
 void ConnectionProvider::ConnectionInvalidator::invalidate(const std::shared_ptr<data::stream::IOStream> &connection){
 
   auto c = std::static_pointer_cast<oatpp::libressl::Connection>(connection);
@@ -51,18 +96,30 @@ void ConnectionProvider::ConnectionInvalidator::invalidate(const std::shared_ptr
 
 }
 
+std::shared_ptr<ConnectionProvider::ServerContext> ConnectionProvider::ServerContextReference::load() const {
+  return std::atomic_load(&m_context);
+}
+
+void ConnectionProvider::ServerContextReference::store(const std::shared_ptr<ServerContext>& context) {
+  std::atomic_store(&m_context, context);
+}
+
 ConnectionProvider::ConnectionProvider(const std::shared_ptr<Config>& config,
                                        const std::shared_ptr<oatpp::network::ServerConnectionProvider>& streamProvider)
   : m_connectionInvalidator(std::make_shared<ConnectionInvalidator>())
-  , m_config(config)
   , m_streamProvider(streamProvider)
   , m_closed(false)
+  , m_context(std::make_shared<ServerContextReference>())
+  , m_statistics(ConnectionStatistics::createShared())
+  , m_reloadsCount(0)
+  , m_reloadFailuresCount(0)
+  , m_watchRunning(false)
 {
 
   setProperty(PROPERTY_HOST, streamProvider->getProperty(PROPERTY_HOST).toString());
   setProperty(PROPERTY_PORT, streamProvider->getProperty(PROPERTY_PORT).toString());
 
-  m_tlsObject = instantiateTLSServer();
+  m_context->store(createServerContext(config));
 
 }
 
@@ -78,7 +135,7 @@ std::shared_ptr<ConnectionProvider> ConnectionProvider::createShared(const std::
 {
   return createShared(
     config,
-    network::tcp::server::ConnectionProvider::createShared(address, useExtendedConnections)
+    TcpConnectionProvider::createShared(address, useExtendedConnections)
   );
 }
 
@@ -86,7 +143,7 @@ ConnectionProvider::~ConnectionProvider() {
   stop();
 }
 
-std::shared_ptr<TLSObject> ConnectionProvider::instantiateTLSServer() {
+std::shared_ptr<TLSObject> ConnectionProvider::instantiateTLSServer(const std::shared_ptr<Config>& config) {
 
   Connection::TLSHandle handle = tls_server();
 
@@ -94,20 +151,175 @@ std::shared_ptr<TLSObject> ConnectionProvider::instantiateTLSServer() {
     throw std::runtime_error("[oatpp::libressl::server::ConnectionProvider::instantiateTLSServer()]: Failed to create tls_server");
   }
 
-  if (tls_configure(handle, m_config->getTLSConfig()) < 0) {
+  if (tls_configure(handle, config->getTLSConfig()) < 0) {
     OATPP_LOGD("[oatpp::libressl::server::ConnectionProvider::instantiateTLSServer()]", "Error on call to 'tls_configure'. %s", tls_error(handle));
+    tls_free(handle);
     throw std::runtime_error( "[oatpp::libressl::server::ConnectionProvider::instantiateTLSServer()]: Failed to configure tls_server");
   }
 
-  return std::make_shared<TLSObject>(handle, TLSObject::Type::SERVER, nullptr);
+  auto tlsObject = std::make_shared<TLSObject>(handle, TLSObject::Type::SERVER, nullptr);
+  tlsObject->setCertificateType(config->getCertificateType());
+  return tlsObject;
+
+}
+
+std::shared_ptr<ConnectionProvider::ServerContext> ConnectionProvider::createServerContext(const std::shared_ptr<Config>& config) {
+  auto context = std::make_shared<ServerContext>();
+  context->config = config;
+  context->nextTLSObject = 0;
+  context->tlsObjects = std::make_shared<Connection::TLSObjects>();
+  for(v_int32 i = 0; i < config->getServerContextShards(); i ++) {
+    context->tlsObjects->push_back(instantiateTLSServer(config));
+  }
+  return context;
+}
+
+std::shared_ptr<Connection> ConnectionProvider::createConnection(const std::shared_ptr<ServerContext>& context,
+                                                                 const provider::ResourceHandle<data::stream::IOStream>& stream,
+                                                                 const std::shared_ptr<CertificateProvider>& certificateProvider,
+                                                                 const std::shared_ptr<ConnectionStatistics>& statistics)
+{
+  /* connections are spread over the shards round-robin - regardless of which thread accepts or handshakes them */
+  auto index = context->nextTLSObject ++ % context->tlsObjects->size();
+  auto connection = Connection::createShared((*context->tlsObjects)[index], stream);
+  connection->applyConfig(context->config);
+  if(certificateProvider) {
+    connection->setCertificateProvider(certificateProvider);
+  }
+  connection->setStatistics(statistics);
+  return connection;
+}
+
+void ConnectionProvider::reloadConfig(const std::shared_ptr<Config>& config) {
+  /* build everything before the swap - accepts are not blocked meanwhile */
+  auto context = createServerContext(config);
+  m_context->store(context);
+  m_reloadsCount ++;
+}
+
+std::shared_ptr<Config> ConnectionProvider::getConfig() const {
+  return m_context->load()->config;
+}
+
+void ConnectionProvider::startWatching(const oatpp::String& certFile,
+                                       const oatpp::String& keyFile,
+                                       const std::chrono::duration<v_int64, std::micro>& interval,
+                                       const ConfigFactory& factory)
+{
+
+  stopWatching();
+
+  {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watchRunning = true;
+  }
+
+  /* by default the current config is cloned - so that nothing but the keypair changes */
+  bool cloneConfig = !factory;
+  ConfigFactory configFactory = factory;
+  if(!configFactory) {
+    configFactory = [this, certFile, keyFile]() {
+      return getConfig()->cloneWithKeypairFiles(certFile->c_str(), keyFile->c_str());
+    };
+  }
+
+  m_watchThread = std::thread([this, certFile, keyFile, interval, configFactory, cloneConfig] {
+
+    FileVersion certVersion = getFileVersion(certFile);
+    FileVersion keyVersion = getFileVersion(keyFile);
+
+    std::unique_lock<std::mutex> lock(m_watchMutex);
+
+    while(m_watchRunning) {
+
+      auto deadline = std::chrono::steady_clock::now() + interval;
+      while(m_watchRunning && std::chrono::steady_clock::now() < deadline) {
+        m_watchCondition.wait_until(lock, deadline);
+      }
+
+      if(!m_watchRunning) {
+        break;
+      }
+
+      FileVersion newCertVersion = getFileVersion(certFile);
+      FileVersion newKeyVersion = getFileVersion(keyFile);
+
+      if(newCertVersion == certVersion && newKeyVersion == keyVersion) {
+        continue;
+      }
+
+      lock.unlock();
+
+      try {
+        auto previousConfig = getConfig();
+        auto config = configFactory();
+        reloadConfig(config);
+        if(cloneConfig) {
+          /* the clone is in use - it rotates ticket keys from now on, the previous config stops */
+          config->takeOverTicketKeyRotation(*previousConfig);
+        }
+        certVersion = newCertVersion;
+        keyVersion = newKeyVersion;
+        OATPP_LOGD("[oatpp::libressl::server::ConnectionProvider::startWatching()]", "Config reloaded.");
+      } catch (std::runtime_error& e) {
+        /* files may be in the middle of an update - retry on the next check */
+        m_reloadFailuresCount ++;
+        OATPP_LOGE("[oatpp::libressl::server::ConnectionProvider::startWatching()]", "Error. Reload failed. %s", e.what());
+      }
+
+      lock.lock();
+
+    }
+
+  });
+
+}
+
+void ConnectionProvider::stopWatching() {
+
+  {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watchRunning = false;
+  }
+
+  m_watchCondition.notify_all();
 
+  if(m_watchThread.joinable()) {
+    m_watchThread.join();
+  }
+
+}
+
+v_int64 ConnectionProvider::getReloadsCount() const {
+  return m_reloadsCount;
+}
+
+v_int64 ConnectionProvider::getReloadFailuresCount() const {
+  return m_reloadFailuresCount;
+}
+
+void ConnectionProvider::setCertificateProvider(const std::shared_ptr<CertificateProvider>& provider) {
+  m_certificateProvider = provider;
+}
+
+std::shared_ptr<CertificateProvider> ConnectionProvider::getCertificateProvider() const {
+  return m_certificateProvider;
+}
+
+void ConnectionProvider::setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics) {
+  m_statistics = statistics;
+}
+
+std::shared_ptr<ConnectionStatistics> ConnectionProvider::getStatistics() const {
+  return m_statistics;
 }
 
 void ConnectionProvider::stop() {
   if(!m_closed) {
     m_closed = true;
-    if(m_tlsObject) {
-      m_tlsObject->close();
+    stopWatching();
+    for(auto& tlsObject : *m_context->load()->tlsObjects) {
+      tlsObject->close();
     }
     m_streamProvider->stop();
   }
@@ -116,13 +328,80 @@ void ConnectionProvider::stop() {
 provider::ResourceHandle<data::stream::IOStream> ConnectionProvider::get(){
   auto transportStream = m_streamProvider->get();
   if(transportStream) {
-    return provider::ResourceHandle<data::stream::IOStream>(
-        std::make_shared<Connection>(m_tlsObject, transportStream),
-        m_connectionInvalidator
-      );
+    auto connection = createConnection(m_context->load(), transportStream, m_certificateProvider, m_statistics);
+    return provider::ResourceHandle<data::stream::IOStream>(connection, m_connectionInvalidator);
   }
   return nullptr;
 }
 
-}}}
+oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> ConnectionProvider::startTransportAccept() {
+  try {
+    return m_streamProvider->getAsync();
+  } catch (std::runtime_error& e) {
+    throw std::runtime_error(std::string("[oatpp::libressl::server::ConnectionProvider::getAsync()]: Error. "
+                                         "Underlying stream provider doesn't support asynchronous accept - use get() instead "
+                                         "(oatpp::web::server::AsyncHttpConnectionHandler accepts with get() on a separate thread). ") + e.what());
+  }
+}
+
+oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> ConnectionProvider::getAsync() {
+
+  typedef oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> AcceptStarter;
+
+  class AcceptCoroutine : public async::CoroutineWithResult<AcceptCoroutine, const provider::ResourceHandle<data::stream::IOStream>&> {
+  private:
+    std::shared_ptr<ConnectionInvalidator> m_connectionInvalidator;
+    AcceptStarter m_acceptTransport;
+    std::shared_ptr<ServerContextReference> m_context;
+    std::shared_ptr<CertificateProvider> m_certificateProvider;
+    std::shared_ptr<ConnectionStatistics> m_statistics;
+  public:
+
+    AcceptCoroutine(const std::shared_ptr<ConnectionInvalidator>& connectionInvalidator,
+                    AcceptStarter&& acceptTransport,
+                    const std::shared_ptr<ServerContextReference>& context,
+                    const std::shared_ptr<CertificateProvider>& certificateProvider,
+                    const std::shared_ptr<ConnectionStatistics>& statistics)
+      : m_connectionInvalidator(connectionInvalidator)
+      , m_acceptTransport(std::move(acceptTransport))
+      , m_context(context)
+      , m_certificateProvider(certificateProvider)
+      , m_statistics(statistics)
+    {}
+
+    Action act() override {
+      /* accept transport stream */
+      return m_acceptTransport.callbackTo(&AcceptCoroutine::onAccepted);
+    }
+
+    Action onAccepted(const provider::ResourceHandle<data::stream::IOStream>& stream) {
+
+      if(!stream) {
+        return _return(nullptr);
+      }
 
+      /* context is taken at accept time - so that reloads done while waiting for the connection apply */
+      auto context = m_context->load();
+
+      auto connection = createConnection(context, stream, m_certificateProvider, m_statistics);
+
+      connection->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+      connection->setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+      return _return(provider::ResourceHandle<data::stream::IOStream>(connection, m_connectionInvalidator));
+
+    }
+
+  };
+
+  /*
+   * Underlying accept is started right here - a provider without async accept (such as oatpp::network::tcp::server::ConnectionProvider)
+   * fails on this call and not somewhere inside the executor.
+   */
+  auto acceptTransport = startTransportAccept();
+
+  return AcceptCoroutine::startForResult(m_connectionInvalidator, std::move(acceptTransport), m_context, m_certificateProvider, m_statistics);
+
+}
+
+}}}
@@ -25,12 +25,22 @@
 #ifndef oatpp_libressl_server_ConnectionProvider_hpp
 #define oatpp_libressl_server_ConnectionProvider_hpp
 
+#include "oatpp-libressl/server/CertificateProvider.hpp"
 #include "oatpp-libressl/Config.hpp"
+#include "oatpp-libressl/Connection.hpp"
+#include "oatpp-libressl/ConnectionStatistics.hpp"
 #include "oatpp-libressl/TLSObject.hpp"
 
 #include "oatpp/network/Address.hpp"
 #include "oatpp/network/ConnectionProvider.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 namespace oatpp { namespace libressl { namespace server {
 
 /**
@@ -45,14 +55,55 @@ private:
     void invalidate(const std::shared_ptr<data::stream::IOStream>& connection) override;
   };
 
+  /*
+   * Config and the `tls_server` contexts made of it. Replaced as a whole on reload.
+   */
+  struct ServerContext {
+    std::shared_ptr<Config> config;
+    std::shared_ptr<Connection::TLSObjects> tlsObjects;
+    std::atomic<v_uint64> nextTLSObject;
+  };
+
+  /*
+   * Current server context. Shared with accept coroutines, so that they pick up reloads.
+   */
+  class ServerContextReference {
+  private:
+    std::shared_ptr<ServerContext> m_context;
+  public:
+    std::shared_ptr<ServerContext> load() const;
+    void store(const std::shared_ptr<ServerContext>& context);
+  };
+
+public:
+
+  /**
+   * Function to create config on reload. See &l:ConnectionProvider::startWatching ();.
+   */
+  typedef std::function<std::shared_ptr<Config>()> ConfigFactory;
+
 private:
   std::shared_ptr<ConnectionInvalidator> m_connectionInvalidator;
-  std::shared_ptr<Config> m_config;
   std::shared_ptr<oatpp::network::ServerConnectionProvider> m_streamProvider;
   bool m_closed;
-  std::shared_ptr<TLSObject> m_tlsObject;
+  std::shared_ptr<ServerContextReference> m_context;
+  std::shared_ptr<CertificateProvider> m_certificateProvider;
+  std::shared_ptr<ConnectionStatistics> m_statistics;
+  std::atomic<v_int64> m_reloadsCount;
+  std::atomic<v_int64> m_reloadFailuresCount;
+private:
+  std::thread m_watchThread;
+  std::mutex m_watchMutex;
+  std::condition_variable m_watchCondition;
+  bool m_watchRunning;
 private:
-  std::shared_ptr<TLSObject> instantiateTLSServer();
+  static std::shared_ptr<TLSObject> instantiateTLSServer(const std::shared_ptr<Config>& config);
+  static std::shared_ptr<ServerContext> createServerContext(const std::shared_ptr<Config>& config);
+  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> startTransportAccept();
+  static std::shared_ptr<Connection> createConnection(const std::shared_ptr<ServerContext>& context,
+                                                      const provider::ResourceHandle<data::stream::IOStream>& stream,
+                                                      const std::shared_ptr<CertificateProvider>& certificateProvider,
+                                                      const std::shared_ptr<ConnectionStatistics>& statistics);
 public:
   /**
    * Constructor.
@@ -76,8 +127,9 @@ public:
    * Create shared ConnectionProvider.
    * @param config - &id:oatpp::libressl::Config;.
    * @param address - &id:oatpp::network::Address;.
-   * @param useExtendedConnections - set `true` to use &l:ConnectionProvider::ExtendedConnection;.
-   * `false` to use &id:oatpp::network::tcp::Connection;.
+   * Transport is &id:oatpp::libressl::server::TcpConnectionProvider; - it supports both `get()` and `getAsync()`.
+   * @param useExtendedConnections - set `true` to add peer address properties to the connection contexts.
+   * `false` to use plain &id:oatpp::network::tcp::Connection;.
    * @return - `std::shared_ptr` to ConnectionProvider.
    */
   static std::shared_ptr<ConnectionProvider> createShared(const std::shared_ptr<Config>& config,
@@ -90,6 +142,80 @@ public:
    */
   ~ConnectionProvider();
 
+  /**
+   * Replace config and `tls_server` contexts of the provider. <br>
+   * New contexts are built on the calling thread, then swapped in atomically - connections accepted after the call use the new config,
+   * while established connections keep the old contexts until they are closed.
+   * @param config - new &id:oatpp::libressl::Config;.
+   * @throws - `std::runtime_error` if the contexts can't be created. The current config stays in use.
+   */
+  void reloadConfig(const std::shared_ptr<Config>& config);
+
+  /**
+   * Get current config.
+   * @return - &id:oatpp::libressl::Config;.
+   */
+  std::shared_ptr<Config> getConfig() const;
+
+  /**
+   * Start watching certificate and key files. When any of them changes (modification time with sub-second precision,
+   * size or inode), config is created with `factory` and applied with &l:ConnectionProvider::reloadConfig ();. <br>
+   * Files are checked on a separate thread. Failed reloads are logged and retried on the next change.
+   * @param certFile - path to the certificate file.
+   * @param keyFile - path to the private key file.
+   * @param interval - check interval.
+   * @param factory - &l:ConnectionProvider::ConfigFactory;. `nullptr` - current config is cloned with the watched keypair
+   * (see &id:oatpp::libressl::Config::cloneWithKeypairFiles;), and its ticket key rotation is handed over to the clone.
+   */
+  void startWatching(const oatpp::String& certFile,
+                     const oatpp::String& keyFile,
+                     const std::chrono::duration<v_int64, std::micro>& interval = std::chrono::seconds(1),
+                     const ConfigFactory& factory = nullptr);
+
+  /**
+   * Stop watching certificate and key files.
+   */
+  void stopWatching();
+
+  /**
+   * Get number of successful reloads.
+   * @return
+   */
+  v_int64 getReloadsCount() const;
+
+  /**
+   * Get number of failed reloads triggered by file changes.
+   * @return
+   */
+  v_int64 getReloadFailuresCount() const;
+
+  /**
+   * Set provider of `tls_server` contexts by SNI server name. <br>
+   * When set, connections read the ClientHello and accept TLS on the context returned by the provider for the requested server name.
+   * Overrides keypairs added with &id:oatpp::libressl::Config::addCertificate;. Must be set before accepting connections.
+   * @param provider - &id:oatpp::libressl::server::CertificateProvider;.
+   */
+  void setCertificateProvider(const std::shared_ptr<CertificateProvider>& provider);
+
+  /**
+   * Get provider of `tls_server` contexts by SNI server name.
+   * @return - &id:oatpp::libressl::server::CertificateProvider;. `nullptr` if not set.
+   */
+  std::shared_ptr<CertificateProvider> getCertificateProvider() const;
+
+  /**
+   * Set statistics to aggregate metrics of the accepted connections to. Providers may share the same statistics. <br>
+   * Each provider collects its own statistics by default. Must be set before accepting connections.
+   * @param statistics - &id:oatpp::libressl::ConnectionStatistics;. `nullptr` - don't collect.
+   */
+  void setStatistics(const std::shared_ptr<ConnectionStatistics>& statistics);
+
+  /**
+   * Get statistics of the accepted connections.
+   * @return - &id:oatpp::libressl::ConnectionStatistics;. `nullptr` if not collected.
+   */
+  std::shared_ptr<ConnectionStatistics> getStatistics() const;
+
   /**
    * Close all handles.
    */
@@ -102,22 +228,17 @@ public:
   provider::ResourceHandle<data::stream::IOStream> get() override;
 
   /**
-   * No need to implement this.<br>
-   * For Asynchronous IO in oatpp it is considered to be a good practice
-   * to accept connections in a seperate thread with the blocking accept()
-   * and then process connections in Asynchronous manner with non-blocking read/write.
-   * <br>
-   * *It may be implemented later*
-   */
-  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> getAsync() override {
-    /*
-     *  No need to implement this.
-     *  For Asynchronous IO in oatpp it is considered to be a good practice
-     *  to accept connections in a seperate thread with the blocking accept()
-     *  and then process connections in Asynchronous manner with non-blocking read/write
-     */
-    throw std::runtime_error("oatpp::libressl::server::ConnectionProvider::getConnectionAsync not implemented.");
-  }
+   * Get incoming connection in asynchronous manner. <br>
+   * Wraps `getAsync()` of the underlying stream provider. *Only underlying providers with asynchronous accept are supported* -
+   * such as &id:oatpp::libressl::server::TcpConnectionProvider; (used by `createShared(config, address)`) or
+   * &id:oatpp::network::virtual_::server::ConnectionProvider;. &id:oatpp::network::tcp::server::ConnectionProvider;
+   * doesn't implement it - accept its connections with &l:ConnectionProvider::get (); instead. <br>
+   * Returned connection is in &id:oatpp::data::stream::IOMode::ASYNCHRONOUS; mode and is not handshaked yet -
+   * the handshake runs on the executor via `initContextsAsync()` (as &id:oatpp::web::server::AsyncHttpConnectionHandler; does).
+   * @return - &id:oatpp::async::CoroutineStarterForResult;.
+   * @throws - `std::runtime_error` if the underlying stream provider doesn't support asynchronous accept.
+   */
+  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> getAsync() override;
   
 };
   
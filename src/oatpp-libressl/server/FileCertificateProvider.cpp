@@ -0,0 +1,250 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "FileCertificateProvider.hpp"
+
+namespace oatpp { namespace libressl { namespace server {
+
+FileCertificateProvider::FileCertificateProvider(const std::shared_ptr<Config>& config,
+                                                 const oatpp::String& directory,
+                                                 v_int64 capacity)
+  : m_config(config)
+  , m_directory(directory)
+  , m_capacity(capacity < 1 ? 1 : capacity)
+  , m_hits(0)
+  , m_misses(0)
+  , m_loads(0)
+  , m_notFound(0)
+  , m_evictions(0)
+  , m_loadTimeMicro(0)
+{}
+
+std::shared_ptr<FileCertificateProvider> FileCertificateProvider::createShared(const std::shared_ptr<Config>& config,
+                                                                               const oatpp::String& directory,
+                                                                               v_int64 capacity)
+{
+  return std::make_shared<FileCertificateProvider>(config, directory, capacity);
+}
+
+bool FileCertificateProvider::isValidName(const std::string& name) {
+
+  /* name becomes a part of the file path - no path separators and no dot-segments */
+  if(name.empty() || name.size() > 253 || name[0] == '.') {
+    return false;
+  }
+
+  char prev = 0;
+  for(char c : name) {
+    bool valid = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+    if(!valid || (c == '.' && prev == '.')) {
+      return false;
+    }
+    prev = c;
+  }
+
+  return true;
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> FileCertificateProvider::load(const std::string& stem) {
+
+  std::string path = std::string(m_directory->data(), m_directory->size()) + "/" + stem;
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+
+  auto certPem = oatpp::String::loadFromFile((path + ".crt").c_str());
+  if(!certPem) {
+    return nullptr;
+  }
+
+  auto keyPem = oatpp::String::loadFromFile((path + ".key").c_str());
+  if(!keyPem) {
+    OATPP_LOGE("[oatpp::libressl::server::FileCertificateProvider::load()]", "Error. No key file for '%s'.", stem.c_str());
+    return nullptr;
+  }
+
+  /* "_.example.com" is the wildcard keypair for "*.example.com" */
+  std::string name = stem;
+  if(name.size() > 2 && name[0] == '_' && name[1] == '.') {
+    name[0] = '*';
+  }
+
+  std::shared_ptr<CertificateIndex::Keypair> keypair;
+  try {
+    keypair = m_config->createKeypair(certPem, keyPem, {oatpp::String(name)});
+  } catch (std::runtime_error& e) {
+    OATPP_LOGE("[oatpp::libressl::server::FileCertificateProvider::load()]", "Error. Can't load keypair '%s'. %s", stem.c_str(), e.what());
+    return nullptr;
+  }
+
+  m_loads ++;
+  m_loadTimeMicro += oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  return keypair;
+
+}
+
+void FileCertificateProvider::put(const std::string& name, const std::shared_ptr<CertificateIndex::Keypair>& keypair) {
+
+  auto it = m_map.find(name);
+  if(it != m_map.end()) {
+    it->second->keypair = keypair;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return;
+  }
+
+  m_entries.push_front({name, keypair});
+  m_map[name] = m_entries.begin();
+
+  while((v_int64) m_entries.size() > m_capacity) {
+    m_map.erase(m_entries.back().name);
+    m_entries.pop_back();
+    m_evictions ++;
+  }
+
+}
+
+bool FileCertificateProvider::get(const std::string& name, std::shared_ptr<CertificateIndex::Keypair>& keypair) {
+
+  auto it = m_map.find(name);
+  if(it == m_map.end()) {
+    return false;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  keypair = it->second->keypair;
+  return true;
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> FileCertificateProvider::resolve(const std::string& name, bool withWildcard) {
+
+  std::shared_ptr<Loading> loading;
+
+  {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::shared_ptr<CertificateIndex::Keypair> keypair;
+    if(get(name, keypair)) {
+      return keypair; // loaded meanwhile
+    }
+
+    auto it = m_loading.find(name);
+    if(it != m_loading.end()) {
+      loading = it->second;
+      m_loadingCondition.wait(lock, [&loading]{ return loading->done; });
+      return loading->keypair;
+    }
+
+    loading = std::make_shared<Loading>();
+    loading->done = false;
+    m_loading[name] = loading;
+
+  }
+
+  /* load without holding the lock - other handshakes go on meanwhile */
+  auto keypair = load(name);
+
+  if(!keypair && withWildcard) {
+    auto dot = name.find('.');
+    if(dot != std::string::npos && dot > 0) {
+      keypair = resolve("_" + name.substr(dot), false);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    put(name, keypair);
+    loading->keypair = keypair;
+    loading->done = true;
+    m_loading.erase(name);
+  }
+
+  m_loadingCondition.notify_all();
+
+  return keypair;
+
+}
+
+std::shared_ptr<CertificateIndex::Keypair> FileCertificateProvider::getKeypair(const char* serverName, v_buff_size size) {
+
+  auto name = CertificateIndex::normalize(serverName, size);
+  if(!isValidName(name)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<CertificateIndex::Keypair> keypair;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(get(name, keypair)) {
+      m_hits ++;
+      return keypair;
+    }
+  }
+
+  m_misses ++;
+
+  keypair = resolve(name, true);
+
+  if(!keypair) {
+    m_notFound ++;
+  }
+
+  return keypair;
+
+}
+
+std::shared_ptr<TLSObject> FileCertificateProvider::getServerContext(const char* serverName, v_buff_size size) {
+  auto keypair = getKeypair(serverName, size);
+  if(keypair) {
+    return keypair->getServerContext();
+  }
+  return nullptr;
+}
+
+void FileCertificateProvider::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_map.clear();
+}
+
+FileCertificateProvider::Statistics FileCertificateProvider::getStatistics() {
+  Statistics statistics;
+  statistics.hits = m_hits;
+  statistics.misses = m_misses;
+  statistics.loads = m_loads;
+  statistics.notFound = m_notFound;
+  statistics.evictions = m_evictions;
+  statistics.loadTimeMicro = m_loadTimeMicro;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    statistics.size = (v_int64) m_entries.size();
+  }
+  return statistics;
+}
+
+}}}
@@ -0,0 +1,190 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_server_FileCertificateProvider_hpp
+#define oatpp_libressl_server_FileCertificateProvider_hpp
+
+#include "CertificateProvider.hpp"
+
+#include "oatpp-libressl/Config.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace oatpp { namespace libressl { namespace server {
+
+/**
+ * Certificate provider which loads keypairs from a directory on demand and keeps a bounded LRU cache of them. <br>
+ * Nothing is loaded at startup. For server name `host.example.com` it looks for
+ * `<directory>/host.example.com.crt` and `<directory>/host.example.com.key`, then for the wildcard keypair
+ * `<directory>/_.example.com.crt` and `<directory>/_.example.com.key`. <br>
+ * Names without a keypair are cached as well, so unknown names don't hit the disk on every handshake.
+ * Concurrent handshakes with the same uncached name load it once. <br>
+ * Keypairs are created with &id:oatpp::libressl::Config::createKeypair; - they share protocols, ciphers,
+ * session settings and ticket keys with the config.
+ * Extends &id:oatpp::libressl::server::CertificateProvider;.
+ */
+class FileCertificateProvider : public CertificateProvider {
+public:
+
+  /**
+   * Cache counters.
+   */
+  struct Statistics {
+
+    /**
+     * Number of lookups served from the cache.
+     */
+    v_int64 hits;
+
+    /**
+     * Number of lookups not served from the cache - they went to the disk or waited for a load of the same name.
+     */
+    v_int64 misses;
+
+    /**
+     * Number of keypairs loaded.
+     */
+    v_int64 loads;
+
+    /**
+     * Number of lookups for which no keypair was found on the disk or it failed to load.
+     */
+    v_int64 notFound;
+
+    /**
+     * Number of entries evicted from the cache.
+     */
+    v_int64 evictions;
+
+    /**
+     * Total time spent loading keypairs in microseconds.
+     */
+    v_int64 loadTimeMicro;
+
+    /**
+     * Current number of entries in the cache.
+     */
+    v_int64 size;
+
+  };
+
+private:
+
+  struct Entry {
+    std::string name;
+    std::shared_ptr<CertificateIndex::Keypair> keypair;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  /*
+   * Lookup of a name not in the cache. Concurrent lookups of the same name wait for the first one.
+   */
+  struct Loading {
+    bool done;
+    std::shared_ptr<CertificateIndex::Keypair> keypair;
+  };
+
+private:
+  static bool isValidName(const std::string& name);
+  std::shared_ptr<CertificateIndex::Keypair> load(const std::string& stem);
+  std::shared_ptr<CertificateIndex::Keypair> resolve(const std::string& name, bool withWildcard);
+  /* put() and get() - m_mutex must be locked */
+  void put(const std::string& name, const std::shared_ptr<CertificateIndex::Keypair>& keypair);
+  bool get(const std::string& name, std::shared_ptr<CertificateIndex::Keypair>& keypair);
+private:
+  std::shared_ptr<Config> m_config;
+  oatpp::String m_directory;
+  v_int64 m_capacity;
+  std::mutex m_mutex;
+  EntryList m_entries;
+  std::unordered_map<std::string, EntryList::iterator> m_map;
+  std::unordered_map<std::string, std::shared_ptr<Loading>> m_loading;
+  std::condition_variable m_loadingCondition;
+private:
+  std::atomic<v_int64> m_hits;
+  std::atomic<v_int64> m_misses;
+  std::atomic<v_int64> m_loads;
+  std::atomic<v_int64> m_notFound;
+  std::atomic<v_int64> m_evictions;
+  std::atomic<v_int64> m_loadTimeMicro;
+public:
+
+  /**
+   * Constructor.
+   * @param config - server &id:oatpp::libressl::Config; to create keypairs with.
+   * @param directory - directory with keypair files.
+   * @param capacity - max number of cached entries (loaded keypairs and names without a keypair).
+   */
+  FileCertificateProvider(const std::shared_ptr<Config>& config, const oatpp::String& directory, v_int64 capacity);
+
+  /**
+   * Create shared FileCertificateProvider.
+   * @param config - server &id:oatpp::libressl::Config; to create keypairs with.
+   * @param directory - directory with keypair files.
+   * @param capacity - max number of cached entries.
+   * @return - `std::shared_ptr` to FileCertificateProvider.
+   */
+  static std::shared_ptr<FileCertificateProvider> createShared(const std::shared_ptr<Config>& config,
+                                                               const oatpp::String& directory,
+                                                               v_int64 capacity = 1024);
+
+  /**
+   * Get keypair for the server name - from the cache or from the disk.
+   * @param serverName - server name as sent by the client.
+   * @param size - size of the server name.
+   * @return - &id:oatpp::libressl::CertificateIndex::Keypair;. `nullptr` if there is no keypair for the name.
+   */
+  std::shared_ptr<CertificateIndex::Keypair> getKeypair(const char* serverName, v_buff_size size);
+
+  /**
+   * Get `tls_server` context of the keypair for the server name.
+   * @param serverName - server name as sent by the client.
+   * @param size - size of the server name.
+   * @return - server &id:oatpp::libressl::TLSObject;. `nullptr` if there is no keypair for the name.
+   */
+  std::shared_ptr<TLSObject> getServerContext(const char* serverName, v_buff_size size) override;
+
+  /**
+   * Drop all cached entries. Keypairs changed on the disk are reloaded on the next handshake.
+   */
+  void clear();
+
+  /**
+   * Get cache counters.
+   * @return - &l:FileCertificateProvider::Statistics;.
+   */
+  Statistics getStatistics();
+
+};
+
+}}}
+
+#endif /* oatpp_libressl_server_FileCertificateProvider_hpp */
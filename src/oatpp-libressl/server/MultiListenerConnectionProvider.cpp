@@ -0,0 +1,276 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "MultiListenerConnectionProvider.hpp"
+
+#include "oatpp-libressl/Connection.hpp"
+
+#include "oatpp/core/utils/ConversionUtils.hpp"
+
+#include <algorithm>
+
+namespace oatpp { namespace libressl { namespace server {
+
+MultiListenerConnectionProvider::MultiListenerConnectionProvider(const std::shared_ptr<Config>& config,
+                                                                 const network::Address& address,
+                                                                 v_int32 listenersCount,
+                                                                 bool handshakeOnListener,
+                                                                 v_buff_size maxQueueSize,
+                                                                 const std::chrono::duration<v_int64, std::micro>& handshakeTimeout)
+  : m_config(config)
+  , m_handshakeOnListener(handshakeOnListener)
+  , m_maxQueueSize(maxQueueSize)
+  , m_handshakeTimeoutMicro(handshakeTimeout.count())
+  , m_running(true)
+  , m_acceptedCount(0)
+  , m_handshakeFailuresCount(0)
+  , m_droppedCount(0)
+{
+
+  if(listenersCount < 1) {
+    listenersCount = 1;
+  }
+
+  /* all listeners have to bind the same port - take the one chosen by the first listener if port is 0 */
+  auto first = TcpConnectionProvider::createShared(address, false, true);
+  network::Address boundAddress(address.host, first->getPort(), address.family);
+
+  setProperty(PROPERTY_HOST, address.host);
+  setProperty(PROPERTY_PORT, oatpp::utils::conversion::int32ToStr(first->getPort()));
+
+  m_listeners.resize(listenersCount);
+  m_listeners[0].transport = first;
+  m_listeners[0].provider = server::ConnectionProvider::createShared(config, first);
+  for(v_int32 i = 1; i < listenersCount; i ++) {
+    m_listeners[i].transport = TcpConnectionProvider::createShared(boundAddress, false, true);
+    m_listeners[i].provider = server::ConnectionProvider::createShared(config, m_listeners[i].transport);
+    m_listeners[i].provider->setStatistics(m_listeners[0].provider->getStatistics());
+  }
+
+  if(m_handshakeOnListener) {
+    m_handshakesWatcher = std::thread(&MultiListenerConnectionProvider::watchHandshakes, this);
+  }
+
+  for(auto& listener : m_listeners) {
+    listener.thread = std::thread(&MultiListenerConnectionProvider::acceptLoop, this, listener.provider);
+  }
+
+}
+
+std::shared_ptr<MultiListenerConnectionProvider>
+MultiListenerConnectionProvider::createShared(const std::shared_ptr<Config>& config,
+                                              const network::Address& address,
+                                              v_int32 listenersCount,
+                                              bool handshakeOnListener,
+                                              v_buff_size maxQueueSize,
+                                              const std::chrono::duration<v_int64, std::micro>& handshakeTimeout)
+{
+  return std::make_shared<MultiListenerConnectionProvider>(config, address, listenersCount, handshakeOnListener, maxQueueSize, handshakeTimeout);
+}
+
+MultiListenerConnectionProvider::~MultiListenerConnectionProvider() {
+  stop();
+}
+
+void MultiListenerConnectionProvider::acceptLoop(const std::shared_ptr<server::ConnectionProvider>& provider) {
+
+  while(m_running) {
+
+    auto connection = provider->get();
+    if(!connection) {
+      continue;
+    }
+
+    m_acceptedCount ++;
+
+    if(m_handshakeOnListener && !handshake(connection)) {
+      m_handshakeFailuresCount ++;
+      connection.invalidator->invalidate(connection.object);
+      continue;
+    }
+
+    push(std::move(connection));
+
+  }
+
+}
+
+bool MultiListenerConnectionProvider::handshake(const provider::ResourceHandle<data::stream::IOStream>& connection) {
+
+  std::list<Handshake>::iterator entry;
+
+  {
+    std::lock_guard<std::mutex> lock(m_handshakesMutex);
+    if(!m_running) {
+      return false;
+    }
+    Handshake handshake;
+    handshake.connection = connection;
+    handshake.deadline = oatpp::base::Environment::getMicroTickCount() + m_handshakeTimeoutMicro;
+    handshake.expired = false;
+    entry = m_handshakes.insert(m_handshakes.end(), handshake);
+    m_handshakesCondition.notify_one();
+  }
+
+  /* blocking - watchHandshakes() or stop() shut the transport down if the client doesn't complete in time */
+  auto c = std::static_pointer_cast<Connection>(connection.object);
+  c->initContexts();
+
+  bool expired;
+  {
+    std::lock_guard<std::mutex> lock(m_handshakesMutex);
+    expired = entry->expired;
+    m_handshakes.erase(entry);
+  }
+
+  /* transport of the expired handshake is shut down - even if the handshake got completed just in time */
+  return !expired && c->getHandshakeState() == Connection::HandshakeState::COMPLETE;
+
+}
+
+void MultiListenerConnectionProvider::watchHandshakes() {
+
+  std::unique_lock<std::mutex> lock(m_handshakesMutex);
+
+  while(m_running) {
+
+    auto now = oatpp::base::Environment::getMicroTickCount();
+    v_int64 next = now + m_handshakeTimeoutMicro;
+
+    for(auto& handshake : m_handshakes) {
+      if(handshake.expired) {
+        continue;
+      }
+      if(handshake.deadline <= now) {
+        handshake.expired = true;
+        handshake.connection.invalidator->invalidate(handshake.connection.object);
+      } else {
+        next = std::min(next, handshake.deadline);
+      }
+    }
+
+    m_handshakesCondition.wait_for(lock, std::chrono::microseconds(next - now));
+
+  }
+
+}
+
+void MultiListenerConnectionProvider::push(provider::ResourceHandle<data::stream::IOStream>&& connection) {
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if(m_running && (v_buff_size) m_queue.size() < m_maxQueueSize) {
+      m_queue.push_back(std::move(connection));
+      m_queueCondition.notify_one();
+      return;
+    }
+  }
+  m_droppedCount ++;
+  connection.invalidator->invalidate(connection.object);
+}
+
+void MultiListenerConnectionProvider::stop() {
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if(!m_running) {
+      return;
+    }
+    m_running = false;
+    m_queueCondition.notify_all();
+  }
+
+  /* wake up accept threads - blocked in accept or in a handshake on the listener */
+  for(auto& listener : m_listeners) {
+    listener.transport->stop();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_handshakesMutex);
+    for(auto& handshake : m_handshakes) {
+      handshake.connection.invalidator->invalidate(handshake.connection.object);
+    }
+    m_handshakesCondition.notify_all();
+  }
+
+  if(m_handshakesWatcher.joinable()) {
+    m_handshakesWatcher.join();
+  }
+
+  /* join accept threads before closing TLS contexts - contexts must outlive handshakes running on them */
+  for(auto& listener : m_listeners) {
+    if(listener.thread.joinable()) {
+      listener.thread.join();
+    }
+  }
+
+  std::list<provider::ResourceHandle<data::stream::IOStream>> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    pending.swap(m_queue);
+  }
+  for(auto& connection : pending) {
+    connection.invalidator->invalidate(connection.object);
+  }
+
+  for(auto& listener : m_listeners) {
+    listener.provider->stop();
+  }
+
+}
+
+provider::ResourceHandle<data::stream::IOStream> MultiListenerConnectionProvider::get() {
+  std::unique_lock<std::mutex> lock(m_queueMutex);
+  while(m_running && m_queue.empty()) {
+    m_queueCondition.wait(lock);
+  }
+  if(m_queue.empty()) {
+    return nullptr;
+  }
+  auto connection = std::move(m_queue.front());
+  m_queue.pop_front();
+  return connection;
+}
+
+std::shared_ptr<ConnectionStatistics> MultiListenerConnectionProvider::getStatistics() const {
+  return m_listeners[0].provider->getStatistics();
+}
+
+v_int32 MultiListenerConnectionProvider::getListenersCount() const {
+  return (v_int32) m_listeners.size();
+}
+
+v_int64 MultiListenerConnectionProvider::getAcceptedCount() const {
+  return m_acceptedCount;
+}
+
+v_int64 MultiListenerConnectionProvider::getHandshakeFailuresCount() const {
+  return m_handshakeFailuresCount;
+}
+
+v_int64 MultiListenerConnectionProvider::getDroppedCount() const {
+  return m_droppedCount;
+}
+
+}}}
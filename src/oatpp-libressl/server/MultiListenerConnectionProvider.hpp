@@ -0,0 +1,197 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_server_MultiListenerConnectionProvider_hpp
+#define oatpp_libressl_server_MultiListenerConnectionProvider_hpp
+
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/TcpConnectionProvider.hpp"
+
+#include "oatpp/network/Address.hpp"
+#include "oatpp/network/ConnectionProvider.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace libressl { namespace server {
+
+/**
+ * Libressl server connection provider with multiple listeners. <br>
+ * Opens `N` listening sockets on the same address with `SO_REUSEPORT` - the kernel distributes incoming connections
+ * between them. Each listener has its own &id:oatpp::libressl::server::ConnectionProvider; (and its own `tls_server` context) and its own accept thread.
+ * Accepted connections from all listeners are queued and returned by &l:MultiListenerConnectionProvider::get ();,
+ * so all of them feed the same connection handler. <br>
+ * By default connections are returned not handshaked - the handshake runs on the connection handler thread.
+ * Handshakes on the listeners are optional and bounded by a deadline, so an idle client holds its listener for the handshake timeout at most. <br>
+ * *POSIX only. Requires `SO_REUSEPORT` support.*
+ * Extends &id:oatpp::base::Countable;, &id:oatpp::network::ServerConnectionProvider;.
+ */
+class MultiListenerConnectionProvider : public oatpp::network::ServerConnectionProvider {
+private:
+
+  struct Listener {
+    std::shared_ptr<TcpConnectionProvider> transport;
+    std::shared_ptr<server::ConnectionProvider> provider;
+    std::thread thread;
+  };
+
+  /*
+   * Handshake running on a listener thread.
+   */
+  struct Handshake {
+    provider::ResourceHandle<data::stream::IOStream> connection;
+    v_int64 deadline;
+    bool expired;
+  };
+
+private:
+  void acceptLoop(const std::shared_ptr<server::ConnectionProvider>& provider);
+  bool handshake(const provider::ResourceHandle<data::stream::IOStream>& connection);
+  void watchHandshakes();
+  void push(provider::ResourceHandle<data::stream::IOStream>&& connection);
+private:
+  std::shared_ptr<Config> m_config;
+  bool m_handshakeOnListener;
+  v_buff_size m_maxQueueSize;
+  v_int64 m_handshakeTimeoutMicro;
+  std::atomic<bool> m_running;
+  std::vector<Listener> m_listeners;
+  std::mutex m_handshakesMutex;
+  std::condition_variable m_handshakesCondition;
+  std::list<Handshake> m_handshakes;
+  std::thread m_handshakesWatcher;
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueCondition;
+  std::list<provider::ResourceHandle<data::stream::IOStream>> m_queue;
+  std::atomic<v_int64> m_acceptedCount;
+  std::atomic<v_int64> m_handshakeFailuresCount;
+  std::atomic<v_int64> m_droppedCount;
+public:
+
+  /**
+   * Constructor.
+   * @param config - &id:oatpp::libressl::Config;.
+   * @param address - &id:oatpp::network::Address;. If port is `0` - all listeners share the port chosen by the first one.
+   * @param listenersCount - number of listening sockets (and accept threads).
+   * @param handshakeOnListener - `false` (default) - return connections not handshaked yet
+   * (handshake runs on the connection handler thread, as with &id:oatpp::libressl::server::ConnectionProvider;). <br>
+   * `true` to complete the TLS handshake on the accept thread of the listener before the connection is returned -
+   * so handshakes scale with the number of listeners. Connections which fail the handshake or don't complete it
+   * within `handshakeTimeout` are dropped. *Note: a slow client holds its listener for the time of the handshake.*
+   * @param maxQueueSize - max number of accepted connections waiting for &l:MultiListenerConnectionProvider::get ();.
+   * Connections accepted when the queue is full are dropped.
+   * @param handshakeTimeout - deadline of the handshake on the listener. Ignored if `handshakeOnListener` is `false`.
+   */
+  MultiListenerConnectionProvider(const std::shared_ptr<Config>& config,
+                                  const network::Address& address,
+                                  v_int32 listenersCount,
+                                  bool handshakeOnListener = false,
+                                  v_buff_size maxQueueSize = 1024,
+                                  const std::chrono::duration<v_int64, std::micro>& handshakeTimeout = std::chrono::seconds(10));
+public:
+
+  /**
+   * Create shared MultiListenerConnectionProvider.
+   * @param config - &id:oatpp::libressl::Config;.
+   * @param address - &id:oatpp::network::Address;.
+   * @param listenersCount - number of listening sockets (and accept threads).
+   * @param handshakeOnListener - `true` to complete the TLS handshake on the accept thread of the listener.
+   * @param maxQueueSize - max number of accepted connections waiting for &l:MultiListenerConnectionProvider::get ();.
+   * @param handshakeTimeout - deadline of the handshake on the listener.
+   * @return - `std::shared_ptr` to MultiListenerConnectionProvider.
+   */
+  static std::shared_ptr<MultiListenerConnectionProvider> createShared(const std::shared_ptr<Config>& config,
+                                                                       const network::Address& address,
+                                                                       v_int32 listenersCount,
+                                                                       bool handshakeOnListener = false,
+                                                                       v_buff_size maxQueueSize = 1024,
+                                                                       const std::chrono::duration<v_int64, std::micro>& handshakeTimeout = std::chrono::seconds(10));
+
+  /**
+   * Virtual destructor.
+   */
+  ~MultiListenerConnectionProvider();
+
+  /**
+   * Stop accept threads and close all listeners. Handshakes running on the listeners are aborted,
+   * pending connections are invalidated.
+   */
+  void stop() override;
+
+  /**
+   * Get incoming connection accepted by any of the listeners. Blocks until a connection is available or the provider is stopped.
+   * @return &id:oatpp::data::stream::IOStream;. `nullptr` if the provider is stopped.
+   */
+  provider::ResourceHandle<data::stream::IOStream> get() override;
+
+  /**
+   * Not implemented. <br>
+   * Connections are accepted by the listener threads - use `get()` from the accepting thread
+   * and process connections in Asynchronous manner.
+   */
+  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> getAsync() override {
+    throw std::runtime_error("[oatpp::libressl::server::MultiListenerConnectionProvider::getAsync()]: Error. Not implemented.");
+  }
+
+  /**
+   * Get number of listeners.
+   * @return
+   */
+  v_int32 getListenersCount() const;
+
+  /**
+   * Get number of connections accepted by all listeners.
+   * @return
+   */
+  v_int64 getAcceptedCount() const;
+
+  /**
+   * Get number of connections dropped because of a failed or timed out handshake on the listener.
+   * @return
+   */
+  v_int64 getHandshakeFailuresCount() const;
+
+  /**
+   * Get number of connections dropped because the queue was full.
+   * @return
+   */
+  v_int64 getDroppedCount() const;
+
+  /**
+   * Get statistics of the connections. All listeners share the same statistics.
+   * @return - &id:oatpp::libressl::ConnectionStatistics;.
+   */
+  std::shared_ptr<ConnectionStatistics> getStatistics() const;
+
+};
+
+}}}
+
+#endif /* oatpp_libressl_server_MultiListenerConnectionProvider_hpp */
@@ -0,0 +1,228 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "OcspStapleRefresher.hpp"
+
+#include <openssl/err.h>
+#include <openssl/ocsp.h>
+
+namespace oatpp { namespace libressl { namespace server {
+
+OcspStapleRefresher::OcspStapleRefresher(const std::shared_ptr<ConnectionProvider>& provider,
+                                         const ConnectionProvider::ConfigFactory& configFactory,
+                                         const StapleSource& source,
+                                         const std::chrono::duration<v_int64, std::micro>& refreshInterval,
+                                         const std::chrono::duration<v_int64, std::micro>& retryInterval)
+  : m_provider(provider)
+  , m_configFactory(configFactory)
+  , m_source(source)
+  , m_refreshInterval(refreshInterval)
+  , m_retryInterval(retryInterval)
+  , m_refreshesCount(0)
+  , m_failuresCount(0)
+  , m_running(false)
+  , m_lastRefreshFailed(false)
+{}
+
+OcspStapleRefresher::~OcspStapleRefresher() {
+  stop();
+}
+
+OcspStapleRefresher::StapleSource OcspStapleRefresher::createFileSource(const oatpp::String& filename) {
+  return [filename]() {
+    return oatpp::String::loadFromFile(filename->c_str());
+  };
+}
+
+v_int64 OcspStapleRefresher::getSecondsToNextUpdate(const oatpp::String& staple) {
+
+  if(!staple) {
+    return -1;
+  }
+
+  const unsigned char* data = (const unsigned char*) staple->data();
+  OCSP_RESPONSE* response = d2i_OCSP_RESPONSE(nullptr, &data, (long) staple->size());
+  if(response == nullptr) {
+    ERR_clear_error();
+    return -1;
+  }
+
+  v_int64 result = -1;
+
+  OCSP_BASICRESP* basic = nullptr;
+  if(OCSP_response_status(response) == OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+    basic = OCSP_response_get1_basic(response);
+  }
+
+  if(basic != nullptr && OCSP_resp_count(basic) > 0) {
+    ASN1_GENERALIZEDTIME* nextUpdate = nullptr;
+    OCSP_single_get0_status(OCSP_resp_get0(basic, 0), nullptr, nullptr, nullptr, &nextUpdate);
+    int days, seconds;
+    if(nextUpdate != nullptr && ASN1_TIME_diff(&days, &seconds, nullptr, nextUpdate) == 1) {
+      result = (v_int64) days * 24 * 3600 + seconds;
+    }
+  }
+
+  if(basic != nullptr) {
+    OCSP_BASICRESP_free(basic);
+  }
+  OCSP_RESPONSE_free(response);
+  ERR_clear_error();
+
+  return result;
+
+}
+
+bool OcspStapleRefresher::refresh() {
+
+  oatpp::String staple;
+  try {
+    staple = m_source();
+  } catch (std::runtime_error& e) {
+    OATPP_LOGE("[oatpp::libressl::server::OcspStapleRefresher::refresh()]", "Error. Staple source failed. %s", e.what());
+  }
+
+  if(!staple || staple->empty()) {
+    m_failuresCount ++;
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_staple && *m_staple == *staple) {
+      return true;
+    }
+  }
+
+  try {
+    auto config = m_configFactory();
+    config->setOcspStaple(staple);
+    m_provider->reloadConfig(config);
+  } catch (std::runtime_error& e) {
+    m_failuresCount ++;
+    OATPP_LOGE("[oatpp::libressl::server::OcspStapleRefresher::refresh()]", "Error. Can't install staple. %s", e.what());
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_staple = staple;
+  }
+
+  m_refreshesCount ++;
+  return true;
+
+}
+
+std::chrono::duration<v_int64, std::micro> OcspStapleRefresher::getNextRefreshDelay() {
+
+  if(m_lastRefreshFailed) {
+    return m_retryInterval;
+  }
+
+  auto secondsLeft = getSecondsToNextUpdate(getStaple());
+  if(secondsLeft < 0) {
+    return m_refreshInterval;
+  }
+
+  /* refresh at half of the remaining validity - leaves time for retries before the staple expires */
+  std::chrono::duration<v_int64, std::micro> delay = std::chrono::seconds(secondsLeft / 2);
+  if(delay > m_refreshInterval) {
+    delay = m_refreshInterval;
+  }
+  if(delay < m_retryInterval) {
+    delay = m_retryInterval;
+  }
+
+  return delay;
+
+}
+
+void OcspStapleRefresher::start() {
+
+  stop();
+
+  m_lastRefreshFailed = !refresh();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = true;
+  }
+
+  m_thread = std::thread([this] {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(m_running) {
+
+      lock.unlock();
+      auto deadline = std::chrono::steady_clock::now() + getNextRefreshDelay();
+      lock.lock();
+
+      while(m_running && std::chrono::steady_clock::now() < deadline) {
+        m_condition.wait_until(lock, deadline);
+      }
+
+      if(m_running) {
+        lock.unlock();
+        m_lastRefreshFailed = !refresh();
+        lock.lock();
+      }
+
+    }
+
+  });
+
+}
+
+void OcspStapleRefresher::stop() {
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+
+  m_condition.notify_all();
+
+  if(m_thread.joinable()) {
+    m_thread.join();
+  }
+
+}
+
+oatpp::String OcspStapleRefresher::getStaple() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_staple;
+}
+
+v_int64 OcspStapleRefresher::getRefreshesCount() const {
+  return m_refreshesCount;
+}
+
+v_int64 OcspStapleRefresher::getFailuresCount() const {
+  return m_failuresCount;
+}
+
+}}}
@@ -0,0 +1,149 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_server_OcspStapleRefresher_hpp
+#define oatpp_libressl_server_OcspStapleRefresher_hpp
+
+#include "ConnectionProvider.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace oatpp { namespace libressl { namespace server {
+
+/**
+ * Keeps the OCSP staple of the &id:oatpp::libressl::server::ConnectionProvider; fresh. <br>
+ * Periodically gets the OCSP response from the source, and when it changes, creates a new config with the
+ * `ConfigFactory`, sets the staple, and installs it with &id:oatpp::libressl::server::ConnectionProvider::reloadConfig; -
+ * new connections get the new staple, established connections are not affected. <br>
+ * Refresh is scheduled at half of the remaining validity of the current staple (`nextUpdate`),
+ * but not later than the refresh interval. <br>
+ * *Note: config factory must set the same session ticket keys and session ID context on every call
+ * if session resumption has to survive refreshes.*
+ */
+class OcspStapleRefresher {
+public:
+
+  /**
+   * Source of the DER-encoded OCSP response. Returns `nullptr` if the response is not available.
+   */
+  typedef std::function<oatpp::String()> StapleSource;
+
+private:
+  std::shared_ptr<ConnectionProvider> m_provider;
+  ConnectionProvider::ConfigFactory m_configFactory;
+  StapleSource m_source;
+  std::chrono::duration<v_int64, std::micro> m_refreshInterval;
+  std::chrono::duration<v_int64, std::micro> m_retryInterval;
+private:
+  oatpp::String m_staple;
+  std::atomic<v_int64> m_refreshesCount;
+  std::atomic<v_int64> m_failuresCount;
+private:
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_running;
+  bool m_lastRefreshFailed;
+private:
+  std::chrono::duration<v_int64, std::micro> getNextRefreshDelay();
+public:
+
+  /**
+   * Constructor.
+   * @param provider - &id:oatpp::libressl::server::ConnectionProvider; to install staples to.
+   * @param configFactory - creates server config without the staple.
+   * @param source - &l:OcspStapleRefresher::StapleSource;.
+   * @param refreshInterval - max time between refreshes.
+   * @param retryInterval - time before the next attempt after a failed refresh.
+   */
+  OcspStapleRefresher(const std::shared_ptr<ConnectionProvider>& provider,
+                      const ConnectionProvider::ConfigFactory& configFactory,
+                      const StapleSource& source,
+                      const std::chrono::duration<v_int64, std::micro>& refreshInterval = std::chrono::hours(1),
+                      const std::chrono::duration<v_int64, std::micro>& retryInterval = std::chrono::minutes(1));
+
+  /**
+   * Non-virtual destructor. Calls &l:OcspStapleRefresher::stop ();.
+   */
+  ~OcspStapleRefresher();
+
+  /**
+   * Create source which reads the OCSP response from file - for responses fetched by an external tool.
+   * @param filename - path to the DER-encoded OCSP response.
+   * @return - &l:OcspStapleRefresher::StapleSource;.
+   */
+  static StapleSource createFileSource(const oatpp::String& filename);
+
+  /**
+   * Get seconds until `nextUpdate` of the OCSP response.
+   * @param staple - DER-encoded OCSP response.
+   * @return - seconds. Negative if the response is expired or can't be parsed.
+   */
+  static v_int64 getSecondsToNextUpdate(const oatpp::String& staple);
+
+  /**
+   * Get the staple from the source and install it if it has changed.
+   * @return - `true` if the staple is current - installed now or unchanged. `false` on failure.
+   */
+  bool refresh();
+
+  /**
+   * Refresh now and start refreshing on a separate thread.
+   */
+  void start();
+
+  /**
+   * Stop refreshing.
+   */
+  void stop();
+
+  /**
+   * Get current staple.
+   * @return - DER-encoded OCSP response. `nullptr` if none was installed yet.
+   */
+  oatpp::String getStaple();
+
+  /**
+   * Get number of installed staples.
+   * @return
+   */
+  v_int64 getRefreshesCount() const;
+
+  /**
+   * Get number of failed refreshes.
+   * @return
+   */
+  v_int64 getFailuresCount() const;
+
+};
+
+}}}
+
+#endif /* oatpp_libressl_server_OcspStapleRefresher_hpp */
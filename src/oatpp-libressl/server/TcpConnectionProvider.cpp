@@ -0,0 +1,344 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "TcpConnectionProvider.hpp"
+
+#include "oatpp/network/tcp/Connection.hpp"
+#include "oatpp/core/utils/ConversionUtils.hpp"
+
+#include <cstring>
+
+#if !(defined(WIN32) || defined(_WIN32))
+  #include <arpa/inet.h>
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <netdb.h>
+  #include <poll.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+  #include <netinet/in.h>
+#endif
+
+namespace oatpp { namespace libressl { namespace server {
+
+namespace {
+
+/*
+ * Poll timeout of the listening socket in get() - how fast a blocked get() notices stop().
+ */
+constexpr int ACCEPT_POLL_TIMEOUT_MS = 100;
+
+/*
+ * tcp::Connection with the peer address in its context properties.
+ */
+class ExtendedConnection : public oatpp::network::tcp::Connection {
+private:
+  data::stream::DefaultInitializedContext m_context;
+public:
+
+  ExtendedConnection(v_int32 handle, data::stream::Context::Properties&& properties)
+    : oatpp::network::tcp::Connection(handle)
+    , m_context(data::stream::StreamType::STREAM_INFINITE, std::move(properties))
+  {}
+
+  oatpp::data::stream::Context& getOutputStreamContext() override {
+    return m_context;
+  }
+
+  oatpp::data::stream::Context& getInputStreamContext() override {
+    return m_context;
+  }
+
+};
+
+}
+
+const char* const TcpConnectionProvider::PROPERTY_PEER_ADDRESS = "peer_address";
+const char* const TcpConnectionProvider::PROPERTY_PEER_ADDRESS_FORMAT = "peer_address_format";
+const char* const TcpConnectionProvider::PROPERTY_PEER_PORT = "peer_port";
+
+void TcpConnectionProvider::ConnectionInvalidator::invalidate(const std::shared_ptr<data::stream::IOStream>& connection) {
+#if !(defined(WIN32) || defined(_WIN32))
+  auto c = std::static_pointer_cast<oatpp::network::tcp::Connection>(connection);
+  ::shutdown(c->getHandle(), SHUT_RDWR);
+#else
+  (void) connection;
+#endif
+}
+
+TcpConnectionProvider::Listener::~Listener() {
+#if !(defined(WIN32) || defined(_WIN32))
+  if(handle >= 0) {
+    ::close(handle);
+  }
+#endif
+}
+
+TcpConnectionProvider::TcpConnectionProvider(const network::Address& address, bool useExtendedConnections, bool reusePort)
+  : m_invalidator(std::make_shared<ConnectionInvalidator>())
+  , m_listener(std::make_shared<Listener>())
+  , m_useExtendedConnections(useExtendedConnections)
+  , m_port(0)
+{
+
+  m_listener->handle = -1;
+  m_listener->closed = false;
+
+#if !(defined(WIN32) || defined(_WIN32))
+
+#if !defined(SO_REUSEPORT)
+  if(reusePort) {
+    throw std::runtime_error("[oatpp::libressl::server::TcpConnectionProvider::TcpConnectionProvider()]: Error. SO_REUSEPORT is not supported on this platform.");
+  }
+#endif
+
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  switch(address.family) {
+    case network::Address::IP_4: hints.ai_family = AF_INET; break;
+    case network::Address::IP_6: hints.ai_family = AF_INET6; break;
+    default: hints.ai_family = AF_UNSPEC;
+  }
+
+  auto portStr = oatpp::utils::conversion::int32ToStr(address.port);
+
+  struct addrinfo* result = nullptr;
+  if(getaddrinfo(address.host->c_str(), portStr->c_str(), &hints, &result) != 0 || result == nullptr) {
+    throw std::runtime_error("[oatpp::libressl::server::TcpConnectionProvider::TcpConnectionProvider()]: Error. Can't resolve address.");
+  }
+
+  v_int32 handle = -1;
+
+  for(struct addrinfo* current = result; current != nullptr; current = current->ai_next) {
+
+    handle = ::socket(current->ai_family, current->ai_socktype, current->ai_protocol);
+    if(handle < 0) {
+      continue;
+    }
+
+    int yes = 1;
+    bool configured = setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == 0;
+#if defined(SO_REUSEPORT)
+    if(configured && reusePort) {
+      configured = setsockopt(handle, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == 0;
+    }
+#endif
+
+    if(configured && ::bind(handle, current->ai_addr, current->ai_addrlen) == 0 && ::listen(handle, SOMAXCONN) == 0) {
+      break;
+    }
+
+    ::close(handle);
+    handle = -1;
+
+  }
+
+  freeaddrinfo(result);
+
+  if(handle < 0) {
+    throw std::runtime_error("[oatpp::libressl::server::TcpConnectionProvider::TcpConnectionProvider()]: Error. Can't bind address.");
+  }
+
+  /* accept never blocks - get() polls, getAsync() waits on the I/O event worker */
+  fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) | O_NONBLOCK);
+  m_listener->handle = handle;
+
+  struct sockaddr_storage boundAddress;
+  socklen_t boundAddressSize = sizeof(boundAddress);
+  if(getsockname(handle, (struct sockaddr*) &boundAddress, &boundAddressSize) == 0) {
+    if(boundAddress.ss_family == AF_INET) {
+      m_port = ntohs(((struct sockaddr_in*) &boundAddress)->sin_port);
+    } else if(boundAddress.ss_family == AF_INET6) {
+      m_port = ntohs(((struct sockaddr_in6*) &boundAddress)->sin6_port);
+    }
+  }
+
+  setProperty(PROPERTY_HOST, address.host);
+  setProperty(PROPERTY_PORT, oatpp::utils::conversion::int32ToStr(m_port));
+
+#else
+  (void) address;
+  (void) reusePort;
+  throw std::runtime_error("[oatpp::libressl::server::TcpConnectionProvider::TcpConnectionProvider()]: Error. Not supported on this platform.");
+#endif
+
+}
+
+std::shared_ptr<TcpConnectionProvider> TcpConnectionProvider::createShared(const network::Address& address,
+                                                                           bool useExtendedConnections,
+                                                                           bool reusePort)
+{
+  return std::make_shared<TcpConnectionProvider>(address, useExtendedConnections, reusePort);
+}
+
+TcpConnectionProvider::~TcpConnectionProvider() {
+  stop();
+}
+
+v_uint16 TcpConnectionProvider::getPort() const {
+  return m_port;
+}
+
+void TcpConnectionProvider::stop() {
+  if(!m_listener->closed.exchange(true)) {
+#if !(defined(WIN32) || defined(_WIN32))
+    /* wakes up accept coroutines waiting on the I/O event worker - they see the provider closed */
+    ::shutdown(m_listener->handle, SHUT_RDWR);
+#endif
+  }
+}
+
+provider::ResourceHandle<data::stream::IOStream> TcpConnectionProvider::accept(const std::shared_ptr<Listener>& listener,
+                                                                              const std::shared_ptr<ConnectionInvalidator>& invalidator,
+                                                                              bool useExtendedConnections)
+{
+
+#if !(defined(WIN32) || defined(_WIN32))
+
+  struct sockaddr_storage peerAddress;
+  socklen_t peerAddressSize = sizeof(peerAddress);
+
+  v_int32 handle = ::accept(listener->handle, (struct sockaddr*) &peerAddress, &peerAddressSize);
+  if(handle < 0) {
+    return nullptr;
+  }
+
+  /* accepted socket may inherit O_NONBLOCK of the listener - connection starts in blocking mode */
+  fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) & ~O_NONBLOCK);
+
+#ifdef SO_NOSIGPIPE
+  int yes = 1;
+  setsockopt(handle, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+
+  if(!useExtendedConnections) {
+    return provider::ResourceHandle<data::stream::IOStream>(std::make_shared<oatpp::network::tcp::Connection>(handle), invalidator);
+  }
+
+  data::stream::Context::Properties properties;
+  char address[INET6_ADDRSTRLEN];
+
+  if(peerAddress.ss_family == AF_INET) {
+    auto addressIn = (struct sockaddr_in*) &peerAddress;
+    inet_ntop(AF_INET, &addressIn->sin_addr, address, sizeof(address));
+    properties.put(PROPERTY_PEER_ADDRESS, oatpp::String(address));
+    properties.put(PROPERTY_PEER_ADDRESS_FORMAT, "ipv4");
+    properties.put(PROPERTY_PEER_PORT, oatpp::utils::conversion::int32ToStr(ntohs(addressIn->sin_port)));
+  } else if(peerAddress.ss_family == AF_INET6) {
+    auto addressIn6 = (struct sockaddr_in6*) &peerAddress;
+    inet_ntop(AF_INET6, &addressIn6->sin6_addr, address, sizeof(address));
+    properties.put(PROPERTY_PEER_ADDRESS, oatpp::String(address));
+    properties.put(PROPERTY_PEER_ADDRESS_FORMAT, "ipv6");
+    properties.put(PROPERTY_PEER_PORT, oatpp::utils::conversion::int32ToStr(ntohs(addressIn6->sin6_port)));
+  }
+
+  return provider::ResourceHandle<data::stream::IOStream>(std::make_shared<ExtendedConnection>(handle, std::move(properties)), invalidator);
+
+#else
+  (void) listener;
+  (void) invalidator;
+  (void) useExtendedConnections;
+  return nullptr;
+#endif
+
+}
+
+provider::ResourceHandle<data::stream::IOStream> TcpConnectionProvider::get() {
+
+#if !(defined(WIN32) || defined(_WIN32))
+
+  while(!m_listener->closed) {
+
+    struct pollfd pfd;
+    pfd.fd = m_listener->handle;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if(::poll(&pfd, 1, ACCEPT_POLL_TIMEOUT_MS) <= 0 || m_listener->closed) {
+      continue;
+    }
+
+    auto connection = accept(m_listener, m_invalidator, m_useExtendedConnections);
+    if(connection) {
+      return connection;
+    }
+
+  }
+
+#endif
+
+  return nullptr;
+
+}
+
+oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> TcpConnectionProvider::getAsync() {
+
+  class AcceptCoroutine : public async::CoroutineWithResult<AcceptCoroutine, const provider::ResourceHandle<data::stream::IOStream>&> {
+  private:
+    std::shared_ptr<Listener> m_listener;
+    std::shared_ptr<ConnectionInvalidator> m_invalidator;
+    bool m_useExtendedConnections;
+  public:
+
+    AcceptCoroutine(const std::shared_ptr<Listener>& listener,
+                    const std::shared_ptr<ConnectionInvalidator>& invalidator,
+                    bool useExtendedConnections)
+      : m_listener(listener)
+      , m_invalidator(invalidator)
+      , m_useExtendedConnections(useExtendedConnections)
+    {}
+
+    Action act() override {
+
+      if(m_listener->closed) {
+        return _return(nullptr);
+      }
+
+      auto connection = accept(m_listener, m_invalidator, m_useExtendedConnections);
+      if(connection) {
+        return _return(connection);
+      }
+
+#if !(defined(WIN32) || defined(_WIN32))
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+        /* no pending connection - wait for the listening socket on the I/O event worker */
+        return Action::createIORepeatAction(m_listener->handle, Action::IOEventType::IO_EVENT_READ);
+      }
+#endif
+
+      return error<Error>("[oatpp::libressl::server::TcpConnectionProvider::getAsync()]: Error. Accept failed.");
+
+    }
+
+  };
+
+  return AcceptCoroutine::startForResult(m_listener, m_invalidator, m_useExtendedConnections);
+
+}
+
+}}}
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_libressl_server_TcpConnectionProvider_hpp
+#define oatpp_libressl_server_TcpConnectionProvider_hpp
+
+#include "oatpp/network/Address.hpp"
+#include "oatpp/network/ConnectionProvider.hpp"
+
+#include <atomic>
+
+namespace oatpp { namespace libressl { namespace server {
+
+/**
+ * TCP server connection provider with asynchronous accept. <br>
+ * Listening socket is non-blocking: &l:TcpConnectionProvider::getAsync (); waits for incoming connections
+ * on the I/O event worker of the executor - no thread is blocked in `accept`. &l:TcpConnectionProvider::get (); polls
+ * the socket and returns when a connection is accepted or the provider is stopped. <br>
+ * Used as the transport of &id:oatpp::libressl::server::ConnectionProvider::createShared; with an address. <br>
+ * *POSIX only.*
+ * Extends &id:oatpp::base::Countable;, &id:oatpp::network::ServerConnectionProvider;.
+ */
+class TcpConnectionProvider : public oatpp::network::ServerConnectionProvider {
+public:
+
+  /**
+   * Peer address - connection property of the extended connections.
+   */
+  static const char* const PROPERTY_PEER_ADDRESS;
+
+  /**
+   * Format of the peer address - `ipv4` or `ipv6`. Connection property of the extended connections.
+   */
+  static const char* const PROPERTY_PEER_ADDRESS_FORMAT;
+
+  /**
+   * Peer port - connection property of the extended connections.
+   */
+  static const char* const PROPERTY_PEER_PORT;
+
+private:
+
+  class ConnectionInvalidator : public provider::Invalidator<data::stream::IOStream> {
+  public:
+    void invalidate(const std::shared_ptr<data::stream::IOStream>& connection) override;
+  };
+
+  /*
+   * Listening socket. Shared with accept coroutines - it's closed when the last of them is done.
+   */
+  struct Listener {
+    v_int32 handle;
+    std::atomic<bool> closed;
+    ~Listener();
+  };
+
+private:
+  static provider::ResourceHandle<data::stream::IOStream> accept(const std::shared_ptr<Listener>& listener,
+                                                                 const std::shared_ptr<ConnectionInvalidator>& invalidator,
+                                                                 bool useExtendedConnections);
+private:
+  std::shared_ptr<ConnectionInvalidator> m_invalidator;
+  std::shared_ptr<Listener> m_listener;
+  bool m_useExtendedConnections;
+  v_uint16 m_port;
+public:
+
+  /**
+   * Constructor. Binds and listens the address.
+   * @param address - &id:oatpp::network::Address;. If port is `0` - the port is chosen by the system,
+   * see &l:TcpConnectionProvider::getPort ();.
+   * @param useExtendedConnections - `true` to add peer address properties to the connection contexts.
+   * @param reusePort - `true` to bind with `SO_REUSEPORT`, so that several providers listen the same port.
+   * @throws - `std::runtime_error` if the address can't be bound.
+   */
+  TcpConnectionProvider(const network::Address& address, bool useExtendedConnections = false, bool reusePort = false);
+
+public:
+
+  /**
+   * Create shared TcpConnectionProvider.
+   * @param address - &id:oatpp::network::Address;.
+   * @param useExtendedConnections - `true` to add peer address properties to the connection contexts.
+   * @param reusePort - `true` to bind with `SO_REUSEPORT`.
+   * @return - `std::shared_ptr` to TcpConnectionProvider.
+   */
+  static std::shared_ptr<TcpConnectionProvider> createShared(const network::Address& address,
+                                                             bool useExtendedConnections = false,
+                                                             bool reusePort = false);
+
+  /**
+   * Virtual destructor.
+   */
+  ~TcpConnectionProvider();
+
+  /**
+   * Get the bound port.
+   * @return
+   */
+  v_uint16 getPort() const;
+
+  /**
+   * Stop accepting. Pending `get()` and `getAsync()` return `nullptr`.
+   */
+  void stop() override;
+
+  /**
+   * Get incoming connection. Blocks until a connection is accepted or the provider is stopped.
+   * @return &id:oatpp::data::stream::IOStream;. `nullptr` if the provider is stopped.
+   */
+  provider::ResourceHandle<data::stream::IOStream> get() override;
+
+  /**
+   * Get incoming connection in asynchronous manner. Coroutine waits for the listening socket on the I/O event worker.
+   * @return - &id:oatpp::async::CoroutineStarterForResult;. Result is `nullptr` if the provider is stopped.
+   */
+  oatpp::async::CoroutineStarterForResult<const provider::ResourceHandle<data::stream::IOStream>&> getAsync() override;
+
+};
+
+}}}
+
+#endif /* oatpp_libressl_server_TcpConnectionProvider_hpp */
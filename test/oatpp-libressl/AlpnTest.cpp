@@ -0,0 +1,135 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "AlpnTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+oatpp::String getProperty(const oatpp::data::stream::Context& context, const char* key) {
+  auto value = context.getProperties().get(key);
+  if(value == nullptr) {
+    return nullptr;
+  }
+  return value.toString();
+}
+
+struct NegotiatedProtocols {
+  oatpp::String client;
+  oatpp::String server;
+};
+
+NegotiatedProtocols negotiate(const oatpp::String& serverAlpn, const oatpp::String& clientAlpn) {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-alpn");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  if(serverAlpn) {
+    serverConfig->setAlpn(serverAlpn);
+  }
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  if(clientAlpn) {
+    clientConfig->setAlpn(clientAlpn);
+  }
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  NegotiatedProtocols result;
+  result.client = getProperty(clientConnection.object->getInputStreamContext(), "tls_alpn");
+  result.server = getProperty(serverConnection.object->getInputStreamContext(), "tls_alpn");
+
+  /* output context carries the same properties */
+  OATPP_ASSERT(getProperty(serverConnection.object->getOutputStreamContext(), "tls_alpn") == result.server);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+  return result;
+
+}
+
+}
+
+void AlpnTest::onRun() {
+
+  { // server preference wins
+    auto protocols = negotiate("h2,http/1.1", "http/1.1,h2");
+    OATPP_ASSERT(protocols.client == "h2");
+    OATPP_ASSERT(protocols.server == "h2");
+  }
+
+  { // only the common protocol
+    auto protocols = negotiate("h2,http/1.1", "http/1.1");
+    OATPP_ASSERT(protocols.client == "http/1.1");
+    OATPP_ASSERT(protocols.server == "http/1.1");
+  }
+
+  { // client doesn't offer ALPN
+    auto protocols = negotiate("h2,http/1.1", nullptr);
+    OATPP_ASSERT(!protocols.client);
+    OATPP_ASSERT(!protocols.server);
+  }
+
+  { // server doesn't support ALPN
+    auto protocols = negotiate(nullptr, "h2");
+    OATPP_ASSERT(!protocols.client);
+    OATPP_ASSERT(!protocols.server);
+  }
+
+}
+
+}}}
@@ -0,0 +1,326 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "AsyncAcceptTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+#include "oatpp/network/tcp/client/ConnectionProvider.hpp"
+#include "oatpp/network/tcp/server/ConnectionProvider.hpp"
+#include "oatpp/core/utils/ConversionUtils.hpp"
+
+#include "oatpp/core/async/Executor.hpp"
+
+#include <atomic>
+#include <cstring>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+const char* const MESSAGE = "Hello from the TLS client. This message is echoed back by the coroutine-based server.";
+
+v_buff_size messageSize() {
+  return (v_buff_size) std::strlen(MESSAGE);
+}
+
+class ServerSessionCoroutine : public oatpp::async::Coroutine<ServerSessionCoroutine> {
+private:
+  std::shared_ptr<oatpp::network::ServerConnectionProvider> m_provider;
+  std::atomic<v_int32>* m_counter;
+  StreamHandle m_connection;
+  v_char8 m_buffer[256];
+  v_buff_size m_progress;
+public:
+
+  ServerSessionCoroutine(const std::shared_ptr<oatpp::network::ServerConnectionProvider>& provider, std::atomic<v_int32>* counter)
+    : m_provider(provider)
+    , m_counter(counter)
+    , m_progress(0)
+  {}
+
+  Action act() override {
+    return m_provider->getAsync().callbackTo(&ServerSessionCoroutine::onConnection);
+  }
+
+  Action onConnection(const StreamHandle& connection) {
+    if(!connection) {
+      return error<Error>("[ServerSessionCoroutine::onConnection()]: Error. No connection.");
+    }
+    m_connection = connection;
+    return m_connection.object->initContextsAsync().next(yieldTo(&ServerSessionCoroutine::readMessage));
+  }
+
+  Action readMessage() {
+
+    if(m_progress >= messageSize()) {
+      m_progress = 0;
+      return yieldTo(&ServerSessionCoroutine::writeMessage);
+    }
+
+    async::Action action;
+    auto res = m_connection.object->read(m_buffer + m_progress, messageSize() - m_progress, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      m_progress += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[ServerSessionCoroutine::readMessage()]: Error. Read failed.");
+
+  }
+
+  Action writeMessage() {
+
+    if(m_progress >= messageSize()) {
+      (*m_counter) ++;
+      return finish();
+    }
+
+    async::Action action;
+    auto res = m_connection.object->write(m_buffer + m_progress, messageSize() - m_progress, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      m_progress += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[ServerSessionCoroutine::writeMessage()]: Error. Write failed.");
+
+  }
+
+};
+
+class ClientSessionCoroutine : public oatpp::async::Coroutine<ClientSessionCoroutine> {
+private:
+  std::shared_ptr<oatpp::network::ClientConnectionProvider> m_provider;
+  std::atomic<v_int32>* m_counter;
+  StreamHandle m_connection;
+  v_char8 m_buffer[256];
+  v_buff_size m_progress;
+public:
+
+  ClientSessionCoroutine(const std::shared_ptr<oatpp::network::ClientConnectionProvider>& provider, std::atomic<v_int32>* counter)
+    : m_provider(provider)
+    , m_counter(counter)
+    , m_progress(0)
+  {}
+
+  Action act() override {
+    return m_provider->getAsync().callbackTo(&ClientSessionCoroutine::onConnected);
+  }
+
+  Action onConnected(const StreamHandle& connection) {
+    m_connection = connection;
+    return yieldTo(&ClientSessionCoroutine::writeMessage);
+  }
+
+  Action writeMessage() {
+
+    if(m_progress >= messageSize()) {
+      m_progress = 0;
+      return yieldTo(&ClientSessionCoroutine::readEcho);
+    }
+
+    async::Action action;
+    auto res = m_connection.object->write(MESSAGE + m_progress, messageSize() - m_progress, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      m_progress += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[ClientSessionCoroutine::writeMessage()]: Error. Write failed.");
+
+  }
+
+  Action readEcho() {
+
+    if(m_progress >= messageSize()) {
+      if(std::memcmp(m_buffer, MESSAGE, messageSize()) != 0) {
+        return error<Error>("[ClientSessionCoroutine::readEcho()]: Error. Echo doesn't match.");
+      }
+      (*m_counter) ++;
+      return finish();
+    }
+
+    async::Action action;
+    auto res = m_connection.object->read(m_buffer + m_progress, messageSize() - m_progress, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      m_progress += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[ClientSessionCoroutine::readEcho()]: Error. Read failed.");
+
+  }
+
+};
+
+/* echo sessions - server accepts with getAsync() */
+void runSessions(const std::shared_ptr<oatpp::network::ServerConnectionProvider>& serverProvider,
+                 const std::shared_ptr<oatpp::network::ClientConnectionProvider>& clientProvider,
+                 v_int32 threads, v_int32 connections, const char* tag)
+{
+
+  std::atomic<v_int32> serverSessions(0);
+  std::atomic<v_int32> clientSessions(0);
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+
+  {
+
+    oatpp::async::Executor executor(threads, 1, 1);
+
+    for(v_int32 i = 0; i < connections; i ++) {
+      executor.execute<ServerSessionCoroutine>(serverProvider, &serverSessions);
+      executor.execute<ClientSessionCoroutine>(clientProvider, &clientSessions);
+    }
+
+    executor.waitTasksFinished(std::chrono::minutes(5));
+    executor.stop();
+    executor.join();
+
+  }
+
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+  OATPP_LOGD(tag, "threads=%d, connections=%d, time=%lld(micro)", threads, connections, (long long) ticks);
+
+  OATPP_ASSERT(serverSessions == connections);
+  OATPP_ASSERT(clientSessions == connections);
+
+}
+
+}
+
+void AsyncAcceptTest::onRun() {
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+
+  { // virtual interface
+
+    auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-async-accept");
+
+    auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+      serverConfig,
+      oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+    );
+
+    auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+      clientConfig,
+      oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+    );
+
+    runSessions(serverProvider, clientProvider, m_threads, m_connections, "AsyncAcceptTest[virtual]");
+
+    serverProvider->stop();
+
+  }
+
+  { // tcp listener created with an address - accept waits on the I/O event worker
+
+    auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+      serverConfig,
+      oatpp::network::Address("localhost", 0, oatpp::network::Address::IP_4)
+    );
+
+    auto port = serverProvider->getProperty(oatpp::network::ConnectionProvider::PROPERTY_PORT).toString();
+    OATPP_ASSERT(port && oatpp::utils::conversion::strToInt32(port->c_str()) > 0);
+
+    auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+      clientConfig,
+      oatpp::network::tcp::client::ConnectionProvider::createShared(
+        oatpp::network::Address("localhost", (v_uint16) oatpp::utils::conversion::strToInt32(port->c_str()), oatpp::network::Address::IP_4)
+      )
+    );
+
+    runSessions(serverProvider, clientProvider, m_threads, m_connections, "AsyncAcceptTest[tcp]");
+
+    serverProvider->stop();
+
+  }
+
+  { // oatpp tcp provider has no async accept - getAsync() fails right away with a clear error
+
+    auto tcpProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+      serverConfig,
+      oatpp::network::tcp::server::ConnectionProvider::createShared(oatpp::network::Address("localhost", 0, oatpp::network::Address::IP_4))
+    );
+
+    bool thrown = false;
+    try {
+      tcpProvider->getAsync();
+    } catch (std::runtime_error& e) {
+      thrown = std::strstr(e.what(), "[oatpp::libressl::server::ConnectionProvider::getAsync()]") != nullptr;
+    }
+    OATPP_ASSERT(thrown);
+
+    tcpProvider->stop();
+
+  }
+
+}
+
+}}}
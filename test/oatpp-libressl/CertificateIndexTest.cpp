@@ -0,0 +1,169 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "CertificateIndexTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+/* connect to the virtual interface - SNI is the interface name */
+bool connect(const std::shared_ptr<oatpp::libressl::Config>& serverConfig, const oatpp::String& host) {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared(host);
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection;
+  try {
+    clientConnection = clientProvider->get();
+  } catch (std::runtime_error& e) {
+    OATPP_LOGD("CertificateIndexTest", "connect failed: %s", e.what());
+  }
+
+  acceptThread.join();
+
+  if(clientConnection) {
+    clientConnection.invalidator->invalidate(clientConnection.object);
+  }
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+  serverProvider->stop();
+
+  return (bool) clientConnection;
+
+}
+
+v_float64 measureLookup(v_int32 keypairs, v_int32 lookups) {
+
+  oatpp::libressl::CertificateIndex index;
+  std::vector<std::shared_ptr<oatpp::libressl::CertificateIndex::Keypair>> added;
+
+  for(v_int32 i = 0; i < keypairs; i ++) {
+    auto id = std::to_string(i);
+    std::vector<oatpp::String> names = {
+      oatpp::String("host" + id + ".example.com"),
+      oatpp::String("*.tenant" + id + ".example.net")
+    };
+    auto keypair = std::make_shared<oatpp::libressl::CertificateIndex::Keypair>(tls_config_new(), names);
+    index.add(keypair);
+    added.push_back(keypair);
+  }
+
+  OATPP_ASSERT(index.getKeypairsCount() == keypairs);
+
+  /* prepare names first - so that only the lookup is measured */
+  std::vector<std::string> serverNames;
+  for(v_int32 i = 0; i < lookups; i ++) {
+    auto id = std::to_string((i * 7919) % keypairs);
+    if(i % 2 == 0) {
+      serverNames.push_back("HOST" + id + ".example.com");
+    } else {
+      serverNames.push_back("api.tenant" + id + ".example.net");
+    }
+  }
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+  v_int32 found = 0;
+  for(auto& name : serverNames) {
+    if(index.find(name.data(), name.size())) {
+      found ++;
+    }
+  }
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  OATPP_ASSERT(found == lookups);
+
+  auto keypair = index.find("api.tenant1.example.net", 23);
+  OATPP_ASSERT(keypair.get() == added[1].get());
+  OATPP_ASSERT(!index.find("a.b.tenant1.example.net", 23)); // wildcard covers one label only
+  OATPP_ASSERT(!index.find("unknown.example.org", 19));
+
+  return (v_float64) ticks * 1000 / (v_float64) lookups;
+
+}
+
+}
+
+void CertificateIndexTest::onRun() {
+
+  { // names from the certificate
+    auto names = oatpp::libressl::CertificateIndex::getCertificateNames(oatpp::String::loadFromFile(CERT_CRT_PATH));
+    OATPP_ASSERT(names.size() == 1);
+    OATPP_ASSERT(names[0] == "localhost");
+  }
+
+  { // keypair is selected by SNI
+
+    auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+    auto keypair = serverConfig->addCertificateFile(CERT_CRT_PATH, CERT_PEM_PATH, {"virtualhost-sni", "*.sni.test"});
+
+    OATPP_ASSERT(connect(serverConfig, "virtualhost-sni"));
+    OATPP_ASSERT(keypair->getSelectedCount() == 1);
+
+    OATPP_ASSERT(connect(serverConfig, "api.sni.test"));
+    OATPP_ASSERT(keypair->getSelectedCount() == 2);
+
+    OATPP_ASSERT(connect(serverConfig, "virtualhost-sni-default")); // default keypair
+    OATPP_ASSERT(keypair->getSelectedCount() == 2);
+
+  }
+
+  const v_int32 keypairsCounts[] = {100, 1000, 10000};
+
+  for(v_int32 keypairs : keypairsCounts) {
+    auto nanosPerLookup = measureLookup(keypairs, m_lookups);
+    OATPP_LOGD(TAG, "keypairs=%d, lookup=%fns", keypairs, nanosPerLookup);
+  }
+
+}
+
+}}}
@@ -0,0 +1,294 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ClientHelloTest.hpp"
+
+#include "app/TransportProbe.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/CertificateProvider.hpp"
+#include "oatpp-libressl/ConnectionStatistics.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+typedef oatpp::libressl::Connection::HandshakeFailure HandshakeFailure;
+
+const char* const HOST = "virtualhost-client-hello";
+
+/* remembers the requested server name and uses the default keypair */
+class RecordingCertificateProvider : public oatpp::libressl::server::CertificateProvider {
+private:
+  std::mutex m_mutex;
+  std::string m_serverName;
+public:
+
+  std::atomic<v_int64> calls;
+  std::atomic<bool> fail;
+
+  RecordingCertificateProvider()
+    : calls(0)
+    , fail(false)
+  {}
+
+  std::shared_ptr<oatpp::libressl::TLSObject> getServerContext(const char* serverName, v_buff_size size) override {
+    calls ++;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_serverName.assign(serverName, size);
+    }
+    if(fail) {
+      throw std::runtime_error("[oatpp::test::libressl::RecordingCertificateProvider::getServerContext()]: Error. Failure requested.");
+    }
+    return nullptr;
+  }
+
+  std::string getServerName() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_serverName;
+  }
+
+};
+
+struct Server {
+
+  std::shared_ptr<oatpp::network::virtual_::Interface> interface;
+  std::shared_ptr<oatpp::libressl::server::ConnectionProvider> provider;
+  std::shared_ptr<RecordingCertificateProvider> certificateProvider;
+
+  Server()
+    : interface(oatpp::network::virtual_::Interface::obtainShared(HOST))
+    , provider(oatpp::libressl::server::ConnectionProvider::createShared(
+        oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH),
+        oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+      ))
+    , certificateProvider(std::make_shared<RecordingCertificateProvider>())
+  {
+    provider->setCertificateProvider(certificateProvider);
+  }
+
+  ~Server() {
+    provider->stop();
+  }
+
+  v_int64 getFailures(HandshakeFailure reason) {
+    return provider->getStatistics()->getSnapshot().handshakeFailuresByReason[reason];
+  }
+
+  v_int64 getHandshakes() {
+    return provider->getStatistics()->getSnapshot().handshakes;
+  }
+
+};
+
+/* TLS client over the probe transport - the ClientHello record is split into records of `fragmentSize` */
+bool connect(Server& server, v_buff_size fragmentSize, v_int64* fragments) {
+
+  auto probeProvider = std::make_shared<app::ProbeConnectionProvider>(
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(server.interface)
+  );
+  probeProvider->handshakeFragmentSize = fragmentSize;
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    probeProvider
+  );
+
+  StreamHandle serverConnection;
+  bool serverClosed = false;
+
+  std::thread acceptThread([&server, &serverConnection, &serverClosed]{
+    serverConnection = server.provider->get();
+    serverConnection.object->initContexts();
+    auto connection = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+    if(connection->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::FAILED) {
+      /* client is waiting for the server reply */
+      serverConnection.invalidator->invalidate(serverConnection.object);
+      serverClosed = true;
+    }
+  });
+
+  StreamHandle clientConnection;
+  try {
+    clientConnection = clientProvider->get();
+  } catch (std::runtime_error& e) {
+    OATPP_LOGD("ClientHelloTest", "connect failed: %s", e.what());
+  }
+
+  acceptThread.join();
+
+  if(fragments != nullptr) {
+    *fragments = probeProvider->getLastStream()->handshakeFragments;
+  }
+
+  if(clientConnection) {
+    clientConnection.invalidator->invalidate(clientConnection.object);
+  }
+  if(!serverClosed) {
+    serverConnection.invalidator->invalidate(serverConnection.object);
+  }
+
+  return (bool) clientConnection;
+
+}
+
+/* write raw bytes to the server and let it run the handshake on them */
+void sendRaw(Server& server, const std::string& data) {
+
+  auto clientProvider = oatpp::network::virtual_::client::ConnectionProvider::createShared(server.interface);
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&server, &serverConnection]{
+    serverConnection = server.provider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  clientConnection.object->writeExactSizeDataSimple(data.data(), data.size());
+
+  acceptThread.join();
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+}
+
+std::string record(const std::string& payload) {
+  std::string result;
+  result.push_back((char) 22);
+  result.push_back((char) 3);
+  result.push_back((char) 1);
+  result.push_back((char) (payload.size() >> 8));
+  result.push_back((char) (payload.size() & 0xFF));
+  return result + payload;
+}
+
+std::string clientHelloHeader(v_uint32 size) {
+  std::string result;
+  result.push_back((char) 1);
+  result.push_back((char) ((size >> 16) & 0xFF));
+  result.push_back((char) ((size >> 8) & 0xFF));
+  result.push_back((char) (size & 0xFF));
+  return result;
+}
+
+void testFragmented() {
+
+  Server server;
+
+  /* handshake header split between records, then a few larger records */
+  v_buff_size fragmentSizes[] = {3, 100};
+
+  for(v_buff_size fragmentSize : fragmentSizes) {
+    v_int64 fragments = 0;
+    OATPP_ASSERT(connect(server, fragmentSize, &fragments));
+    OATPP_LOGD("ClientHelloTest", "fragment size=%lld, records=%lld", (long long) fragmentSize, (long long) fragments);
+    OATPP_ASSERT(fragments > 1);
+    OATPP_ASSERT(server.certificateProvider->getServerName() == HOST);
+  }
+
+  OATPP_ASSERT(server.certificateProvider->calls == 2);
+  OATPP_ASSERT(server.getHandshakes() == 2);
+
+}
+
+void testMalformed() {
+
+  Server server;
+
+  /* session id length runs past the end of the ClientHello */
+  std::string body = std::string("\x03\x03", 2) + std::string(32, 'r') + std::string("\xFF", 1);
+  sendRaw(server, record(clientHelloHeader(body.size()) + body));
+
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::SERVER_NAME) == 1);
+
+  /* handshake message other than ClientHello */
+  std::string notHello = clientHelloHeader(4);
+  notHello[0] = 2;
+  sendRaw(server, record(notHello + "abcd"));
+
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::SERVER_NAME) == 2);
+
+  /* not TLS at all - libtls reports the error */
+  sendRaw(server, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::SERVER_NAME) == 2);
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::PROTOCOL) == 1);
+
+  OATPP_ASSERT(server.certificateProvider->calls == 0);
+
+}
+
+void testOversized() {
+
+  Server server;
+
+  /* ClientHello never ends - the server gives up after the max size of records */
+  std::string data = record(clientHelloHeader(0xFFFFFF) + std::string(16384 - 4, 'x'));
+  for(v_int32 i = 0; i < 3; i ++) {
+    data += record(std::string(16384, 'x'));
+  }
+  sendRaw(server, data);
+
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::SERVER_NAME) == 1);
+  OATPP_ASSERT(server.certificateProvider->calls == 0);
+
+}
+
+void testProviderFailure() {
+
+  Server server;
+  server.certificateProvider->fail = true;
+
+  OATPP_ASSERT(!connect(server, 0, nullptr));
+
+  OATPP_ASSERT(server.certificateProvider->calls == 1);
+  OATPP_ASSERT(server.getFailures(HandshakeFailure::SERVER_NAME) == 1);
+
+}
+
+}
+
+void ClientHelloTest::onRun() {
+  testFragmented();
+  testMalformed();
+  testOversized();
+  testProviderFailure();
+}
+
+}}}
@@ -0,0 +1,250 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ConfigReloadTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+struct ConnectionPair {
+  StreamHandle client;
+  StreamHandle server;
+};
+
+ConnectionPair connect(const std::shared_ptr<oatpp::libressl::server::ConnectionProvider>& serverProvider,
+                       const std::shared_ptr<oatpp::libressl::client::ConnectionProvider>& clientProvider)
+{
+
+  ConnectionPair pair;
+
+  std::thread acceptThread([&serverProvider, &pair]{
+    pair.server = serverProvider->get();
+    pair.server.object->initContexts();
+  });
+
+  pair.client = clientProvider->get();
+  acceptThread.join();
+
+  return pair;
+
+}
+
+/* client sends a message, server reads it back */
+bool exchange(const ConnectionPair& pair) {
+
+  const char* message = "hello";
+  oatpp::async::Action action;
+  if(pair.client.object->write(message, 5, action) != 5) {
+    return false;
+  }
+
+  char buffer[5];
+  v_buff_size received = 0;
+  while(received < 5) {
+    auto res = pair.server.object->read(buffer + received, 5 - received, action);
+    if(res <= 0) {
+      return false;
+    }
+    received += res;
+  }
+
+  return std::memcmp(buffer, message, 5) == 0;
+
+}
+
+void close(const ConnectionPair& pair) {
+  pair.client.invalidator->invalidate(pair.client.object);
+  pair.server.invalidator->invalidate(pair.server.object);
+}
+
+void copyFile(const char* from, const std::string& to) {
+  auto data = oatpp::String::loadFromFile(from);
+  std::ofstream file(to, std::ios::binary);
+  file.write(data->data(), data->size());
+}
+
+}
+
+void ConfigReloadTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-reload");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  { // explicit reload
+
+    auto established = connect(serverProvider, clientProvider);
+    OATPP_ASSERT(exchange(established));
+
+    auto newConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+    serverProvider->reloadConfig(newConfig);
+
+    OATPP_ASSERT(serverProvider->getConfig() == newConfig);
+    OATPP_ASSERT(serverProvider->getReloadsCount() == 1);
+
+    /* established connection keeps the old context */
+    OATPP_ASSERT(exchange(established));
+
+    auto fresh = connect(serverProvider, clientProvider);
+    OATPP_ASSERT(exchange(fresh));
+
+    close(established);
+    close(fresh);
+
+  }
+
+  { // failed reload keeps the current config
+
+    auto current = serverProvider->getConfig();
+    bool thrown = false;
+    try {
+      serverProvider->reloadConfig(oatpp::libressl::Config::createShared()); // no keypair
+    } catch (std::runtime_error&) {
+      thrown = true;
+    }
+    OATPP_ASSERT(thrown);
+    OATPP_ASSERT(serverProvider->getConfig() == current);
+
+    auto pair = connect(serverProvider, clientProvider);
+    OATPP_ASSERT(exchange(pair));
+    close(pair);
+
+  }
+
+  { // file watch
+
+    char directoryTemplate[] = "/tmp/oatpp-libressl-reload-XXXXXX";
+    OATPP_ASSERT(mkdtemp(directoryTemplate) != nullptr);
+    std::string certFile = std::string(directoryTemplate) + "/cert.crt";
+    std::string keyFile = std::string(directoryTemplate) + "/key.pem";
+
+    copyFile(CERT_CRT_PATH, certFile);
+    copyFile(CERT_PEM_PATH, keyFile);
+
+    /* settings which the reload must keep */
+    auto watchedConfig = oatpp::libressl::Config::createDefaultServerConfigShared(certFile.c_str(), keyFile.c_str());
+    watchedConfig->setProtocols(TLS_PROTOCOL_TLSv1_2);
+    watchedConfig->setReadBufferSize(4096);
+    watchedConfig->setAlpn("http/1.1");
+    watchedConfig->setSessionId("oatpp-libressl-reload");
+    watchedConfig->setSessionLifetime(300);
+    watchedConfig->startTicketKeyRotation(std::chrono::seconds(60));
+    serverProvider->reloadConfig(watchedConfig);
+
+    auto resumingConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+    resumingConfig->setProtocols(TLS_PROTOCOL_TLSv1_2);
+    auto resumingProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+      resumingConfig,
+      oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+    );
+    auto sessionCache = oatpp::libressl::client::SessionCache::createShared();
+    resumingProvider->setSessionCache(sessionCache);
+
+    close(connect(serverProvider, resumingProvider));
+
+    auto reloads = serverProvider->getReloadsCount();
+    serverProvider->startWatching(certFile.c_str(), keyFile.c_str(), std::chrono::milliseconds(20));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    OATPP_ASSERT(serverProvider->getReloadsCount() == reloads); // nothing changed
+
+    /* rewrites follow each other within the same second - each one is a change */
+    for(v_int32 rewrite = 1; rewrite <= 2; rewrite ++) {
+
+      {
+        std::ofstream file(certFile, std::ios::binary | std::ios::app);
+        file << "\n";
+      }
+
+      for(v_int32 i = 0; i < 100 && serverProvider->getReloadsCount() == reloads + rewrite - 1; i ++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      OATPP_ASSERT(serverProvider->getReloadsCount() == reloads + rewrite);
+
+    }
+
+    OATPP_ASSERT(serverProvider->getReloadFailuresCount() == 0);
+
+    serverProvider->stopWatching();
+
+    auto reloadedConfig = serverProvider->getConfig();
+    OATPP_ASSERT(reloadedConfig != watchedConfig);
+
+    /* rotation is handed over - only the config in use rotates, revisions continue */
+    OATPP_ASSERT(!watchedConfig->isTicketKeyRotationRunning());
+    OATPP_ASSERT(reloadedConfig->isTicketKeyRotationRunning());
+    OATPP_ASSERT(reloadedConfig->getTicketKeyRevision() == watchedConfig->getTicketKeyRevision() + 2);
+    OATPP_ASSERT(reloadedConfig->getReadBufferSize() == 4096);
+    OATPP_ASSERT(reloadedConfig->getAlpn() == "http/1.1");
+
+    auto pair = connect(serverProvider, clientProvider);
+    OATPP_ASSERT(exchange(pair));
+    close(pair);
+
+    /* same ticket keys - the session from before the reload is resumed */
+    auto resumed = connect(serverProvider, resumingProvider);
+    OATPP_ASSERT(exchange(resumed));
+    close(resumed);
+    OATPP_ASSERT(sessionCache->getResumedCount() == 1);
+
+    reloadedConfig->stopTicketKeyRotation();
+
+    unlink(certFile.c_str());
+    unlink(keyFile.c_str());
+    rmdir(directoryTemplate);
+
+  }
+
+  serverProvider->stop();
+
+}
+
+}}}
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ConnectionPoolTest.hpp"
+
+#include "oatpp-libressl/client/PoolingConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include "oatpp/core/async/Executor.hpp"
+
+#include <cstring>
+#include <list>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+const char* const MESSAGE = "ping";
+
+/* server closes connection after this number of echoed messages */
+const v_int32 MESSAGES_PER_CONNECTION = 2;
+
+void serveConnection(StreamHandle connection) {
+
+  connection.object->setOutputStreamIOMode(oatpp::data::stream::IOMode::BLOCKING);
+  connection.object->setInputStreamIOMode(oatpp::data::stream::IOMode::BLOCKING);
+  connection.object->initContexts();
+
+  v_char8 buffer[16];
+  const v_buff_size size = (v_buff_size) std::strlen(MESSAGE);
+
+  for(v_int32 i = 0; i < MESSAGES_PER_CONNECTION; i ++) {
+    if(connection.object->readExactSizeDataSimple(buffer, size) != size) {
+      break;
+    }
+    if(connection.object->writeExactSizeDataSimple(buffer, size) != size) {
+      break;
+    }
+  }
+
+  connection.invalidator->invalidate(connection.object);
+
+}
+
+void echo(const StreamHandle& connection) {
+  v_char8 buffer[16];
+  const v_buff_size size = (v_buff_size) std::strlen(MESSAGE);
+  OATPP_ASSERT(connection.object->writeExactSizeDataSimple(MESSAGE, size) == size);
+  OATPP_ASSERT(connection.object->readExactSizeDataSimple(buffer, size) == size);
+  OATPP_ASSERT(std::memcmp(buffer, MESSAGE, size) == 0);
+}
+
+std::shared_ptr<oatpp::libressl::Connection> getConnection(const StreamHandle& handle) {
+  return std::static_pointer_cast<oatpp::libressl::client::PoolingConnectionProvider::PooledConnection>(handle.object)->getConnection();
+}
+
+}
+
+void ConnectionPoolTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-pool");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  std::list<std::thread> sessions;
+
+  std::thread acceptThread([&serverProvider, &sessions]{
+    while(true) {
+      auto connection = serverProvider->get();
+      if(!connection) {
+        break;
+      }
+      sessions.push_back(std::thread(serveConnection, connection));
+    }
+  });
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  {
+
+    auto pool = oatpp::libressl::client::PoolingConnectionProvider::createShared(clientProvider);
+
+    std::shared_ptr<oatpp::libressl::Connection> first;
+
+    { // miss - new connection
+      auto connection = pool->get();
+      first = getConnection(connection);
+      echo(connection);
+    }
+
+    OATPP_ASSERT(pool->getMetrics().idle == 1);
+
+    { // hit - same connection. Server closes it after this message.
+      auto connection = pool->get();
+      OATPP_ASSERT(getConnection(connection) == first);
+      echo(connection);
+    }
+
+    /* let the server close the connection */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    { // dead connection is evicted - miss
+      auto connection = pool->get();
+      OATPP_ASSERT(getConnection(connection) != first);
+      echo(connection);
+    }
+
+    { // invalidated connection doesn't return to the pool
+      auto connection = pool->get();
+      connection.invalidator->invalidate(connection.object);
+    }
+
+    auto metrics = pool->getMetrics();
+    OATPP_LOGD(TAG, "hits=%lld, misses=%lld, evictions=%lld, idle=%lld",
+               (long long) metrics.hits, (long long) metrics.misses, (long long) metrics.evictions, (long long) metrics.idle);
+
+    OATPP_ASSERT(metrics.hits == 2);
+    OATPP_ASSERT(metrics.misses == 2);
+    OATPP_ASSERT(metrics.evictions == 1);
+    OATPP_ASSERT(metrics.idle == 0);
+
+    first.reset();
+    pool->stop();
+
+  }
+
+  { // prewarming
+
+    auto executor = std::make_shared<oatpp::async::Executor>(1, 1, 1);
+
+    oatpp::libressl::client::PoolingConnectionProvider::Options options;
+    options.minIdleConnections = 2;
+    options.prewarmInterval = 10 * 1000;
+
+    auto pool = oatpp::libressl::client::PoolingConnectionProvider::createShared(clientProvider, options);
+    pool->startPrewarming(executor);
+
+    for(v_int32 i = 0; i < 500 && pool->getMetrics().idle < options.minIdleConnections; i ++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    OATPP_ASSERT(pool->getMetrics().idle == options.minIdleConnections);
+
+    { // warm hit - no connect on the request path
+      auto connection = pool->get();
+      echo(connection);
+    }
+
+    auto metrics = pool->getMetrics();
+    OATPP_LOGD(TAG, "warm hits=%lld, cold connects=%lld, prewarmed=%lld",
+               (long long) metrics.hits, (long long) metrics.misses, (long long) metrics.prewarmed);
+
+    OATPP_ASSERT(metrics.hits == 1);
+    OATPP_ASSERT(metrics.misses == 0);
+    OATPP_ASSERT(metrics.prewarmed >= options.minIdleConnections);
+
+    pool->stop();
+
+    executor->waitTasksFinished();
+    executor->stop();
+    executor->join();
+
+  }
+
+  serverProvider->stop();
+  acceptThread.join();
+
+  for(auto& session : sessions) {
+    session.join();
+  }
+
+}
+
+}}}
@@ -0,0 +1,291 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ConnectionStatisticsTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+#include "oatpp-libressl/ConnectionStatistics.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+typedef oatpp::libressl::ConnectionStatistics ConnectionStatistics;
+
+void testHistogram() {
+
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(0) == 0);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(1) == 1);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(2) == 2);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(3) == 2);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(1023) == 10);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(1024) == 11);
+  OATPP_ASSERT(ConnectionStatistics::getBucketIndex(((v_int64) 1) << 40) == ConnectionStatistics::HISTOGRAM_BUCKETS - 1);
+
+  OATPP_ASSERT(ConnectionStatistics::getBucketUpperBound(0) == 1);
+  OATPP_ASSERT(ConnectionStatistics::getBucketUpperBound(11) == 2048);
+  OATPP_ASSERT(ConnectionStatistics::getBucketUpperBound(ConnectionStatistics::HISTOGRAM_BUCKETS - 1) == -1);
+
+  ConnectionStatistics statistics(4);
+  for(v_int32 i = 0; i < 90; i ++) {
+    statistics.onTlsRead(10, 0);
+  }
+  for(v_int32 i = 0; i < 10; i ++) {
+    statistics.onTlsRead(1000, 0);
+  }
+
+  auto snapshot = statistics.getSnapshot();
+  OATPP_ASSERT(snapshot.tlsReadLatency.count == 100);
+  OATPP_ASSERT(snapshot.tlsReadLatency.sum == 90 * 10 + 10 * 1000);
+  OATPP_ASSERT(snapshot.tlsReadLatency.getPercentile(0.5) == 16);
+  OATPP_ASSERT(snapshot.tlsReadLatency.getPercentile(0.99) == 1024);
+  OATPP_ASSERT(snapshot.tlsWriteLatency.count == 0);
+  OATPP_ASSERT(snapshot.tlsWriteLatency.getPercentile(0.5) == 0);
+
+}
+
+void testConcurrentRecording() {
+
+  const v_int32 threadsCount = 8;
+  const v_int32 iterations = 100000;
+
+  auto statistics = ConnectionStatistics::createShared(4);
+
+  std::vector<std::thread> threads;
+  for(v_int32 i = 0; i < threadsCount; i ++) {
+    threads.push_back(std::thread([statistics, iterations]{
+      for(v_int32 j = 0; j < iterations; j ++) {
+        statistics->onTlsWrite(j & 0xFF, 1);
+        statistics->onHandshake(false, 100);
+      }
+    }));
+  }
+
+  v_int64 startTick = oatpp::base::Environment::getMicroTickCount();
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  v_int64 duration = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  auto snapshot = statistics->getSnapshot();
+  OATPP_ASSERT(snapshot.tlsWriteLatency.count == threadsCount * iterations);
+  OATPP_ASSERT(snapshot.plaintextBytesWritten == threadsCount * iterations);
+  OATPP_ASSERT(snapshot.handshakes == threadsCount * iterations);
+  OATPP_ASSERT(snapshot.handshakeLatency.sum == (v_int64) threadsCount * iterations * 100);
+
+  OATPP_LOGD("ConnectionStatisticsTest", "%d records from %d threads in %lld micro",
+             threadsCount * iterations * 2, threadsCount, duration);
+
+}
+
+void testConnectionMetrics() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-statistics");
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH),
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  const v_buff_size messageSize = 100 * 1024;
+  oatpp::String message(messageSize);
+  std::memset((void*) message->data(), 'a', messageSize);
+
+  {
+
+    StreamHandle serverConnection;
+
+    std::thread acceptThread([&serverProvider, &serverConnection]{
+      serverConnection = serverProvider->get();
+      serverConnection.object->initContexts();
+    });
+
+    StreamHandle clientConnection = clientProvider->get();
+    acceptThread.join();
+
+    auto clientTls = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+    auto serverTls = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+
+    std::thread writerThread([&clientTls, &message]{
+      clientTls->writeExactSizeDataSimple(message->data(), message->size());
+      clientTls->flush();
+    });
+
+    std::unique_ptr<v_char8[]> buffer(new v_char8[messageSize]);
+    v_buff_size received = serverConnection.object->readExactSizeDataSimple(buffer.get(), messageSize);
+    writerThread.join();
+
+    OATPP_ASSERT(received == messageSize);
+
+    auto client = clientTls->getMetrics();
+    auto server = serverTls->getMetrics();
+
+    OATPP_ASSERT(client.handshakeStartTick > 0 && client.handshakeEndTick >= client.handshakeStartTick);
+    OATPP_ASSERT(server.handshakeStartTick > 0 && server.handshakeEndTick >= server.handshakeStartTick);
+
+    OATPP_ASSERT(client.plaintextBytesWritten == messageSize);
+    OATPP_ASSERT(server.plaintextBytesRead == messageSize);
+
+    /* ciphertext includes handshake and per-record overhead */
+    OATPP_ASSERT(client.ciphertextBytesWritten > messageSize);
+    OATPP_ASSERT(server.ciphertextBytesRead == client.ciphertextBytesWritten);
+    /* client might have not read post-handshake messages yet */
+    OATPP_ASSERT(client.ciphertextBytesRead <= server.ciphertextBytesWritten);
+
+    /* 16K max record size - at least 7 application data records plus handshake */
+    OATPP_ASSERT(client.recordsWritten > 7);
+    OATPP_ASSERT(server.recordsRead == client.recordsWritten);
+    OATPP_ASSERT(client.recordsRead <= server.recordsWritten);
+
+    OATPP_ASSERT(client.tlsWriteCalls > 0);
+    OATPP_ASSERT(server.tlsReadCalls > 0);
+
+    OATPP_LOGD("ConnectionStatisticsTest", "client: written %lld/%lld bytes in %lld records, %lld micro in tls_write",
+               client.plaintextBytesWritten, client.ciphertextBytesWritten, client.recordsWritten, client.tlsWriteMicro);
+
+    clientTls.reset();
+    serverTls.reset();
+
+    clientConnection.invalidator->invalidate(clientConnection.object);
+    serverConnection.invalidator->invalidate(serverConnection.object);
+
+  }
+
+  /* connections are destroyed - counters are aggregated */
+
+  auto server = serverProvider->getStatistics()->getSnapshot();
+  auto client = clientProvider->getStatistics()->getSnapshot();
+
+  OATPP_ASSERT(server.handshakes == 1 && client.handshakes == 1);
+  OATPP_ASSERT(server.handshakeFailures == 0 && client.handshakeFailures == 0);
+  OATPP_ASSERT(server.handshakeLatency.count == 1);
+  OATPP_ASSERT(server.resumedHandshakes == 0 && client.resumedHandshakes == 0);
+  OATPP_ASSERT(server.connectionsOpened == 1 && client.connectionsOpened == 1);
+  OATPP_ASSERT(server.connectionsClosed == 1 && client.connectionsClosed == 1);
+  OATPP_ASSERT(server.plaintextBytesRead == messageSize);
+  OATPP_ASSERT(client.plaintextBytesWritten == messageSize);
+  OATPP_ASSERT(server.recordsRead == client.recordsWritten);
+  OATPP_ASSERT(server.tlsReadLatency.count > 0);
+  OATPP_ASSERT(client.tlsWriteLatency.count > 0);
+
+  serverProvider->stop();
+
+}
+
+/* data left in the write buffer is sent when the connection is closed - it is in the aggregated counters */
+void testClosedConnectionMetrics() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-statistics-close");
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH),
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  clientConfig->setWriteBufferSize(16 * 1024);
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  const v_buff_size messageSize = 1000;
+  oatpp::String message(messageSize);
+  std::memset((void*) message->data(), 'a', messageSize);
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  v_int64 recordsBeforeClose;
+  v_int64 ciphertextBeforeClose;
+
+  {
+
+    StreamHandle clientConnection = clientProvider->get();
+    acceptThread.join();
+
+    auto clientTls = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+    clientTls->cork();
+    OATPP_ASSERT(clientTls->writeExactSizeDataSimple(message->data(), message->size()) == messageSize);
+    OATPP_ASSERT(clientTls->getUnflushedBytes() == messageSize);
+    OATPP_ASSERT(clientTls->getMetrics().plaintextBytesWritten == 0);
+
+    recordsBeforeClose = clientTls->getMetrics().recordsWritten;
+    ciphertextBeforeClose = clientTls->getMetrics().ciphertextBytesWritten;
+
+    /* client connection is destroyed without flush - transport is left open for the final flush */
+
+  }
+
+  std::unique_ptr<v_char8[]> buffer(new v_char8[messageSize]);
+  OATPP_ASSERT(serverConnection.object->readExactSizeDataSimple(buffer.get(), messageSize) == messageSize);
+
+  /* close_notify is received - clean end of stream */
+  oatpp::async::Action action;
+  OATPP_ASSERT(serverConnection.object->read(buffer.get(), messageSize, action) == 0);
+
+  auto client = clientProvider->getStatistics()->getSnapshot();
+  OATPP_ASSERT(client.connectionsClosed == 1);
+  OATPP_ASSERT(client.plaintextBytesWritten == messageSize);
+
+  /* one record of the flushed data and the close_notify alert */
+  OATPP_ASSERT(client.recordsWritten == recordsBeforeClose + 2);
+  OATPP_ASSERT(client.ciphertextBytesWritten > ciphertextBeforeClose + messageSize);
+
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+}
+
+}
+
+void ConnectionStatisticsTest::onRun() {
+  testHistogram();
+  testConcurrentRecording();
+  testConnectionMetrics();
+  testClosedConnectionMetrics();
+}
+
+}}}
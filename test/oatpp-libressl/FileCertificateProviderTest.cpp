@@ -0,0 +1,209 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "FileCertificateProviderTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/FileCertificateProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+void writeFile(const std::string& path, const oatpp::String& data) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(data->data(), data->size());
+}
+
+/* connect to the virtual interface - SNI is the interface name */
+bool connect(const std::shared_ptr<oatpp::libressl::Config>& serverConfig,
+             const std::shared_ptr<oatpp::libressl::server::CertificateProvider>& certificateProvider,
+             const oatpp::String& host)
+{
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared(host);
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+  serverProvider->setCertificateProvider(certificateProvider);
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection;
+  try {
+    clientConnection = clientProvider->get();
+  } catch (std::runtime_error& e) {
+    OATPP_LOGD("FileCertificateProviderTest", "connect failed: %s", e.what());
+  }
+
+  acceptThread.join();
+
+  if(clientConnection) {
+    clientConnection.invalidator->invalidate(clientConnection.object);
+  }
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+  serverProvider->stop();
+
+  return (bool) clientConnection;
+
+}
+
+}
+
+void FileCertificateProviderTest::onRun() {
+
+  char directoryTemplate[] = "/tmp/oatpp-libressl-certs-XXXXXX";
+  OATPP_ASSERT(mkdtemp(directoryTemplate) != nullptr);
+  std::string directory = directoryTemplate;
+
+  auto cert = oatpp::String::loadFromFile(CERT_CRT_PATH);
+  auto key = oatpp::String::loadFromFile(CERT_PEM_PATH);
+
+  writeFile(directory + "/virtualhost-lru.crt", cert);
+  writeFile(directory + "/virtualhost-lru.key", key);
+  writeFile(directory + "/_.lru.test.crt", cert);
+  writeFile(directory + "/_.lru.test.key", key);
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+
+  /* capacity - one exact name, one wildcard keypair and one name mapped to it */
+  auto provider = oatpp::libressl::server::FileCertificateProvider::createShared(serverConfig, directory.c_str(), 3);
+
+  OATPP_ASSERT(provider->getStatistics().size == 0); // nothing is loaded upfront
+
+  OATPP_ASSERT(connect(serverConfig, provider, "virtualhost-lru"));
+  OATPP_ASSERT(connect(serverConfig, provider, "virtualhost-lru"));
+
+  {
+    auto statistics = provider->getStatistics();
+    OATPP_ASSERT(statistics.misses == 1);
+    OATPP_ASSERT(statistics.hits == 1);
+    OATPP_ASSERT(statistics.loads == 1);
+  }
+
+  OATPP_ASSERT(connect(serverConfig, provider, "api.lru.test")); // wildcard keypair
+
+  {
+    auto statistics = provider->getStatistics();
+    OATPP_ASSERT(statistics.misses == 2);
+    OATPP_ASSERT(statistics.loads == 2);
+    OATPP_ASSERT(statistics.size == 3);
+    OATPP_ASSERT(statistics.evictions == 0);
+  }
+
+  OATPP_ASSERT(connect(serverConfig, provider, "www.lru.test")); // wildcard keypair is cached
+
+  {
+    auto statistics = provider->getStatistics();
+    OATPP_ASSERT(statistics.misses == 3);
+    OATPP_ASSERT(statistics.loads == 2);
+    OATPP_ASSERT(statistics.evictions == 1); // "virtualhost-lru" is the least recently used
+  }
+
+  OATPP_ASSERT(connect(serverConfig, provider, "virtualhost-lru-unknown")); // default keypair
+  OATPP_ASSERT(connect(serverConfig, provider, "virtualhost-lru-unknown"));
+
+  {
+    auto statistics = provider->getStatistics();
+    OATPP_ASSERT(statistics.notFound == 1);
+    OATPP_ASSERT(statistics.hits == 2); // unknown name is cached too
+    OATPP_ASSERT(statistics.size == 3);
+    OATPP_LOGD(TAG, "loads=%lld, load time=%lldus", (long long) statistics.loads, (long long) statistics.loadTimeMicro);
+  }
+
+  OATPP_ASSERT(provider->getKeypair("../etc/passwd", 13) == nullptr);
+
+  { // concurrent lookups of an uncached name load it once
+
+    writeFile(directory + "/burst.test.crt", cert);
+    writeFile(directory + "/burst.test.key", key);
+
+    auto loads = provider->getStatistics().loads;
+
+    std::atomic<bool> start(false);
+    std::vector<std::shared_ptr<oatpp::libressl::CertificateIndex::Keypair>> keypairs(8);
+    std::vector<std::thread> threads;
+
+    for(v_int32 i = 0; i < 8; i ++) {
+      threads.push_back(std::thread([&provider, &start, &keypairs, i]{
+        while(!start) {
+          std::this_thread::yield();
+        }
+        keypairs[i] = provider->getKeypair("burst.test", 10);
+      }));
+    }
+
+    start = true;
+    for(auto& thread : threads) {
+      thread.join();
+    }
+
+    OATPP_ASSERT(provider->getStatistics().loads == loads + 1);
+    for(auto& keypair : keypairs) {
+      OATPP_ASSERT(keypair && keypair == keypairs[0]);
+    }
+
+    unlink((directory + "/burst.test.crt").c_str());
+    unlink((directory + "/burst.test.key").c_str());
+
+  }
+
+  unlink((directory + "/virtualhost-lru.crt").c_str());
+  unlink((directory + "/virtualhost-lru.key").c_str());
+  unlink((directory + "/_.lru.test.crt").c_str());
+  unlink((directory + "/_.lru.test.key").c_str());
+  rmdir(directory.c_str());
+
+}
+
+}}}
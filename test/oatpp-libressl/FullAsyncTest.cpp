@@ -56,10 +56,12 @@ namespace {
 class TestComponent {
 private:
   v_uint16 m_port;
+  FullAsyncTest::ConfigModifier m_configModifier;
 public:
 
-  TestComponent(v_uint16 port)
+  TestComponent(v_uint16 port, const FullAsyncTest::ConfigModifier& configModifier)
     : m_port(port)
+    , m_configModifier(configModifier)
   {}
 
   OATPP_CREATE_COMPONENT(std::shared_ptr<oatpp::async::Executor>, executor)([] {
@@ -85,6 +87,9 @@ public:
     OATPP_LOGD("oatpp::libressl::Config", "crt='%s'", CERT_CRT_PATH);
 
     auto config = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+    if(m_configModifier) {
+      m_configModifier(config);
+    }
     return oatpp::libressl::server::ConnectionProvider::createShared(config, streamProvider);
 
   }());
@@ -115,6 +120,9 @@ public:
     }
 
     auto config = oatpp::libressl::Config::createDefaultClientConfigShared();
+    if(m_configModifier) {
+      m_configModifier(config);
+    }
     return oatpp::libressl::client::ConnectionProvider::createShared(config, streamProvider);
 
   }());
@@ -125,7 +133,7 @@ public:
   
 void FullAsyncTest::onRun() {
 
-  TestComponent component(m_port);
+  TestComponent component(m_port, m_configModifier);
 
   oatpp::test::web::ClientServerTestRunner runner;
 
@@ -0,0 +1,416 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+#include "FullDuplexTest.hpp"
+
+#include "app/TransportProbe.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/Connection.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include "oatpp/core/async/Executor.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+v_char8 patternByte(v_int64 position) {
+  return (v_char8) (position % 251);
+}
+
+void writeBlocking(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int64 total, std::atomic<v_int64>* counter) {
+
+  v_char8 buffer[4096];
+  v_int64 progress = 0;
+
+  while(progress < total) {
+
+    v_buff_size size = 1 + (progress * 7) % sizeof(buffer);
+    if(size > total - progress) {
+      size = (v_buff_size) (total - progress);
+    }
+
+    for(v_buff_size i = 0; i < size; i ++) {
+      buffer[i] = patternByte(progress + i);
+    }
+
+    async::Action action;
+    auto res = stream->write(buffer, size, action);
+
+    if(res > 0) {
+      progress += res;
+      *counter += res;
+    } else if(res != IOError::RETRY_READ && res != IOError::RETRY_WRITE) {
+      OATPP_LOGE("writeBlocking()", "Error. Write failed.");
+      return;
+    }
+
+  }
+
+}
+
+void readBlocking(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int64 total, std::atomic<v_int64>* counter) {
+
+  v_char8 buffer[4096];
+  v_int64 progress = 0;
+
+  while(progress < total) {
+
+    v_buff_size size = sizeof(buffer);
+    if(size > total - progress) {
+      size = (v_buff_size) (total - progress);
+    }
+
+    async::Action action;
+    auto res = stream->read(buffer, size, action);
+
+    if(res > 0) {
+      for(v_io_size i = 0; i < res; i ++) {
+        if(buffer[i] != patternByte(progress + i)) {
+          OATPP_LOGE("readBlocking()", "Error. Data corrupted.");
+          return;
+        }
+      }
+      progress += res;
+      *counter += res;
+    } else if(res != IOError::RETRY_READ && res != IOError::RETRY_WRITE) {
+      OATPP_LOGE("readBlocking()", "Error. Read failed.");
+      return;
+    }
+
+  }
+
+}
+
+class WriterCoroutine : public oatpp::async::Coroutine<WriterCoroutine> {
+private:
+  std::shared_ptr<oatpp::data::stream::IOStream> m_stream;
+  v_int64 m_total;
+  v_int64 m_progress;
+  std::atomic<v_int64>* m_counter;
+  v_char8 m_buffer[4096];
+public:
+
+  WriterCoroutine(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int64 total, std::atomic<v_int64>* counter)
+    : m_stream(stream)
+    , m_total(total)
+    , m_progress(0)
+    , m_counter(counter)
+  {}
+
+  Action act() override {
+
+    if(m_progress >= m_total) {
+      return finish();
+    }
+
+    /* vary chunk sizes so that records of different size get interleaved with reads */
+    v_buff_size size = 1 + (m_progress * 7) % sizeof(m_buffer);
+    if(size > m_total - m_progress) {
+      size = (v_buff_size) (m_total - m_progress);
+    }
+
+    for(v_buff_size i = 0; i < size; i ++) {
+      m_buffer[i] = patternByte(m_progress + i);
+    }
+
+    async::Action action;
+    auto res = m_stream->write(m_buffer, size, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      m_progress += res;
+      *m_counter += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[WriterCoroutine::act()]: Error. Write failed.");
+
+  }
+
+};
+
+class ReaderCoroutine : public oatpp::async::Coroutine<ReaderCoroutine> {
+private:
+  std::shared_ptr<oatpp::data::stream::IOStream> m_stream;
+  v_int64 m_total;
+  v_int64 m_progress;
+  std::atomic<v_int64>* m_counter;
+  v_char8 m_buffer[4096];
+public:
+
+  ReaderCoroutine(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int64 total, std::atomic<v_int64>* counter)
+    : m_stream(stream)
+    , m_total(total)
+    , m_progress(0)
+    , m_counter(counter)
+  {}
+
+  Action act() override {
+
+    if(m_progress >= m_total) {
+      return finish();
+    }
+
+    v_buff_size size = sizeof(m_buffer);
+    if(size > m_total - m_progress) {
+      size = (v_buff_size) (m_total - m_progress);
+    }
+
+    async::Action action;
+    auto res = m_stream->read(m_buffer, size, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res > 0) {
+      for(v_io_size i = 0; i < res; i ++) {
+        if(m_buffer[i] != patternByte(m_progress + i)) {
+          return error<Error>("[ReaderCoroutine::act()]: Error. Data corrupted.");
+        }
+      }
+      m_progress += res;
+      *m_counter += res;
+      return repeat();
+    }
+
+    if(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) {
+      return repeat();
+    }
+
+    return error<Error>("[ReaderCoroutine::act()]: Error. Read failed.");
+
+  }
+
+};
+
+/*
+ * Blocking transport which can't take the data now (Ex.: send timeout) - write doesn't spin on it,
+ * data accepted by libtls stays staged and goes out on flush.
+ */
+void testBlockingTransportRetry() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-duplex-retry");
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH),
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto probeProvider = std::make_shared<app::ProbeConnectionProvider>(
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    probeProvider
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+  auto probe = probeProvider->getLastStream();
+
+  v_char8 data[100];
+  for(v_int32 i = 0; i < 100; i ++) {
+    data[i] = patternByte(i);
+  }
+
+  probe->writeRetries = 1;
+  v_int64 writeCalls = probe->writeCalls;
+
+  async::Action action;
+  auto res = client->write(data, 100, action);
+  OATPP_ASSERT(res == 100);
+  OATPP_ASSERT(action.isNone());
+  OATPP_ASSERT(probe->writeCalls == writeCalls + 1);
+
+  OATPP_ASSERT(client->flush() == 0);
+  OATPP_ASSERT(probe->writeCalls == writeCalls + 2);
+
+  std::atomic<v_int64> serverRead(0);
+  readBlocking(serverConnection.object, 100, &serverRead);
+  OATPP_ASSERT(serverRead == 100);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+  serverProvider->stop();
+
+}
+
+}
+
+void FullDuplexTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-duplex");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  OATPP_ASSERT(serverConnection);
+  OATPP_ASSERT(clientConnection);
+
+  {
+    auto server = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+    auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+    OATPP_ASSERT(server->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+    OATPP_ASSERT(client->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+    OATPP_LOGD(TAG, "handshake: server=%lld(micro), client=%lld(micro)",
+               (long long) server->getHandshakeDuration(), (long long) client->getHandshakeDuration());
+  }
+
+  /*
+   * Blocking reader and writer threads. Reader waits on the transport most of the time -
+   * writer of the same connection must not be locked out of libtls meanwhile.
+   */
+  {
+
+    v_int64 total = m_bytesPerDirection / 4;
+
+    std::atomic<v_int64> serverWritten(0);
+    std::atomic<v_int64> serverRead(0);
+    std::atomic<v_int64> clientWritten(0);
+    std::atomic<v_int64> clientRead(0);
+
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread(writeBlocking, serverConnection.object, total, &serverWritten));
+    threads.push_back(std::thread(readBlocking, serverConnection.object, total, &serverRead));
+    threads.push_back(std::thread(writeBlocking, clientConnection.object, total, &clientWritten));
+    threads.push_back(std::thread(readBlocking, clientConnection.object, total, &clientRead));
+
+    for(auto& thread : threads) {
+      thread.join();
+    }
+
+    OATPP_LOGD(TAG, "blocking: bytes per direction=%lld", (long long) total);
+
+    OATPP_ASSERT(serverWritten == total);
+    OATPP_ASSERT(clientWritten == total);
+    OATPP_ASSERT(serverRead == total);
+    OATPP_ASSERT(clientRead == total);
+
+  }
+
+  serverConnection.object->setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+  serverConnection.object->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+  clientConnection.object->setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+  clientConnection.object->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+  std::atomic<v_int64> serverWritten(0);
+  std::atomic<v_int64> serverRead(0);
+  std::atomic<v_int64> clientWritten(0);
+  std::atomic<v_int64> clientRead(0);
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+
+  {
+
+    oatpp::async::Executor executor(m_threads, 1, 1);
+
+    executor.execute<WriterCoroutine>(serverConnection.object, m_bytesPerDirection, &serverWritten);
+    executor.execute<ReaderCoroutine>(serverConnection.object, m_bytesPerDirection, &serverRead);
+    executor.execute<WriterCoroutine>(clientConnection.object, m_bytesPerDirection, &clientWritten);
+    executor.execute<ReaderCoroutine>(clientConnection.object, m_bytesPerDirection, &clientRead);
+
+    executor.waitTasksFinished(std::chrono::minutes(5));
+    executor.stop();
+    executor.join();
+
+  }
+
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+  OATPP_LOGD(TAG, "threads=%d, bytes per direction=%lld, time=%lld(micro)", m_threads, (long long) m_bytesPerDirection, (long long) ticks);
+
+  OATPP_ASSERT(serverWritten == m_bytesPerDirection);
+  OATPP_ASSERT(clientWritten == m_bytesPerDirection);
+  OATPP_ASSERT(serverRead == m_bytesPerDirection);
+  OATPP_ASSERT(clientRead == m_bytesPerDirection);
+
+  {
+    auto server = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+    auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+    auto serverRetries = server->getRetryStatistics();
+    auto clientRetries = client->getRetryStatistics();
+    OATPP_LOGD(TAG, "server retries: read=%lld, write=%lld, spurious=%lld",
+               (long long) serverRetries.readRetries, (long long) serverRetries.writeRetries, (long long) serverRetries.spuriousRetries);
+    OATPP_LOGD(TAG, "client retries: read=%lld, write=%lld, spurious=%lld",
+               (long long) clientRetries.readRetries, (long long) clientRetries.writeRetries, (long long) clientRetries.spuriousRetries);
+  }
+
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  clientConnection.invalidator->invalidate(clientConnection.object);
+
+  serverProvider->stop();
+
+  testBlockingTransportRetry();
+
+}
+
+}}}
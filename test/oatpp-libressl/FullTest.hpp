@@ -25,20 +25,28 @@
 #ifndef oatpp_test_web_FullTest_hpp
 #define oatpp_test_web_FullTest_hpp
 
+#include "oatpp-libressl/Config.hpp"
+
 #include "oatpp-test/UnitTest.hpp"
 
+#include <functional>
+
 namespace oatpp { namespace test { namespace libressl {
 
 class FullTest : public UnitTest {
+public:
+  typedef std::function<void(const std::shared_ptr<oatpp::libressl::Config>& config)> ConfigModifier;
 private:
   v_uint16 m_port;
   v_int32 m_iterationsPerStep;
+  ConfigModifier m_configModifier;
 public:
   
-  FullTest(v_uint16 port, v_int32 iterationsPerStep)
+  FullTest(v_uint16 port, v_int32 iterationsPerStep, const ConfigModifier& configModifier = nullptr)
     : UnitTest("TEST[web::FullTest]")
     , m_port(port)
     , m_iterationsPerStep(iterationsPerStep)
+    , m_configModifier(configModifier)
   {}
 
   void onRun() override;
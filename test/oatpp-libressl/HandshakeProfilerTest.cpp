@@ -0,0 +1,165 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "HandshakeProfilerTest.hpp"
+
+#include "oatpp-libressl/HandshakeProfiler.hpp"
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::libressl::HandshakeTimeline Timeline;
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+void testTimeline() {
+
+  Timeline timeline;
+
+  /* client side of a full TLS 1.3 handshake */
+  timeline.start(1000);
+  timeline.onWrite(1300);  // ClientHello built - 300 processing
+  timeline.onRead(2300);   // server flight arrives - 1000 waiting
+  timeline.onRead(2500);   // rest of the flight - 200 receiving
+  timeline.onWrite(2900);  // certificate verified, Finished built - 400 processing
+  timeline.onWrite(2950);  // - 50 sending
+  timeline.finish(3000);   // - 50 processing
+
+  OATPP_ASSERT(timeline.getPhaseDuration(Timeline::Phase::PROCESSING) == 750);
+  OATPP_ASSERT(timeline.getPhaseDuration(Timeline::Phase::SENDING) == 50);
+  OATPP_ASSERT(timeline.getPhaseDuration(Timeline::Phase::WAITING) == 1000);
+  OATPP_ASSERT(timeline.getPhaseDuration(Timeline::Phase::RECEIVING) == 200);
+  OATPP_ASSERT(timeline.getDuration() == 2000);
+  OATPP_ASSERT(timeline.getFlightsCount() == 3);
+
+  oatpp::libressl::HandshakeProfiler profiler;
+  profiler.onHandshake("TLS_AES_256_GCM_SHA384", "EC-256", timeline);
+  profiler.onHandshake("TLS_AES_256_GCM_SHA384", "EC-256", timeline);
+  profiler.onHandshake(nullptr, nullptr, timeline);
+
+  auto profiles = profiler.getProfiles();
+  OATPP_ASSERT(profiles.size() == 2);
+
+  for(auto& profile : profiles) {
+    if(profile.cipher == "TLS_AES_256_GCM_SHA384") {
+      OATPP_ASSERT(profile.certificateType == "EC-256");
+      OATPP_ASSERT(profile.total.count == 2);
+      OATPP_ASSERT(profile.total.sum == 4000);
+      OATPP_ASSERT(profile.phases[Timeline::Phase::WAITING].sum == 2000);
+      OATPP_ASSERT(profile.flights == 6);
+    } else {
+      OATPP_ASSERT(profile.cipher == oatpp::libressl::HandshakeProfiler::UNKNOWN);
+      OATPP_ASSERT(profile.certificateType == oatpp::libressl::HandshakeProfiler::UNKNOWN);
+      OATPP_ASSERT(profile.total.count == 1);
+    }
+  }
+
+  profiler.reset();
+  OATPP_ASSERT(profiler.getProfiles().empty());
+
+}
+
+void assertProfile(const char* tag, const std::shared_ptr<oatpp::libressl::HandshakeProfiler>& profiler) {
+
+  auto profiles = profiler->getProfiles();
+  OATPP_ASSERT(profiles.size() == 1);
+
+  auto& profile = profiles[0];
+  OATPP_LOGD(tag, "cipher='%s', certificate='%s', total=%lldus, flights=%lld",
+             profile.cipher->c_str(), profile.certificateType->c_str(), profile.total.sum, profile.flights);
+
+  OATPP_ASSERT(profile.total.count == 1);
+  OATPP_ASSERT(profile.cipher != oatpp::libressl::HandshakeProfiler::UNKNOWN);
+  OATPP_ASSERT(profile.certificateType != oatpp::libressl::HandshakeProfiler::UNKNOWN);
+  OATPP_ASSERT(profile.flights > 0);
+
+  v_int64 phasesSum = 0;
+  for(v_int32 i = 0; i < Timeline::PHASES_COUNT; i ++) {
+    OATPP_LOGD(tag, "  %s=%lldus", Timeline::getPhaseName((Timeline::Phase) i), profile.phases[i].sum);
+    OATPP_ASSERT(profile.phases[i].count == 1);
+    phasesSum += profile.phases[i].sum;
+  }
+  OATPP_ASSERT(phasesSum == profile.total.sum);
+
+}
+
+}
+
+void HandshakeProfilerTest::onRun() {
+
+  testTimeline();
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-profiler");
+
+  auto serverProfiler = oatpp::libressl::HandshakeProfiler::createShared();
+  auto clientProfiler = oatpp::libressl::HandshakeProfiler::createShared();
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  serverConfig->setHandshakeProfiler(serverProfiler);
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  clientConfig->setHandshakeProfiler(clientProfiler);
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  assertProfile("server", serverProfiler);
+  assertProfile("client", clientProfiler);
+
+  /* both sides see the same server certificate */
+  OATPP_ASSERT(serverProfiler->getProfiles()[0].certificateType == clientProfiler->getProfiles()[0].certificateType);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+}
+
+}}}
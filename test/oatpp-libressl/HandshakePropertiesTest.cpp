@@ -0,0 +1,213 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "HandshakePropertiesTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+oatpp::String getProperty(const oatpp::data::stream::Context& context, const char* key) {
+  auto value = context.getProperties().get(key);
+  if(value == nullptr) {
+    return nullptr;
+  }
+  return value.toString();
+}
+
+void assertSameProperties(const oatpp::data::stream::Context& a, const oatpp::data::stream::Context& b) {
+  const char* keys[] = {
+    "tls", "tls_version", "tls_cipher", "tls_cipher_strength", "tls_servername",
+    "tls_alpn", "tls_session_resumed", "tls_peer_cert_hash", "tls_peer_cert_subject"
+  };
+  for(const char* key : keys) {
+    OATPP_ASSERT(getProperty(a, key) == getProperty(b, key));
+  }
+}
+
+}
+
+void HandshakePropertiesTest::onRun() {
+
+  const char* host = "virtualhost-properties";
+  auto interface = oatpp::network::virtual_::Interface::obtainShared(host);
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  auto& server = serverConnection.object->getInputStreamContext();
+  auto& client = clientConnection.object->getInputStreamContext();
+
+  assertSameProperties(server, serverConnection.object->getOutputStreamContext());
+  assertSameProperties(client, clientConnection.object->getOutputStreamContext());
+
+  OATPP_ASSERT(getProperty(server, "tls") == "libressl");
+
+  auto version = getProperty(server, "tls_version");
+  auto cipher = getProperty(server, "tls_cipher");
+  auto strength = getProperty(server, "tls_cipher_strength");
+
+  OATPP_LOGD(TAG, "version='%s', cipher='%s', strength='%s'",
+             version ? version->c_str() : "<none>",
+             cipher ? cipher->c_str() : "<none>",
+             strength ? strength->c_str() : "<none>");
+
+  OATPP_ASSERT(version && version->size() > 0);
+  OATPP_ASSERT(cipher && cipher->size() > 0);
+  OATPP_ASSERT(strength && std::atoi(strength->c_str()) > 0);
+
+  OATPP_ASSERT(getProperty(client, "tls_version") == version);
+  OATPP_ASSERT(getProperty(client, "tls_cipher") == cipher);
+  OATPP_ASSERT(getProperty(client, "tls_cipher_strength") == strength);
+
+  OATPP_ASSERT(getProperty(server, "tls_servername") == host);
+  OATPP_ASSERT(getProperty(client, "tls_session_resumed") == "false");
+  OATPP_ASSERT(getProperty(server, "tls_session_resumed") == "false");
+
+  /* ALPN not configured */
+  OATPP_ASSERT(!getProperty(server, "tls_alpn"));
+  OATPP_ASSERT(!getProperty(client, "tls_alpn"));
+
+  /* client doesn't present a certificate */
+  OATPP_ASSERT(!getProperty(server, "tls_peer_cert_hash"));
+  OATPP_ASSERT(!getProperty(server, "tls_peer_cert_subject"));
+
+  auto peerHash = getProperty(client, "tls_peer_cert_hash");
+  auto peerSubject = getProperty(client, "tls_peer_cert_subject");
+  OATPP_LOGD(TAG, "peer hash='%s', subject='%s'",
+             peerHash ? peerHash->c_str() : "<none>",
+             peerSubject ? peerSubject->c_str() : "<none>");
+  OATPP_ASSERT(peerHash && peerHash->size() > 0);
+  OATPP_ASSERT(peerSubject);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+  { // handshake completed lazily by read() is published by the context initialization - not under a reader
+
+    StreamHandle lazyServer;
+    v_char8 byte = 0;
+    v_io_size res = 0;
+
+    /* server handshake runs inside the first read() */
+    std::thread lazyAcceptThread([&serverProvider, &lazyServer, &byte, &res]{
+      lazyServer = serverProvider->get();
+      oatpp::async::Action action;
+      do {
+        res = lazyServer.object->read(&byte, 1, action);
+      } while(res == IOError::RETRY_READ || res == IOError::RETRY_WRITE);
+    });
+
+    auto lazyClient = clientProvider->get();
+    oatpp::async::Action action;
+    OATPP_ASSERT(lazyClient.object->write("x", 1, action) == 1);
+
+    lazyAcceptThread.join();
+    OATPP_ASSERT(res == 1 && byte == 'x');
+
+    auto lazy = std::static_pointer_cast<oatpp::libressl::Connection>(lazyServer.object);
+    OATPP_ASSERT(lazy->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+    OATPP_ASSERT(!getProperty(lazyServer.object->getInputStreamContext(), "tls_version"));
+
+    lazyServer.object->initContexts();
+    OATPP_ASSERT(getProperty(lazyServer.object->getInputStreamContext(), "tls_version") == version);
+
+    lazyClient.invalidator->invalidate(lazyClient.object);
+    lazyServer.invalidator->invalidate(lazyServer.object);
+
+  }
+
+  { // non-blocking transport - init() leaves the handshake IN_PROGRESS, a later init() completes and publishes it
+
+    StreamHandle pendingClient;
+    std::thread clientThread([&clientProvider, &pendingClient]{
+      pendingClient = clientProvider->get();
+    });
+
+    auto pendingServer = serverProvider->get();
+    pendingServer.object->setInputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+    pendingServer.object->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+    auto pending = std::static_pointer_cast<oatpp::libressl::Connection>(pendingServer.object);
+    auto& context = pendingServer.object->getInputStreamContext();
+
+    for(v_int32 i = 0; i < 1000 && !context.isInitialized(); i ++) {
+      pendingServer.object->initContexts();
+      if(!context.isInitialized()) {
+        OATPP_ASSERT(pending->getHandshakeState() != oatpp::libressl::Connection::HandshakeState::COMPLETE);
+        OATPP_ASSERT(!getProperty(context, "tls_version"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    clientThread.join();
+
+    OATPP_ASSERT(context.isInitialized());
+    OATPP_ASSERT(pending->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+    OATPP_ASSERT(getProperty(context, "tls_version") == version);
+
+    pendingClient.invalidator->invalidate(pendingClient.object);
+    pendingServer.invalidator->invalidate(pendingServer.object);
+
+  }
+
+  serverProvider->stop();
+
+}
+
+}}}
@@ -0,0 +1,230 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "MultiListenerBenchmarkTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/MultiListenerConnectionProvider.hpp"
+
+#include "oatpp/network/tcp/client/ConnectionProvider.hpp"
+#include "oatpp/core/utils/ConversionUtils.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+v_float64 measure(v_uint16 port, v_int32 listeners, v_int32 connections, v_int32 clientThreads) {
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::MultiListenerConnectionProvider::createShared(
+    serverConfig, {"localhost", port, oatpp::network::Address::IP_4}, listeners, true /* handshakeOnListener */
+  );
+
+  OATPP_ASSERT(serverProvider->getListenersCount() == listeners);
+
+  std::atomic<v_int32> served(0);
+  std::thread handlerThread([&serverProvider, &served]{
+    while(true) {
+      auto connection = serverProvider->get();
+      if(!connection) {
+        break;
+      }
+      served ++;
+      connection.invalidator->invalidate(connection.object);
+    }
+  });
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  tls_config_insecure_noverifycert(clientConfig->getTLSConfig());
+  tls_config_insecure_noverifyname(clientConfig->getTLSConfig());
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::tcp::client::ConnectionProvider::createShared({"localhost", port, oatpp::network::Address::IP_4})
+  );
+
+  std::atomic<v_int32> connected(0);
+  std::vector<std::thread> clients;
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+
+  for(v_int32 t = 0; t < clientThreads; t ++) {
+    clients.push_back(std::thread([&clientProvider, &connected, connections, clientThreads]{
+      for(v_int32 i = 0; i < connections / clientThreads; i ++) {
+        auto connection = clientProvider->get();
+        connected ++;
+        connection.invalidator->invalidate(connection.object);
+      }
+    }));
+  }
+
+  for(auto& client : clients) {
+    client.join();
+  }
+
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+  /* let the handler take the last handshaked connections */
+  while(served + serverProvider->getHandshakeFailuresCount() + serverProvider->getDroppedCount() < connected) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  serverProvider->stop();
+  handlerThread.join();
+
+  OATPP_ASSERT(connected == (connections / clientThreads) * clientThreads);
+  OATPP_ASSERT(serverProvider->getAcceptedCount() == connected);
+  OATPP_ASSERT(serverProvider->getHandshakeFailuresCount() == 0);
+
+  return (v_float64) connected * 1000 * 1000 / (v_float64) (ticks > 0 ? ticks : 1);
+
+}
+
+/* idle client (connected, never sends ClientHello) must not keep other clients from being accepted */
+void testIdleClient() {
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  tls_config_insecure_noverifycert(clientConfig->getTLSConfig());
+  tls_config_insecure_noverifyname(clientConfig->getTLSConfig());
+
+  /* handshake from a separate thread - the server side may need a get() to make progress */
+  auto connectTLS = [&clientConfig](v_uint16 port) {
+    return std::thread([clientConfig, port]{
+      auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+        clientConfig,
+        oatpp::network::tcp::client::ConnectionProvider::createShared({"localhost", port, oatpp::network::Address::IP_4})
+      );
+      auto connection = clientProvider->get();
+      connection.object->initContexts();
+      connection.invalidator->invalidate(connection.object);
+    });
+  };
+
+  auto getPort = [](const std::shared_ptr<oatpp::network::ServerConnectionProvider>& provider) {
+    auto port = provider->getProperty(oatpp::network::ConnectionProvider::PROPERTY_PORT).toString();
+    return (v_uint16) oatpp::utils::conversion::strToInt32(port->c_str());
+  };
+
+  { // default - handshake is left to the consumer, listener accepts the next client right away
+
+    auto serverProvider = oatpp::libressl::server::MultiListenerConnectionProvider::createShared(
+      serverConfig, {"localhost", 0, oatpp::network::Address::IP_4}, 1
+    );
+    auto port = getPort(serverProvider);
+
+    auto idle = oatpp::network::tcp::client::ConnectionProvider::createShared({"localhost", port, oatpp::network::Address::IP_4})->get();
+    auto client = connectTLS(port);
+
+    auto idleConnection = serverProvider->get();
+    auto connection = serverProvider->get();
+    OATPP_ASSERT(idleConnection && connection);
+
+    connection.object->initContexts();
+    OATPP_ASSERT(std::static_pointer_cast<oatpp::libressl::Connection>(connection.object)->getHandshakeState() ==
+                 oatpp::libressl::Connection::HandshakeState::COMPLETE);
+
+    client.join();
+    OATPP_ASSERT(serverProvider->getAcceptedCount() == 2);
+
+    connection.invalidator->invalidate(connection.object);
+    idleConnection.invalidator->invalidate(idleConnection.object);
+    idle.invalidator->invalidate(idle.object);
+    serverProvider->stop();
+
+  }
+
+  { // handshake on the listener - idle client is dropped after the handshake timeout
+
+    auto serverProvider = oatpp::libressl::server::MultiListenerConnectionProvider::createShared(
+      serverConfig, {"localhost", 0, oatpp::network::Address::IP_4}, 1, true, 1024, std::chrono::milliseconds(300)
+    );
+    auto port = getPort(serverProvider);
+
+    auto idle = oatpp::network::tcp::client::ConnectionProvider::createShared({"localhost", port, oatpp::network::Address::IP_4})->get();
+    auto client = connectTLS(port);
+
+    auto connection = serverProvider->get();
+    OATPP_ASSERT(connection);
+    OATPP_ASSERT(std::static_pointer_cast<oatpp::libressl::Connection>(connection.object)->getHandshakeState() ==
+                 oatpp::libressl::Connection::HandshakeState::COMPLETE);
+
+    client.join();
+    OATPP_ASSERT(serverProvider->getAcceptedCount() == 2);
+    OATPP_ASSERT(serverProvider->getHandshakeFailuresCount() == 1);
+
+    connection.invalidator->invalidate(connection.object);
+    idle.invalidator->invalidate(idle.object);
+    serverProvider->stop();
+
+  }
+
+  { // stop() aborts the handshake of the idle client instead of waiting for its deadline
+
+    auto serverProvider = oatpp::libressl::server::MultiListenerConnectionProvider::createShared(
+      serverConfig, {"localhost", 0, oatpp::network::Address::IP_4}, 1, true, 1024, std::chrono::hours(1)
+    );
+    auto port = getPort(serverProvider);
+
+    auto idle = oatpp::network::tcp::client::ConnectionProvider::createShared({"localhost", port, oatpp::network::Address::IP_4})->get();
+
+    while(serverProvider->getAcceptedCount() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto startTick = oatpp::base::Environment::getMicroTickCount();
+    serverProvider->stop();
+    auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+
+    OATPP_ASSERT(ticks < 5 * 1000 * 1000);
+    OATPP_ASSERT(serverProvider->getHandshakeFailuresCount() == 1);
+
+    idle.invalidator->invalidate(idle.object);
+
+  }
+
+}
+
+}
+
+void MultiListenerBenchmarkTest::onRun() {
+
+  testIdleClient();
+
+  const v_int32 listenersCounts[] = {1, 2, 4};
+
+  for(v_int32 listeners : listenersCounts) {
+    auto rate = measure(m_port, listeners, m_connections, m_clientThreads);
+    OATPP_LOGD(TAG, "listeners=%d, accept+handshake/sec=%f", listeners, rate);
+  }
+
+}
+
+}}}
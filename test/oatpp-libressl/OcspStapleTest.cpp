@@ -0,0 +1,125 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "OcspStapleTest.hpp"
+
+#include "oatpp-libressl/server/OcspStapleRefresher.hpp"
+
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+/* "responder" publishes a new response by atomically replacing the file */
+void publish(const std::string& filename, const std::string& response) {
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    file.write(response.data(), response.size());
+  }
+  OATPP_ASSERT(rename(tmp.c_str(), filename.c_str()) == 0);
+}
+
+}
+
+void OcspStapleTest::onRun() {
+
+  char directoryTemplate[] = "/tmp/oatpp-libressl-ocsp-XXXXXX";
+  OATPP_ASSERT(mkdtemp(directoryTemplate) != nullptr);
+  std::string stapleFile = std::string(directoryTemplate) + "/staple.der";
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-ocsp");
+
+  auto configFactory = [] {
+    return oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  };
+
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    configFactory(),
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  oatpp::libressl::server::OcspStapleRefresher refresher(
+    serverProvider,
+    configFactory,
+    oatpp::libressl::server::OcspStapleRefresher::createFileSource(stapleFile.c_str()),
+    std::chrono::milliseconds(20),
+    std::chrono::milliseconds(20)
+  );
+
+  { // no response yet
+    OATPP_ASSERT(!refresher.refresh());
+    OATPP_ASSERT(refresher.getFailuresCount() == 1);
+    OATPP_ASSERT(!serverProvider->getConfig()->getOcspStaple());
+  }
+
+  { // first response is installed with a config swap
+    publish(stapleFile, "response-1");
+    auto reloads = serverProvider->getReloadsCount();
+    OATPP_ASSERT(refresher.refresh());
+    OATPP_ASSERT(refresher.getRefreshesCount() == 1);
+    OATPP_ASSERT(serverProvider->getReloadsCount() == reloads + 1);
+    OATPP_ASSERT(serverProvider->getConfig()->getOcspStaple() == "response-1");
+  }
+
+  { // unchanged response is not reinstalled
+    auto reloads = serverProvider->getReloadsCount();
+    OATPP_ASSERT(refresher.refresh());
+    OATPP_ASSERT(refresher.getRefreshesCount() == 1);
+    OATPP_ASSERT(serverProvider->getReloadsCount() == reloads);
+  }
+
+  { // background refresh picks up the new response
+    refresher.start();
+    publish(stapleFile, "response-2");
+    for(v_int32 i = 0; i < 100 && refresher.getRefreshesCount() < 2; i ++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    refresher.stop();
+    OATPP_ASSERT(refresher.getRefreshesCount() == 2);
+    OATPP_ASSERT(refresher.getStaple() == "response-2");
+    OATPP_ASSERT(serverProvider->getConfig()->getOcspStaple() == "response-2");
+  }
+
+  /* not a real OCSP response - refresh falls back to the refresh interval */
+  OATPP_ASSERT(oatpp::libressl::server::OcspStapleRefresher::getSecondsToNextUpdate("response-2") < 0);
+
+  serverProvider->stop();
+
+  unlink(stapleFile.c_str());
+  rmdir(directoryTemplate);
+
+}
+
+}}}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "PrometheusExporterTest.hpp"
+
+#include "oatpp-libressl/PrometheusExporter.hpp"
+
+#include <cstring>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+bool contains(const oatpp::String& text, const char* line) {
+  return text->find(std::string(line) + "\n") != std::string::npos;
+}
+
+}
+
+void PrometheusExporterTest::onRun() {
+
+  auto https = oatpp::libressl::ConnectionStatistics::createShared(2);
+  auto internal = oatpp::libressl::ConnectionStatistics::createShared(2);
+
+  for(v_int32 i = 0; i < 3; i ++) {
+    https->onConnectionOpened();
+  }
+
+  https->onHandshake(false, 1500);
+  https->onHandshake(false, 3000);
+  https->onHandshake(true, 200);
+  https->onHandshakeFailed(oatpp::libressl::Connection::HandshakeFailure::PROTOCOL);
+  https->onHandshakeFailed(oatpp::libressl::Connection::HandshakeFailure::TRANSPORT);
+  https->onHandshakeFailed(oatpp::libressl::Connection::HandshakeFailure::TRANSPORT);
+
+  https->onTlsRead(5, 1000);
+  https->onTlsWrite(7, 4096);
+
+  oatpp::libressl::Connection::Metrics metrics;
+  std::memset(&metrics, 0, sizeof(metrics));
+  metrics.ciphertextBytesRead = 2000;
+  metrics.ciphertextBytesWritten = 6000;
+  https->onConnectionClosed(metrics);
+
+  auto exporter = oatpp::libressl::PrometheusExporter::createShared();
+  exporter->addStatistics("https", https);
+  exporter->addStatistics("in\"ternal", internal);
+
+  auto text = exporter->render();
+  OATPP_LOGD(TAG, "\n%s", text->c_str());
+
+  OATPP_ASSERT(contains(text, "# TYPE oatpp_libressl_handshakes_total counter"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_connections_opened_total{provider=\"https\"} 3"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_connections_closed_total{provider=\"https\"} 1"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_connections_live{provider=\"https\"} 2"));
+
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshakes_total{provider=\"https\",type=\"full\"} 2"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshakes_total{provider=\"https\",type=\"resumed\"} 1"));
+
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_failures_total{provider=\"https\",reason=\"protocol\"} 1"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_failures_total{provider=\"https\",reason=\"peer_verification\"} 0"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_failures_total{provider=\"https\",reason=\"transport\"} 2"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_failures_total{provider=\"https\",reason=\"server_name\"} 0"));
+
+  OATPP_ASSERT(contains(text, "oatpp_libressl_bytes_encrypted_total{provider=\"https\"} 4096"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_bytes_decrypted_total{provider=\"https\"} 1000"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_ciphertext_bytes_total{provider=\"https\",direction=\"write\"} 6000"));
+
+  /* 1500 and 3000 micro fall into [1024, 2048) and [2048, 4096) */
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_bucket{provider=\"https\",type=\"full\",le=\"0.001024\"} 0"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_bucket{provider=\"https\",type=\"full\",le=\"0.002048\"} 1"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_bucket{provider=\"https\",type=\"full\",le=\"0.004096\"} 2"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_bucket{provider=\"https\",type=\"full\",le=\"+Inf\"} 2"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_sum{provider=\"https\",type=\"full\"} 0.004500"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_count{provider=\"https\",type=\"full\"} 2"));
+  OATPP_ASSERT(contains(text, "oatpp_libressl_handshake_duration_seconds_count{provider=\"https\",type=\"resumed\"} 1"));
+
+  OATPP_ASSERT(contains(text, "oatpp_libressl_io_duration_seconds_count{provider=\"https\",operation=\"write\"} 1"));
+
+  /* label values are escaped */
+  OATPP_ASSERT(contains(text, "oatpp_libressl_connections_live{provider=\"in\\\"ternal\"} 0"));
+
+  /* HELP and TYPE are written once per metric */
+  auto first = text->find("# TYPE oatpp_libressl_connections_live gauge");
+  OATPP_ASSERT(first != std::string::npos);
+  OATPP_ASSERT(text->find("# TYPE oatpp_libressl_connections_live gauge", first + 1) == std::string::npos);
+
+}
+
+}}}
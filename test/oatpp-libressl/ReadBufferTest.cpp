@@ -0,0 +1,150 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ReadBufferTest.hpp"
+
+#include "app/TransportProbe.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+/* small enough for all records to fit the virtual pipe before the client starts reading */
+const v_int32 RECORDS = 20;
+const v_buff_size RECORD_PAYLOAD = 64;
+const v_buff_size READ_CHUNK = 8;
+
+struct ReadCounters {
+  v_int64 transportReads;
+  v_int64 tlsReads;
+};
+
+ReadCounters readRecords(const char* tag, v_buff_size readAheadSize, v_buff_size readBufferSize) {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-read-buffer");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  clientConfig->setReadAheadBufferSize(readAheadSize);
+  clientConfig->setReadBufferSize(readBufferSize);
+
+  auto probeProvider = std::make_shared<app::ProbeConnectionProvider>(
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(clientConfig, probeProvider);
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  /* one tls_write - one record */
+  v_char8 payload[RECORD_PAYLOAD];
+  for(v_int32 i = 0; i < RECORDS; i ++) {
+    for(v_buff_size j = 0; j < RECORD_PAYLOAD; j ++) {
+      payload[j] = (v_char8) (i + j);
+    }
+    OATPP_ASSERT(serverConnection.object->writeExactSizeDataSimple(payload, RECORD_PAYLOAD) == RECORD_PAYLOAD);
+  }
+
+  auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+  auto probe = probeProvider->getLastStream();
+
+  v_int64 transportReads = probe->readCalls;
+  v_int64 tlsReads = client->getMetrics().tlsReadCalls;
+
+  for(v_int32 i = 0; i < RECORDS; i ++) {
+    for(v_buff_size j = 0; j < RECORD_PAYLOAD; j += READ_CHUNK) {
+
+      v_char8 chunk[READ_CHUNK];
+      OATPP_ASSERT(client->readExactSizeDataSimple(chunk, READ_CHUNK) == READ_CHUNK);
+      for(v_buff_size k = 0; k < READ_CHUNK; k ++) {
+        OATPP_ASSERT(chunk[k] == (v_char8) (i + j + k));
+      }
+
+      /* tls_read returns one record at most - the rest of it is pending in the plaintext buffer */
+      if(readBufferSize > 0) {
+        OATPP_ASSERT(client->getPendingBytes() == RECORD_PAYLOAD - j - READ_CHUNK);
+      } else {
+        OATPP_ASSERT(client->getPendingBytes() == 0);
+      }
+
+    }
+  }
+
+  ReadCounters result;
+  result.transportReads = probe->readCalls - transportReads;
+  result.tlsReads = client->getMetrics().tlsReadCalls - tlsReads;
+
+  OATPP_LOGD(tag, "transport reads=%lld, tls_read calls=%lld", (long long) result.transportReads, (long long) result.tlsReads);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+  return result;
+
+}
+
+}
+
+void ReadBufferTest::onRun() {
+
+  auto plain = readRecords("plain", 0, 0);
+  auto readAhead = readRecords("read-ahead", 16 * 1024, 0);
+  auto readBuffer = readRecords("read-buffer", 0, 16 * 1024);
+
+  /* without read-ahead libtls reads record header and record body separately */
+  OATPP_ASSERT(plain.transportReads >= 2 * RECORDS);
+  OATPP_ASSERT(readAhead.transportReads <= RECORDS / 2);
+
+  /* without plaintext buffer each small read is a tls_read call */
+  OATPP_ASSERT(plain.tlsReads >= RECORDS * (RECORD_PAYLOAD / READ_CHUNK));
+  OATPP_ASSERT(readBuffer.tlsReads <= RECORDS + 2);
+
+}
+
+}}}
@@ -0,0 +1,169 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "RecordSizePolicyTest.hpp"
+
+#include "app/TransportProbe.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+const v_buff_size SMALL_RECORD_SIZE = 1400;
+const v_int64 BYTES_THRESHOLD = 4096;
+const v_int64 IDLE_TIMEOUT_MICRO = 20 * 1000;
+const v_buff_size LARGE_WRITE_SIZE = 16 * 1024;
+
+v_char8 patternByte(v_int64 position) {
+  return (v_char8) (position % 253);
+}
+
+void readPattern(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int64 total, std::atomic<bool>* valid) {
+  v_char8 buffer[4096];
+  v_int64 progress = 0;
+  while(progress < total) {
+    v_buff_size size = sizeof(buffer);
+    if(size > total - progress) {
+      size = (v_buff_size) (total - progress);
+    }
+    auto res = stream->readSimple(buffer, size);
+    if(res <= 0) {
+      return;
+    }
+    for(v_io_size i = 0; i < res; i ++) {
+      if(buffer[i] != patternByte(progress + i)) {
+        return;
+      }
+    }
+    progress += res;
+  }
+  *valid = true;
+}
+
+/*
+ * Write in async mode. Retries reported by the transport itself (virtual pipe is full) are repeated until done.
+ * Returns the first result which is not such a retry.
+ */
+v_io_size writeAsync(const std::shared_ptr<oatpp::libressl::Connection>& connection,
+                     const std::shared_ptr<app::ProbeStream>& probe,
+                     const v_char8* data, v_buff_size count)
+{
+  while(true) {
+    bool injected = probe->writeRetries > 0;
+    async::Action action;
+    auto res = connection->write(data, count, action);
+    if((res == IOError::RETRY_READ || res == IOError::RETRY_WRITE) && !injected) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    return res;
+  }
+}
+
+}
+
+void RecordSizePolicyTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-record-size");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  clientConfig->setRecordSizePolicy(oatpp::libressl::Config::RecordSizePolicy(SMALL_RECORD_SIZE, BYTES_THRESHOLD, IDLE_TIMEOUT_MICRO));
+
+  auto probeProvider = std::make_shared<app::ProbeConnectionProvider>(
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(clientConfig, probeProvider);
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+  auto probe = probeProvider->getLastStream();
+  client->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+
+  std::unique_ptr<v_char8[]> data(new v_char8[BYTES_THRESHOLD + 2 * LARGE_WRITE_SIZE]);
+  v_int64 total = BYTES_THRESHOLD + LARGE_WRITE_SIZE;
+  for(v_int64 i = 0; i < total; i ++) {
+    data[i] = patternByte(i);
+  }
+
+  std::atomic<bool> valid(false);
+  std::thread reader(readPattern, serverConnection.object, total, &valid);
+
+  /* new connection - small records until the threshold */
+  v_int64 progress = 0;
+  while(progress < BYTES_THRESHOLD) {
+    auto res = writeAsync(client, probe, data.get() + progress, BYTES_THRESHOLD - progress);
+    OATPP_ASSERT(res > 0 && res <= SMALL_RECORD_SIZE);
+    progress += res;
+  }
+
+  /* max-size record - transport is congested and the write is retried after the connection went idle */
+  probe->writeRetries = 1;
+  auto res = writeAsync(client, probe, data.get() + progress, LARGE_WRITE_SIZE);
+  OATPP_ASSERT(res == IOError::RETRY_WRITE);
+
+  std::this_thread::sleep_for(std::chrono::microseconds(IDLE_TIMEOUT_MICRO * 3));
+
+  res = writeAsync(client, probe, data.get() + progress, LARGE_WRITE_SIZE);
+  OATPP_LOGD(TAG, "retried write result=%lld", (long long) res);
+  OATPP_ASSERT(res == LARGE_WRITE_SIZE);
+
+  reader.join();
+  OATPP_ASSERT(valid);
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+}
+
+}}}
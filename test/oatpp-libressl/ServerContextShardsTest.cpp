@@ -0,0 +1,174 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "ServerContextShardsTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+std::shared_ptr<oatpp::libressl::server::ConnectionProvider>
+createServerProvider(const std::shared_ptr<oatpp::network::virtual_::Interface>& interface, v_int32 shards) {
+  auto config = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  config->setServerContextShards(shards);
+  return oatpp::libressl::server::ConnectionProvider::createShared(
+    config,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+}
+
+/*
+ * Handshake `connectionsPerThread` connections on each of `threads` server threads concurrently.
+ * Returns handshakes per second. Failed handshakes are counted in `failures`.
+ */
+v_float64 measure(const std::shared_ptr<oatpp::libressl::server::ConnectionProvider>& serverProvider,
+                  const std::shared_ptr<oatpp::libressl::client::ConnectionProvider>& clientProvider,
+                  v_int32 threads, v_int32 connectionsPerThread,
+                  std::atomic<v_int32>* failures)
+{
+
+  std::vector<std::thread> workers;
+
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+
+  for(v_int32 t = 0; t < threads; t ++) {
+
+    workers.push_back(std::thread([serverProvider, connectionsPerThread, failures] {
+      for(v_int32 i = 0; i < connectionsPerThread; i ++) {
+        auto connection = serverProvider->get();
+        connection.object->initContexts();
+        auto c = std::static_pointer_cast<oatpp::libressl::Connection>(connection.object);
+        if(c->getHandshakeState() != oatpp::libressl::Connection::HandshakeState::COMPLETE) {
+          (*failures) ++;
+        }
+        connection.invalidator->invalidate(connection.object);
+      }
+    }));
+
+    workers.push_back(std::thread([clientProvider, connectionsPerThread, failures] {
+      for(v_int32 i = 0; i < connectionsPerThread; i ++) {
+        try {
+          auto connection = clientProvider->get();
+          connection.invalidator->invalidate(connection.object);
+        } catch (std::runtime_error&) {
+          (*failures) ++;
+        }
+      }
+    }));
+
+  }
+
+  for(auto& worker : workers) {
+    worker.join();
+  }
+
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+  return (v_float64) threads * connectionsPerThread * 1000 * 1000 / (v_float64) (ticks > 0 ? ticks : 1);
+
+}
+
+}
+
+void ServerContextShardsTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-shards");
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    oatpp::libressl::Config::createDefaultClientConfigShared(),
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  { // connections accepted on the same thread still go to all shards - evenly
+
+    const v_int32 shards = 4;
+    const v_int32 rounds = 3;
+
+    auto serverProvider = createServerProvider(interface, shards);
+    std::map<oatpp::libressl::TLSObject*, v_int32> usage;
+
+    for(v_int32 i = 0; i < shards * rounds; i ++) {
+
+      StreamHandle serverConnection;
+      std::thread acceptThread([&serverProvider, &serverConnection]{
+        serverConnection = serverProvider->get();
+        serverConnection.object->initContexts();
+      });
+
+      auto clientConnection = clientProvider->get();
+      acceptThread.join();
+
+      auto c = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+      OATPP_ASSERT(c->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+      usage[c->getTLSObject().get()] ++;
+
+      clientConnection.invalidator->invalidate(clientConnection.object);
+      serverConnection.invalidator->invalidate(serverConnection.object);
+
+    }
+
+    OATPP_ASSERT((v_int32) usage.size() == shards);
+    for(auto& pair : usage) {
+      OATPP_ASSERT(pair.second == rounds);
+    }
+
+    serverProvider->stop();
+
+  }
+
+  { // concurrent handshakes - one shared context vs. a context per thread
+
+    std::atomic<v_int32> failures(0);
+
+    auto singleProvider = createServerProvider(interface, 1);
+    auto singleRate = measure(singleProvider, clientProvider, m_threads, m_connectionsPerThread, &failures);
+    singleProvider->stop();
+
+    auto shardedProvider = createServerProvider(interface, m_threads);
+    auto shardedRate = measure(shardedProvider, clientProvider, m_threads, m_connectionsPerThread, &failures);
+    shardedProvider->stop();
+
+    /* rates are logged, not asserted - the difference depends on the libressl build and the machine */
+    OATPP_LOGD(TAG, "threads=%d, handshakes/sec: one context=%f, %d contexts=%f", m_threads, singleRate, m_threads, shardedRate);
+    OATPP_ASSERT(failures == 0);
+
+  }
+
+}
+
+}}}
@@ -0,0 +1,217 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "SessionResumptionTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/Connection.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <atomic>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+struct HandshakeResult {
+  bool resumed;
+  v_int64 serverDuration;
+};
+
+HandshakeResult connect(const std::shared_ptr<oatpp::libressl::server::ConnectionProvider>& serverProvider,
+                        const std::shared_ptr<oatpp::libressl::client::ConnectionProvider>& clientProvider)
+{
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  OATPP_ASSERT(serverConnection);
+  OATPP_ASSERT(clientConnection);
+
+  auto server = std::static_pointer_cast<oatpp::libressl::Connection>(serverConnection.object);
+  auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+
+  OATPP_ASSERT(server->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+  OATPP_ASSERT(client->getHandshakeState() == oatpp::libressl::Connection::HandshakeState::COMPLETE);
+
+  HandshakeResult result;
+  result.resumed = tls_conn_session_resumed(client->getTlsHandle()) == 1;
+  result.serverDuration = server->getHandshakeDuration();
+
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  clientConnection.invalidator->invalidate(clientConnection.object);
+
+  return result;
+
+}
+
+std::shared_ptr<oatpp::libressl::client::ConnectionProvider>
+createClientProvider(const std::shared_ptr<oatpp::network::virtual_::Interface>& interface,
+                     const std::shared_ptr<oatpp::libressl::client::SessionCache>& sessionCache)
+{
+
+  /* config is bound to the session file - one config per upstream */
+  auto config = oatpp::libressl::Config::createDefaultClientConfigShared();
+  config->setProtocols(TLS_PROTOCOL_TLSv1_2);
+
+  auto provider = oatpp::libressl::client::ConnectionProvider::createShared(
+    config,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  provider->setSessionCache(sessionCache);
+  return provider;
+
+}
+
+}
+
+void SessionResumptionTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-resumption");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  /* LibreSSL resumes TLS 1.2 sessions only */
+  serverConfig->setProtocols(TLS_PROTOCOL_TLSv1_2);
+  serverConfig->setSessionId("oatpp-libressl-test");
+  serverConfig->setSessionLifetime(300);
+
+  /* handshakes lock ticket keys only once there are keys to rotate */
+  OATPP_ASSERT(!serverConfig->getTicketKeysLock());
+  serverConfig->startTicketKeyRotation(std::chrono::seconds(60));
+  OATPP_ASSERT(serverConfig->getTicketKeysLock());
+
+  auto transportProvider = oatpp::network::virtual_::server::ConnectionProvider::createShared(interface);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(serverConfig, transportProvider);
+
+  auto sessionCache = oatpp::libressl::client::SessionCache::createShared();
+  auto clientProvider = createClientProvider(interface, sessionCache);
+
+  auto first = connect(serverProvider, clientProvider);
+  OATPP_ASSERT(!first.resumed);
+
+  v_int64 fullTime = first.serverDuration;
+  v_int64 resumedTime = 0;
+
+  for(v_int32 i = 0; i < m_iterations; i ++) {
+    auto result = connect(serverProvider, clientProvider);
+    OATPP_ASSERT(result.resumed);
+    resumedTime += result.serverDuration;
+  }
+
+  resumedTime /= m_iterations;
+
+  OATPP_LOGD(TAG, "full handshake=%lld(micro), resumed handshake=%lld(micro)", (long long) fullTime, (long long) resumedTime);
+  OATPP_ASSERT(resumedTime < fullTime);
+
+  /* tickets issued with the previous key are still accepted after rotation */
+  serverConfig->rotateTicketKey();
+  OATPP_ASSERT(connect(serverProvider, clientProvider).resumed);
+
+  OATPP_LOGD(TAG, "client session cache hit rate=%f", sessionCache->getHitRate());
+  OATPP_ASSERT(sessionCache->getFullCount() == 1);
+  OATPP_ASSERT(sessionCache->getResumedCount() == m_iterations + 1);
+
+  { // handshake waiting for its peer doesn't hold the session file - other handshakes to the upstream go on
+
+    std::atomic<bool> stalledFailed(false);
+    std::thread stalledThread([&clientProvider, &stalledFailed]{
+      try {
+        clientProvider->get();
+      } catch (std::runtime_error&) {
+        stalledFailed = true;
+      }
+    });
+
+    /* take the transport of the stalled client - its ClientHello is never answered */
+    auto rawConnection = transportProvider->get();
+    v_char8 header[5];
+    OATPP_ASSERT(rawConnection.object->readExactSizeDataSimple(header, 5) == 5);
+
+    OATPP_ASSERT(connect(serverProvider, clientProvider).resumed);
+
+    rawConnection.invalidator->invalidate(rawConnection.object);
+    stalledThread.join();
+    OATPP_ASSERT(stalledFailed);
+
+  }
+
+  { // config is bound to the session file of one upstream
+
+    auto otherInterface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-resumption-other");
+    auto config = oatpp::libressl::Config::createDefaultClientConfigShared();
+
+    auto provider = oatpp::libressl::client::ConnectionProvider::createShared(
+      config,
+      oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+    );
+    auto otherProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+      config,
+      oatpp::network::virtual_::client::ConnectionProvider::createShared(otherInterface)
+    );
+
+    provider->setSessionCache(sessionCache);
+
+    bool thrown = false;
+    try {
+      otherProvider->setSessionCache(sessionCache);
+    } catch (std::runtime_error&) {
+      thrown = true;
+    }
+    OATPP_ASSERT(thrown);
+
+  }
+
+  { // expired sessions are not resumed
+
+    auto expiringCache = oatpp::libressl::client::SessionCache::createShared(16, std::chrono::seconds(0));
+    auto expiringProvider = createClientProvider(interface, expiringCache);
+
+    OATPP_ASSERT(!connect(serverProvider, expiringProvider).resumed);
+    OATPP_ASSERT(!connect(serverProvider, expiringProvider).resumed);
+    OATPP_ASSERT(expiringCache->getExpiredCount() == 1);
+
+  }
+
+  serverConfig->stopTicketKeyRotation();
+  serverProvider->stop();
+
+}
+
+}}}
@@ -0,0 +1,182 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "TrustStoreBenchmarkTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+/* system CA bundles - used to make the trusted set realistically big */
+const char* const SYSTEM_CA_BUNDLES[] = {
+  "/etc/ssl/certs/ca-certificates.crt",
+  "/etc/pki/tls/certs/ca-bundle.crt",
+  "/etc/ssl/cert.pem",
+  nullptr
+};
+
+oatpp::String loadSystemBundle() {
+  for(v_int32 i = 0; SYSTEM_CA_BUNDLES[i] != nullptr; i ++) {
+    auto bundle = oatpp::String::loadFromFile(SYSTEM_CA_BUNDLES[i]);
+    if(bundle) {
+      return bundle;
+    }
+  }
+  return nullptr;
+}
+
+bool connect(const std::shared_ptr<oatpp::libressl::server::ConnectionProvider>& serverProvider,
+             const std::shared_ptr<oatpp::libressl::client::ConnectionProvider>& clientProvider)
+{
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection;
+  try {
+    clientConnection = clientProvider->get();
+  } catch (std::runtime_error& e) {
+    OATPP_LOGD("TrustStoreBenchmarkTest", "connect failed: %s", e.what());
+  }
+
+  acceptThread.join();
+
+  if(clientConnection) {
+    clientConnection.invalidator->invalidate(clientConnection.object);
+  }
+  serverConnection.invalidator->invalidate(serverConnection.object);
+
+  return (bool) clientConnection;
+
+}
+
+std::shared_ptr<oatpp::libressl::client::ConnectionProvider>
+createClientProvider(const std::shared_ptr<oatpp::network::virtual_::Interface>& interface,
+                     const std::shared_ptr<oatpp::libressl::Config>& config)
+{
+  /* test certificate is not issued for the virtual host name */
+  tls_config_insecure_noverifyname(config->getTLSConfig());
+  return oatpp::libressl::client::ConnectionProvider::createShared(
+    config,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+}
+
+v_float64 measure(const std::shared_ptr<oatpp::libressl::server::ConnectionProvider>& serverProvider,
+                  const std::shared_ptr<oatpp::libressl::client::ConnectionProvider>& clientProvider,
+                  v_int32 connections)
+{
+  auto startTick = oatpp::base::Environment::getMicroTickCount();
+  for(v_int32 i = 0; i < connections; i ++) {
+    OATPP_ASSERT(connect(serverProvider, clientProvider));
+  }
+  auto ticks = oatpp::base::Environment::getMicroTickCount() - startTick;
+  return (v_float64) connections * 1000 * 1000 / (v_float64) (ticks > 0 ? ticks : 1);
+}
+
+}
+
+void TrustStoreBenchmarkTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-trust-store");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto testCert = oatpp::String::loadFromFile(CERT_CRT_PATH);
+  OATPP_ASSERT(testCert);
+
+  auto systemBundle = loadSystemBundle();
+
+  std::string bundle(testCert->data(), testCert->size());
+  if(systemBundle) {
+    bundle.append("\n");
+    bundle.append(systemBundle->data(), systemBundle->size());
+  }
+
+  v_float64 libtlsRate;
+  v_float64 sharedRate;
+
+  { // libtls verification - CA bundle is parsed for each connection
+    auto config = oatpp::libressl::Config::createShared();
+    OATPP_ASSERT(tls_config_set_ca_mem(config->getTLSConfig(), (const uint8_t*) bundle.data(), bundle.size()) == 0);
+    auto clientProvider = createClientProvider(interface, config);
+    libtlsRate = measure(serverProvider, clientProvider, m_connections);
+  }
+
+  { // shared trust store - CA bundle is parsed once
+    auto trustStore = oatpp::libressl::TrustStore::createFromPem(oatpp::String(bundle));
+    OATPP_LOGD(TAG, "trusted certificates=%lld", (long long) trustStore->getCertificatesCount());
+    auto config = oatpp::libressl::Config::createShared();
+    config->setTrustStore(trustStore);
+    auto clientProvider = createClientProvider(interface, config);
+    sharedRate = measure(serverProvider, clientProvider, m_connections);
+  }
+
+  OATPP_LOGD(TAG, "connects/sec: libtls CA bundle=%f, shared trust store=%f", libtlsRate, sharedRate);
+
+  auto untrustedCa = oatpp::String::loadFromFile(CERT_UNTRUSTED_CA_PATH);
+  OATPP_ASSERT(untrustedCa);
+
+  { // untrusted chain is rejected
+    auto config = oatpp::libressl::Config::createShared();
+    config->setTrustStore(oatpp::libressl::TrustStore::createFromPem(untrustedCa));
+    auto clientProvider = createClientProvider(interface, config);
+    OATPP_ASSERT(!connect(serverProvider, clientProvider));
+  }
+
+  { // cleared trust store doesn't leave the config unverified - libtls verification is back on
+    auto config = oatpp::libressl::Config::createShared();
+    OATPP_ASSERT(tls_config_set_ca_mem(config->getTLSConfig(), (const uint8_t*) untrustedCa->data(), untrustedCa->size()) == 0);
+    config->setTrustStore(oatpp::libressl::TrustStore::createFromPem(oatpp::String(bundle)));
+    config->setTrustStore(nullptr);
+    OATPP_ASSERT(!config->getTrustStore());
+    auto clientProvider = createClientProvider(interface, config);
+    OATPP_ASSERT(!connect(serverProvider, clientProvider));
+  }
+
+  serverProvider->stop();
+
+}
+
+}}}
@@ -0,0 +1,262 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#include "WriteBufferTest.hpp"
+
+#include "oatpp-libressl/client/ConnectionProvider.hpp"
+#include "oatpp-libressl/server/ConnectionProvider.hpp"
+
+#include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/server/ConnectionProvider.hpp"
+#include "oatpp/network/virtual_/Interface.hpp"
+
+#include "oatpp/core/async/Executor.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace oatpp { namespace test { namespace libressl {
+
+namespace {
+
+typedef oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> StreamHandle;
+
+const v_int32 PIECES = 50;
+const v_buff_size PIECE_SIZE = 100;
+
+void fillPiece(v_char8* buffer, v_int32 index) {
+  for(v_buff_size i = 0; i < PIECE_SIZE; i ++) {
+    buffer[i] = (v_char8) (index * 7 + i);
+  }
+}
+
+void readPieces(const std::shared_ptr<oatpp::data::stream::IOStream>& stream, v_int32 count, std::atomic<bool>* valid) {
+  v_char8 expected[PIECE_SIZE];
+  v_char8 buffer[PIECE_SIZE];
+  bool result = true;
+  for(v_int32 i = 0; i < count; i ++) {
+    fillPiece(expected, i);
+    if(stream->readExactSizeDataSimple(buffer, PIECE_SIZE) != PIECE_SIZE || std::memcmp(buffer, expected, PIECE_SIZE) != 0) {
+      result = false;
+      break;
+    }
+  }
+  *valid = result;
+}
+
+v_int64 getRecordsWritten(const std::shared_ptr<oatpp::libressl::Connection>& connection) {
+  return connection->getMetrics().recordsWritten;
+}
+
+class CorkedWriterCoroutine : public oatpp::async::Coroutine<CorkedWriterCoroutine> {
+private:
+  std::shared_ptr<oatpp::libressl::Connection> m_connection;
+  v_int32 m_index;
+  v_char8 m_buffer[PIECE_SIZE];
+public:
+
+  CorkedWriterCoroutine(const std::shared_ptr<oatpp::libressl::Connection>& connection)
+    : m_connection(connection)
+    , m_index(0)
+  {}
+
+  Action act() override {
+    m_connection->cork();
+    return yieldTo(&CorkedWriterCoroutine::writePiece);
+  }
+
+  Action writePiece() {
+
+    if(m_index == PIECES) {
+      OATPP_ASSERT(m_connection->getUnflushedBytes() == PIECES * PIECE_SIZE);
+      return m_connection->flushAsync().next(yieldTo(&CorkedWriterCoroutine::onFlushed));
+    }
+
+    fillPiece(m_buffer, m_index);
+
+    async::Action action;
+    auto res = m_connection->write(m_buffer, PIECE_SIZE, action);
+
+    if(!action.isNone()) {
+      return action;
+    }
+
+    if(res == PIECE_SIZE) {
+      m_index ++;
+      return repeat();
+    }
+
+    return error<Error>("[CorkedWriterCoroutine::writePiece()]: Error. Corked write must be accepted by the buffer.");
+
+  }
+
+  Action onFlushed() {
+    OATPP_ASSERT(m_connection->getUnflushedBytes() == 0);
+    return finish();
+  }
+
+};
+
+}
+
+void WriteBufferTest::onRun() {
+
+  auto interface = oatpp::network::virtual_::Interface::obtainShared("virtualhost-write-buffer");
+
+  auto serverConfig = oatpp::libressl::Config::createDefaultServerConfigShared(CERT_CRT_PATH, CERT_PEM_PATH);
+  auto serverProvider = oatpp::libressl::server::ConnectionProvider::createShared(
+    serverConfig,
+    oatpp::network::virtual_::server::ConnectionProvider::createShared(interface)
+  );
+
+  auto clientConfig = oatpp::libressl::Config::createDefaultClientConfigShared();
+  clientConfig->setWriteBufferSize(16 * 1024);
+
+  auto clientProvider = oatpp::libressl::client::ConnectionProvider::createShared(
+    clientConfig,
+    oatpp::network::virtual_::client::ConnectionProvider::createShared(interface)
+  );
+
+  StreamHandle serverConnection;
+
+  std::thread acceptThread([&serverProvider, &serverConnection]{
+    serverConnection = serverProvider->get();
+    serverConnection.object->initContexts();
+  });
+
+  StreamHandle clientConnection = clientProvider->get();
+  acceptThread.join();
+
+  auto client = std::static_pointer_cast<oatpp::libressl::Connection>(clientConnection.object);
+  v_char8 pieces[PIECES][PIECE_SIZE];
+  for(v_int32 i = 0; i < PIECES; i ++) {
+    fillPiece(pieces[i], i);
+  }
+
+  { // uncorked writes are not buffered
+    std::atomic<bool> valid(false);
+    std::thread reader(readPieces, serverConnection.object, PIECES, &valid);
+
+    auto records = getRecordsWritten(client);
+    for(v_int32 i = 0; i < PIECES; i ++) {
+      OATPP_ASSERT(client->writeExactSizeDataSimple(pieces[i], PIECE_SIZE) == PIECE_SIZE);
+      OATPP_ASSERT(client->getUnflushedBytes() == 0);
+    }
+    OATPP_ASSERT(getRecordsWritten(client) - records == PIECES);
+
+    reader.join();
+    OATPP_ASSERT(valid);
+  }
+
+  { // corked writes - one record on flush
+    std::atomic<bool> valid(false);
+    std::thread reader(readPieces, serverConnection.object, PIECES, &valid);
+
+    auto records = getRecordsWritten(client);
+    client->cork();
+    for(v_int32 i = 0; i < PIECES; i ++) {
+      OATPP_ASSERT(client->writeExactSizeDataSimple(pieces[i], PIECE_SIZE) == PIECE_SIZE);
+    }
+    OATPP_ASSERT(client->getUnflushedBytes() == PIECES * PIECE_SIZE);
+    OATPP_ASSERT(getRecordsWritten(client) == records);
+
+    OATPP_ASSERT(client->flush() == 0);
+    OATPP_ASSERT(client->getUnflushedBytes() == 0);
+    OATPP_ASSERT(getRecordsWritten(client) - records == 1);
+
+    reader.join();
+    OATPP_ASSERT(valid);
+  }
+
+  oatpp::libressl::Connection::WriteVector vectors[PIECES];
+  for(v_int32 i = 0; i < PIECES; i ++) {
+    vectors[i].data = pieces[i];
+    vectors[i].size = PIECE_SIZE;
+  }
+
+  { // vectored write - uncorked, each buffer goes to tls_write
+    std::atomic<bool> valid(false);
+    std::thread reader(readPieces, serverConnection.object, PIECES, &valid);
+
+    auto records = getRecordsWritten(client);
+    v_io_size written = 0;
+    while(written < PIECES * PIECE_SIZE) {
+      v_int32 first = (v_int32) (written / PIECE_SIZE);
+      async::Action action;
+      auto res = client->writeVectored(vectors + first, PIECES - first, action);
+      OATPP_ASSERT(res > 0 && res % PIECE_SIZE == 0);
+      written += res;
+    }
+    OATPP_ASSERT(getRecordsWritten(client) - records == PIECES);
+
+    reader.join();
+    OATPP_ASSERT(valid);
+  }
+
+  { // vectored write - corked, all buffers in one record
+    std::atomic<bool> valid(false);
+    std::thread reader(readPieces, serverConnection.object, PIECES, &valid);
+
+    auto records = getRecordsWritten(client);
+    client->cork();
+    async::Action action;
+    OATPP_ASSERT(client->writeVectored(vectors, PIECES, action) == PIECES * PIECE_SIZE);
+    OATPP_ASSERT(client->flush() == 0);
+    OATPP_ASSERT(getRecordsWritten(client) - records == 1);
+
+    reader.join();
+    OATPP_ASSERT(valid);
+  }
+
+  { // corked writes and flushAsync on the executor
+    std::atomic<bool> valid(false);
+    std::thread reader(readPieces, serverConnection.object, PIECES, &valid);
+
+    client->setOutputStreamIOMode(oatpp::data::stream::IOMode::ASYNCHRONOUS);
+    auto records = getRecordsWritten(client);
+
+    {
+      oatpp::async::Executor executor(1, 1, 1);
+      executor.execute<CorkedWriterCoroutine>(client);
+      executor.waitTasksFinished();
+      executor.stop();
+      executor.join();
+    }
+
+    OATPP_ASSERT(client->getUnflushedBytes() == 0);
+    OATPP_ASSERT(getRecordsWritten(client) - records == 1);
+
+    reader.join();
+    OATPP_ASSERT(valid);
+  }
+
+  clientConnection.invalidator->invalidate(clientConnection.object);
+  serverConnection.invalidator->invalidate(serverConnection.object);
+  serverProvider->stop();
+
+}
+
+}}}
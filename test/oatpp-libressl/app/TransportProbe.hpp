@@ -0,0 +1,239 @@
+/***************************************************************************
+ *
+ * Project         _____    __   ____   _      _
+ *                (  _  )  /__\ (_  _)_| |_  _| |_
+ *                 )(_)(  /(__)\  )( (_   _)(_   _)
+ *                (_____)(__)(__)(__)  |_|    |_|
+ *
+ *
+ * Copyright 2018-present, Leonid Stryzhevskyi <lganzzzo@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************************/
+
+
+#ifndef oatpp_test_libressl_app_TransportProbe_hpp
+#define oatpp_test_libressl_app_TransportProbe_hpp
+
+#include "oatpp/network/ConnectionProvider.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace oatpp { namespace test { namespace libressl { namespace app {
+
+/**
+ * Transport stream wrapper. Counts transport calls made by the TLS connection, can simulate a congested transport
+ * and can split the first handshake record into several records.
+ */
+class ProbeStream : public oatpp::data::stream::IOStream {
+private:
+  provider::ResourceHandle<oatpp::data::stream::IOStream> m_stream;
+  std::string m_handshakeRecord;
+private:
+
+  /* split the first handshake record into records of handshakeFragmentSize payload bytes */
+  v_io_size writeFragmented(const void *data, v_buff_size count) {
+
+    m_handshakeRecord.append((const char*) data, count);
+    if(m_handshakeRecord.size() < 5) {
+      return count;
+    }
+
+    const v_char8* header = (const v_char8*) m_handshakeRecord.data();
+    v_buff_size payloadSize = (header[3] << 8) | header[4];
+    if((v_buff_size) m_handshakeRecord.size() < 5 + payloadSize) {
+      return count;
+    }
+
+    v_buff_size fragmentSize = handshakeFragmentSize;
+    std::string records;
+    for(v_buff_size pos = 0; pos < payloadSize; pos += fragmentSize) {
+      v_buff_size size = std::min(fragmentSize, payloadSize - pos);
+      records.append((const char*) header, 3);
+      records.push_back((char) (size >> 8));
+      records.push_back((char) (size & 0xFF));
+      records.append(m_handshakeRecord, 5 + pos, size);
+      handshakeFragments ++;
+    }
+    records.append(m_handshakeRecord, 5 + payloadSize, std::string::npos);
+
+    handshakeFragmentSize = 0;
+    m_handshakeRecord.clear();
+
+    if(m_stream.object->writeExactSizeDataSimple(records.data(), records.size()) != (v_io_size) records.size()) {
+      return IOError::BROKEN_PIPE;
+    }
+    return count;
+
+  }
+
+public:
+
+  /**
+   * Number of read calls.
+   */
+  std::atomic<v_int64> readCalls;
+
+  /**
+   * Number of write calls.
+   */
+  std::atomic<v_int64> writeCalls;
+
+  /**
+   * Number of the next write calls to answer with &id:oatpp::IOError::RETRY_WRITE;.
+   */
+  std::atomic<v_int32> writeRetries;
+
+  /**
+   * Payload size of the records to split the next handshake record into. `0` - don't split. <br>
+   * Set before the handshake. Transport must be in blocking mode.
+   */
+  std::atomic<v_buff_size> handshakeFragmentSize;
+
+  /**
+   * Number of records the handshake record was split into.
+   */
+  std::atomic<v_int64> handshakeFragments;
+
+public:
+
+  ProbeStream(const provider::ResourceHandle<oatpp::data::stream::IOStream>& stream)
+    : m_stream(stream)
+    , readCalls(0)
+    , writeCalls(0)
+    , writeRetries(0)
+    , handshakeFragmentSize(0)
+    , handshakeFragments(0)
+  {}
+
+  v_io_size read(void *buff, v_buff_size count, async::Action& action) override {
+    readCalls ++;
+    return m_stream.object->read(buff, count, action);
+  }
+
+  v_io_size write(const void *data, v_buff_size count, async::Action& action) override {
+    writeCalls ++;
+    if(writeRetries > 0) {
+      writeRetries --;
+      return IOError::RETRY_WRITE;
+    }
+    if(handshakeFragmentSize > 0) {
+      return writeFragmented(data, count);
+    }
+    return m_stream.object->write(data, count, action);
+  }
+
+  void setInputStreamIOMode(oatpp::data::stream::IOMode ioMode) override {
+    m_stream.object->setInputStreamIOMode(ioMode);
+  }
+
+  oatpp::data::stream::IOMode getInputStreamIOMode() override {
+    return m_stream.object->getInputStreamIOMode();
+  }
+
+  oatpp::data::stream::Context& getInputStreamContext() override {
+    return m_stream.object->getInputStreamContext();
+  }
+
+  void setOutputStreamIOMode(oatpp::data::stream::IOMode ioMode) override {
+    m_stream.object->setOutputStreamIOMode(ioMode);
+  }
+
+  oatpp::data::stream::IOMode getOutputStreamIOMode() override {
+    return m_stream.object->getOutputStreamIOMode();
+  }
+
+  oatpp::data::stream::Context& getOutputStreamContext() override {
+    return m_stream.object->getOutputStreamContext();
+  }
+
+  void invalidate() {
+    m_stream.invalidator->invalidate(m_stream.object);
+  }
+
+};
+
+/**
+ * Client connection provider wrapping transport streams into &l:ProbeStream;.
+ */
+class ProbeConnectionProvider : public oatpp::network::ClientConnectionProvider {
+private:
+
+  class Invalidator : public provider::Invalidator<oatpp::data::stream::IOStream> {
+  public:
+
+    void invalidate(const std::shared_ptr<oatpp::data::stream::IOStream>& stream) override {
+      std::static_pointer_cast<ProbeStream>(stream)->invalidate();
+    }
+
+  };
+
+private:
+  std::shared_ptr<oatpp::network::ClientConnectionProvider> m_streamProvider;
+  std::shared_ptr<Invalidator> m_invalidator;
+  std::shared_ptr<ProbeStream> m_lastStream;
+  std::mutex m_mutex;
+public:
+
+  /**
+   * &l:ProbeStream::handshakeFragmentSize; of the new streams.
+   */
+  std::atomic<v_buff_size> handshakeFragmentSize;
+
+public:
+
+  ProbeConnectionProvider(const std::shared_ptr<oatpp::network::ClientConnectionProvider>& streamProvider)
+    : m_streamProvider(streamProvider)
+    , m_invalidator(std::make_shared<Invalidator>())
+    , handshakeFragmentSize(0)
+  {
+    setProperty(PROPERTY_HOST, streamProvider->getProperty(PROPERTY_HOST).toString());
+    setProperty(PROPERTY_PORT, streamProvider->getProperty(PROPERTY_PORT).toString());
+  }
+
+  provider::ResourceHandle<oatpp::data::stream::IOStream> get() override {
+    auto stream = std::make_shared<ProbeStream>(m_streamProvider->get());
+    stream->handshakeFragmentSize = handshakeFragmentSize.load();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_lastStream = stream;
+    }
+    return provider::ResourceHandle<oatpp::data::stream::IOStream>(stream, m_invalidator);
+  }
+
+  async::CoroutineStarterForResult<const provider::ResourceHandle<oatpp::data::stream::IOStream>&> getAsync() override {
+    throw std::runtime_error("[oatpp::test::libressl::app::ProbeConnectionProvider::getAsync()]: Error. Not implemented.");
+  }
+
+  void stop() override {
+    m_streamProvider->stop();
+  }
+
+  /**
+   * Get the stream returned by the last &l:ProbeConnectionProvider::get ();.
+   * @return - &l:ProbeStream;.
+   */
+  std::shared_ptr<ProbeStream> getLastStream() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastStream;
+  }
+
+};
+
+}}}}
+
+#endif /* oatpp_test_libressl_app_TransportProbe_hpp */
@@ -4,8 +4,29 @@
 #include "FullTest.hpp"
 #include "FullAsyncTest.hpp"
 #include "FullAsyncClientTest.hpp"
+#include "FullDuplexTest.hpp"
+#include "AsyncAcceptTest.hpp"
+#include "SessionResumptionTest.hpp"
+#include "TrustStoreBenchmarkTest.hpp"
+#include "ConnectionPoolTest.hpp"
+#include "MultiListenerBenchmarkTest.hpp"
+#include "CertificateIndexTest.hpp"
+#include "FileCertificateProviderTest.hpp"
+#include "ConfigReloadTest.hpp"
+#include "OcspStapleTest.hpp"
+#include "AlpnTest.hpp"
+#include "HandshakePropertiesTest.hpp"
+#include "ConnectionStatisticsTest.hpp"
+#include "PrometheusExporterTest.hpp"
+#include "HandshakeProfilerTest.hpp"
+#include "ReadBufferTest.hpp"
+#include "WriteBufferTest.hpp"
+#include "RecordSizePolicyTest.hpp"
+#include "ServerContextShardsTest.hpp"
+#include "ClientHelloTest.hpp"
 
 #include "oatpp-libressl/Callbacks.hpp"
+#include "oatpp-libressl/HandshakeWorkerPool.hpp"
 
 #include "oatpp/core/concurrency/SpinLock.hpp"
 #include "oatpp/core/base/Environment.hpp"
@@ -35,6 +56,34 @@ void runTests() {
 
   }
 
+  {
+
+    auto buffered = [](const std::shared_ptr<oatpp::libressl::Config>& config) {
+      config->setReadAheadBufferSize(16 * 1024);
+      config->setReadBufferSize(16 * 1024);
+      config->setWriteBufferSize(16 * 1024);
+      config->setRecordSizePolicy(oatpp::libressl::Config::RecordSizePolicy(1400, 64 * 1024));
+    };
+
+    oatpp::test::libressl::FullTest test_virtual(0, 100, buffered);
+    test_virtual.run();
+
+    oatpp::test::libressl::FullTest test_port(8443, 10, buffered);
+    test_port.run();
+
+  }
+
+  {
+
+    auto sharded = [](const std::shared_ptr<oatpp::libressl::Config>& config) {
+      config->setServerContextShards(4);
+    };
+
+    oatpp::test::libressl::FullTest test_virtual(0, 100, sharded);
+    test_virtual.run();
+
+  }
+
   {
 
     oatpp::test::libressl::FullAsyncTest test_virtual(0, 100);
@@ -45,6 +94,25 @@ void runTests() {
 
   }
 
+  {
+
+    auto handshakePool = oatpp::libressl::HandshakeWorkerPool::createShared(2);
+
+    auto offloaded = [handshakePool](const std::shared_ptr<oatpp::libressl::Config>& config) {
+      config->setHandshakeWorkerPool(handshakePool);
+    };
+
+    oatpp::test::libressl::FullAsyncTest test_virtual(0, 100, offloaded);
+    test_virtual.run();
+
+    oatpp::test::libressl::FullAsyncTest test_port(8443, 10, offloaded);
+    test_port.run();
+
+    handshakePool->stop();
+    OATPP_LOGD("HandshakeWorkerPool", "tasks executed=%lld", (long long) handshakePool->getTasksExecuted());
+
+  }
+
   {
 
     oatpp::test::libressl::FullAsyncClientTest test_virtual(0, 10);
@@ -55,6 +123,146 @@ void runTests() {
 
   }
 
+  {
+
+    oatpp::test::libressl::FullDuplexTest test(4, 4 * 1024 * 1024);
+    test.run(5);
+
+  }
+
+  {
+
+    oatpp::test::libressl::AsyncAcceptTest test(4, 100);
+    test.run(5);
+
+  }
+
+  {
+
+    oatpp::test::libressl::SessionResumptionTest test(20);
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::TrustStoreBenchmarkTest test(100);
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ConnectionPoolTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::MultiListenerBenchmarkTest test(8445, 400, 8);
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::CertificateIndexTest test(1000000);
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::FileCertificateProviderTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ConfigReloadTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::OcspStapleTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::AlpnTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::HandshakePropertiesTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ConnectionStatisticsTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::PrometheusExporterTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::HandshakeProfilerTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ReadBufferTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::WriteBufferTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::RecordSizePolicyTest test;
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ServerContextShardsTest test(4, 50);
+    test.run();
+
+  }
+
+  {
+
+    oatpp::test::libressl::ClientHelloTest test;
+    test.run();
+
+  }
+
 }
 
 }